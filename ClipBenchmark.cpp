@@ -0,0 +1,176 @@
+/**     @file ClipBenchmark.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Clips a mesh with several planes using ClipKernel and vtkClipPolyData,
+  *     prints both timings and checks that the two outputs match: the same
+  *     point and triangle counts, surface area and bounds. Built with
+  *     -DVRMV_BUILD_BENCHMARKS=ON, exits with 1 if any output differs.
+  *
+  *     ClipBenchmark [--triangles N] [--stl FILE] [--repeats N]
+  */
+
+#include "ClipKernel.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkSTLReader.h>
+#include <vtkCleanPolyData.h>
+#include <vtkPlane.h>
+#include <vtkClipPolyData.h>
+#include <vtkTriangleFilter.h>
+#include <vtkMassProperties.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief Gets the surface area of a mesh
+ * @param data the mesh
+ * @return the area, 0 if it has no triangles
+ */
+static double surfaceArea(vtkPolyData* data) {
+    if (data->GetNumberOfCells() == 0)
+        return 0.;
+
+    auto triangles = vtkSmartPointer<vtkTriangleFilter>::New();
+    triangles->SetInputData(data);
+    auto mass = vtkSmartPointer<vtkMassProperties>::New();
+    mass->SetInputConnection(triangles->GetOutputPort());
+    mass->Update();
+    return mass->GetSurfaceArea();
+}
+
+/**
+ * @brief Runs a function several times
+ * @param repeats number of runs
+ * @param run the function
+ * @return the quickest run in milliseconds
+ */
+template <typename Run>
+static double fastestMs(int repeats, Run run) {
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeats; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        run();
+        best = std::min(best, timer.nsecsElapsed() / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times ClipKernel against vtkClipPolyData and checks both give the same mesh");
+    parser.addHelpOption();
+    parser.addOption({ "triangles", "Triangles of the generated sphere.", "count", "2000000" });
+    parser.addOption({ "stl", "Clip an STL file instead of a sphere.", "file" });
+    parser.addOption({ "repeats", "Times each clip is run, the quickest is reported.", "count", "3" });
+    parser.process(app);
+
+    const int triangles = std::max(8, parser.value("triangles").toInt());
+    const int repeats = std::max(1, parser.value("repeats").toInt());
+
+    // the kernel never merges coincident points, so the input is cleaned the way the STL reader does it
+    vtkSmartPointer<vtkPolyData> input;
+    if (parser.isSet("stl")) {
+        auto reader = vtkSmartPointer<vtkSTLReader>::New();
+        reader->SetFileName(parser.value("stl").toStdString().c_str());
+        reader->Update();
+        input = reader->GetOutput();
+    } else {
+        // a sphere with resolution r in both directions has about 2r(r - 2) triangles
+        const int resolution = std::max(4, static_cast<int>(std::lround(1. + std::sqrt(1. + triangles / 2.))));
+        auto sphere = vtkSmartPointer<vtkSphereSource>::New();
+        sphere->SetThetaResolution(resolution);
+        sphere->SetPhiResolution(resolution);
+        sphere->SetRadius(40.);
+        auto clean = vtkSmartPointer<vtkCleanPolyData>::New();
+        clean->SetInputConnection(sphere->GetOutputPort());
+        clean->Update();
+        input = clean->GetOutput();
+    }
+
+    QTextStream out(stdout);
+    if (!ClipKernel::canClip(input)) {
+        out << "The mesh is not made of triangles only, ClipKernel cannot clip it" << Qt::endl;
+        return 1;
+    }
+
+    double bounds[6];
+    input->GetBounds(bounds);
+    const double centre[3] = { (bounds[0] + bounds[1]) / 2., (bounds[2] + bounds[3]) / 2., (bounds[4] + bounds[5]) / 2. };
+    const double diagonal = std::sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0]) +
+                                      (bounds[3] - bounds[2]) * (bounds[3] - bounds[2]) +
+                                      (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+    out << "Clip benchmark: " << input->GetNumberOfPolys() << " triangles, " << input->GetNumberOfPoints()
+        << " points, best of " << repeats << Qt::endl;
+
+    // offsets are odd fractions of the size so no point lies exactly on a plane
+    struct Plane { double offset; double normal[3]; };
+    const Plane planes[] = {
+        { 0.0123, { -1., 0., 0. } },
+        { -0.2371, { 0., 1., 0. } },
+        { 0.3117, { 0.577, 0.577, 0.577 } },
+        { -0.4129, { 0.2, -0.9, 0.4 } },
+    };
+
+    bool allMatch = true;
+    for (const Plane& p : planes) {
+        double length = std::sqrt(p.normal[0] * p.normal[0] + p.normal[1] * p.normal[1] + p.normal[2] * p.normal[2]);
+        double normal[3] = { p.normal[0] / length, p.normal[1] / length, p.normal[2] / length };
+        double origin[3];
+        for (int k = 0; k < 3; ++k)
+            origin[k] = centre[k] + p.offset * diagonal * normal[k];
+
+        vtkSmartPointer<vtkPolyData> kernelOutput;
+        const double kernelMs = fastestMs(repeats, [&]() { kernelOutput = ClipKernel::clipPlane(input, origin, normal); });
+
+        auto plane = vtkSmartPointer<vtkPlane>::New();
+        plane->SetOrigin(origin);
+        plane->SetNormal(normal);
+        vtkSmartPointer<vtkPolyData> vtkOutput;
+        const double vtkMs = fastestMs(repeats, [&]() {
+            auto clipFilter = vtkSmartPointer<vtkClipPolyData>::New();
+            clipFilter->SetInputData(input);
+            clipFilter->SetClipFunction(plane);
+            clipFilter->Update();
+            vtkOutput = clipFilter->GetOutput();
+        });
+
+        // the same surface, cut at the same places
+        const double kernelArea = surfaceArea(kernelOutput);
+        const double vtkArea = surfaceArea(vtkOutput);
+        double kernelBounds[6], vtkBounds[6];
+        kernelOutput->GetBounds(kernelBounds);
+        vtkOutput->GetBounds(vtkBounds);
+        double boundsError = 0.;
+        for (int k = 0; k < 6; ++k)
+            boundsError = std::max(boundsError, std::abs(kernelBounds[k] - vtkBounds[k]));
+
+        const bool countsMatch = kernelOutput->GetNumberOfPoints() == vtkOutput->GetNumberOfPoints() &&
+                                 kernelOutput->GetNumberOfPolys() == vtkOutput->GetNumberOfCells();
+        const bool geometryMatches = std::abs(kernelArea - vtkArea) <= 1e-6 * std::max(1., vtkArea) &&
+                                     boundsError <= 1e-6 * diagonal;
+        allMatch = allMatch && countsMatch && geometryMatches;
+
+        out << "normal (" << normal[0] << ", " << normal[1] << ", " << normal[2] << ")" << Qt::endl;
+        out << "  ClipKernel:      " << kernelMs << " ms, " << kernelOutput->GetNumberOfPolys() << " triangles, "
+            << kernelOutput->GetNumberOfPoints() << " points, area " << kernelArea << Qt::endl;
+        out << "  vtkClipPolyData: " << vtkMs << " ms, " << vtkOutput->GetNumberOfCells() << " cells, "
+            << vtkOutput->GetNumberOfPoints() << " points, area " << vtkArea << Qt::endl;
+        out << "  speed-up " << vtkMs / std::max(kernelMs, 1e-6) << "x, "
+            << (countsMatch && geometryMatches ? "outputs match" : "OUTPUTS DIFFER") << Qt::endl;
+    }
+
+    return allMatch ? 0 : 1;
+}
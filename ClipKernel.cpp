@@ -0,0 +1,320 @@
+/**     @file ClipKernel.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded plane and box clipping for triangle meshes, used in place
+  *     of vtkClipPolyData when clipped geometry is needed for large parts.
+  */
+
+#include "ClipKernel.h"
+
+#include <vtkSMPTools.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkIdTypeArray.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIPKERNEL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const vtkIdType ChunkSize = 1 << 15;    // points or triangles handled by one parallel task
+
+/* Edge between two points, always stored with the smaller id first so both triangles
+ * sharing a cut edge find the same new point */
+struct Edge {
+    vtkIdType a;
+    vtkIdType b;
+    bool operator<(const Edge& other) const { return a < other.a || (a == other.a && b < other.b); }
+    bool operator==(const Edge& other) const { return a == other.a && b == other.b; }
+};
+
+Edge makeEdge(vtkIdType i, vtkIdType j) {
+    return i < j ? Edge{ i, j } : Edge{ j, i };
+}
+
+vtkIdType chunkCount(vtkIdType n) {
+    return (n + ChunkSize - 1) / ChunkSize;
+}
+
+bool isCancelled(const std::atomic<bool>* cancel) {
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+/* Signed distance of points [begin, end) from the plane. This is evaluated in double exactly like
+ * vtkPlane::EvaluateFunction and stored as float like vtkClipPolyData's clip scalars, so both
+ * decide which side of the plane a point is on in the same way */
+template <typename P>
+void classifyPoints(const P* p, vtkIdType begin, vtkIdType end, const double o[3], const double n[3],
+                    float* d, uint8_t* inside) {
+    vtkIdType i = begin;
+#ifdef CLIPKERNEL_USE_SSE2
+    const __m128d ox = _mm_set1_pd(o[0]), oy = _mm_set1_pd(o[1]), oz = _mm_set1_pd(o[2]);
+    const __m128d nx = _mm_set1_pd(n[0]), ny = _mm_set1_pd(n[1]), nz = _mm_set1_pd(n[2]);
+    const __m128 zero = _mm_setzero_ps();
+
+    // two points per step
+    for (; i + 2 <= end; i += 2) {
+        const P* q = p + 3 * i;
+        __m128d x = _mm_set_pd(q[3], q[0]);
+        __m128d y = _mm_set_pd(q[4], q[1]);
+        __m128d z = _mm_set_pd(q[5], q[2]);
+
+        __m128d dist = _mm_add_pd(_mm_add_pd(_mm_mul_pd(nx, _mm_sub_pd(x, ox)),
+                                             _mm_mul_pd(ny, _mm_sub_pd(y, oy))),
+                                  _mm_mul_pd(nz, _mm_sub_pd(z, oz)));
+
+        __m128 distFloat = _mm_cvtpd_ps(dist);
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(distFloat, zero));
+
+        _mm_storel_pi(reinterpret_cast<__m64*>(d + i), distFloat);
+        inside[i] = mask & 1;
+        inside[i + 1] = (mask >> 1) & 1;
+    }
+#endif
+    for (; i < end; ++i) {
+        const P* q = p + 3 * i;
+        float dist = static_cast<float>(n[0] * (q[0] - o[0]) + n[1] * (q[1] - o[1]) + n[2] * (q[2] - o[2]));
+        d[i] = dist;
+        inside[i] = dist > 0.0f;
+    }
+}
+
+template <typename P, typename IdT>
+vtkSmartPointer<vtkPolyData> clipTriangles(vtkPoints* inputPoints, const IdT* conn, vtkIdType nTris,
+                                           const double o[3], const double n[3], const std::atomic<bool>* cancel) {
+    const vtkIdType nPts = inputPoints->GetNumberOfPoints();
+    const P* p = static_cast<const P*>(inputPoints->GetVoidPointer(0));
+
+    // -------------------------- classify points ----------------------------------
+    std::vector<float> d(nPts);
+    std::vector<uint8_t> inside(nPts);
+
+    const vtkIdType pointChunks = chunkCount(nPts);
+    vtkSMPTools::For(0, pointChunks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType c = first; c < last && !isCancelled(cancel); ++c)
+            classifyPoints(p, c * ChunkSize, std::min(nPts, (c + 1) * ChunkSize), o, n, d.data(), inside.data());
+    });
+    if (isCancelled(cancel))
+        return nullptr;
+
+    // new ids for the kept points, counted per chunk so they keep their original order
+    std::vector<vtkIdType> chunkPointOffset(pointChunks + 1, 0);
+    vtkSMPTools::For(0, pointChunks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType c = first; c < last; ++c) {
+            vtkIdType count = 0;
+            for (vtkIdType i = c * ChunkSize; i < std::min(nPts, (c + 1) * ChunkSize); ++i)
+                count += inside[i];
+            chunkPointOffset[c + 1] = count;
+        }
+    });
+    for (vtkIdType c = 0; c < pointChunks; ++c)
+        chunkPointOffset[c + 1] += chunkPointOffset[c];
+    const vtkIdType nKept = chunkPointOffset[pointChunks];
+
+    std::vector<vtkIdType> pointMap(nPts, -1);
+    vtkSMPTools::For(0, pointChunks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType c = first; c < last; ++c) {
+            vtkIdType next = chunkPointOffset[c];
+            for (vtkIdType i = c * ChunkSize; i < std::min(nPts, (c + 1) * ChunkSize); ++i) {
+                if (inside[i])
+                    pointMap[i] = next++;
+            }
+        }
+    });
+
+    // -------------------------- count output and find cut edges ----------------------------------
+    const vtkIdType triChunks = chunkCount(nTris);
+    std::vector<vtkIdType> chunkTriOffset(triChunks + 1, 0);
+    std::vector<std::vector<Edge>> chunkEdges(triChunks);
+
+    vtkSMPTools::For(0, triChunks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType c = first; c < last && !isCancelled(cancel); ++c) {
+            vtkIdType count = 0;
+            std::vector<Edge>& edges = chunkEdges[c];
+            for (vtkIdType t = c * ChunkSize; t < std::min(nTris, (c + 1) * ChunkSize); ++t) {
+                const IdT* v = conn + 3 * t;
+                int kept = inside[v[0]] + inside[v[1]] + inside[v[2]];
+                if (kept == 0)
+                    continue;
+                count += (kept == 2) ? 2 : 1;
+                if (kept == 3)
+                    continue;
+                for (int k = 0; k < 3; ++k) {
+                    vtkIdType a = v[k], b = v[(k + 1) % 3];
+                    if (inside[a] != inside[b])
+                        edges.push_back(makeEdge(a, b));
+                }
+            }
+            chunkTriOffset[c + 1] = count;
+        }
+    });
+    if (isCancelled(cancel))
+        return nullptr;
+    for (vtkIdType c = 0; c < triChunks; ++c)
+        chunkTriOffset[c + 1] += chunkTriOffset[c];
+    const vtkIdType nOutTris = chunkTriOffset[triChunks];
+
+    // every cut edge gives one new point, shared by the triangles either side of it
+    std::vector<Edge> cutEdges;
+    for (auto& edges : chunkEdges) {
+        cutEdges.insert(cutEdges.end(), edges.begin(), edges.end());
+        std::vector<Edge>().swap(edges);
+    }
+    vtkSMPTools::Sort(cutEdges.begin(), cutEdges.end());
+    cutEdges.erase(std::unique(cutEdges.begin(), cutEdges.end()), cutEdges.end());
+    const vtkIdType nCut = static_cast<vtkIdType>(cutEdges.size());
+    if (isCancelled(cancel))
+        return nullptr;
+
+    // -------------------------- output points ----------------------------------
+    auto outPoints = vtkSmartPointer<vtkPoints>::New();
+    outPoints->SetDataType(inputPoints->GetDataType());
+    outPoints->SetNumberOfPoints(nKept + nCut);
+    P* out = static_cast<P*>(outPoints->GetVoidPointer(0));
+
+    vtkSMPTools::For(0, nPts, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; ++i) {
+            if (pointMap[i] < 0)
+                continue;
+            std::copy(p + 3 * i, p + 3 * i + 3, out + 3 * pointMap[i]);
+        }
+    });
+
+    vtkSMPTools::For(0, nCut, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType e = first; e < last; ++e) {
+            /* Same as vtkTriangle::Clip, interpolate from the end with the lower value */
+            vtkIdType e1 = cutEdges[e].a, e2 = cutEdges[e].b;
+            if (d[e1] > d[e2])
+                std::swap(e1, e2);
+            double t = (0.0 - d[e1]) / (static_cast<double>(d[e2]) - d[e1]);
+            P* x = out + 3 * (nKept + e);
+            for (int k = 0; k < 3; ++k) {
+                double x1 = p[3 * e1 + k], x2 = p[3 * e2 + k];
+                x[k] = static_cast<P>(x1 + t * (x2 - x1));
+            }
+        }
+    });
+
+    // -------------------------- output triangles ----------------------------------
+    auto connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(3 * nOutTris);
+    vtkIdType* outConn = connectivity->GetPointer(0);
+
+    auto offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(nOutTris + 1);
+    vtkIdType* outOffsets = offsets->GetPointer(0);
+
+    auto cutPoint = [&](vtkIdType a, vtkIdType b) {
+        auto it = std::lower_bound(cutEdges.begin(), cutEdges.end(), makeEdge(a, b));
+        return nKept + static_cast<vtkIdType>(it - cutEdges.begin());
+    };
+
+    vtkSMPTools::For(0, triChunks, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType c = first; c < last && !isCancelled(cancel); ++c) {
+            vtkIdType* o3 = outConn + 3 * chunkTriOffset[c];
+            for (vtkIdType t = c * ChunkSize; t < std::min(nTris, (c + 1) * ChunkSize); ++t) {
+                const IdT* v = conn + 3 * t;
+                int kept = inside[v[0]] + inside[v[1]] + inside[v[2]];
+
+                if (kept == 3) {
+                    *o3++ = pointMap[v[0]];
+                    *o3++ = pointMap[v[1]];
+                    *o3++ = pointMap[v[2]];
+                }
+                else if (kept == 1) {
+                    // rotate so the kept corner is first, keeps the winding of the triangle
+                    int k = inside[v[0]] ? 0 : (inside[v[1]] ? 1 : 2);
+                    vtkIdType a = v[k], b = v[(k + 1) % 3], cc = v[(k + 2) % 3];
+                    *o3++ = pointMap[a];
+                    *o3++ = cutPoint(a, b);
+                    *o3++ = cutPoint(cc, a);
+                }
+                else if (kept == 2) {
+                    // rotate so the removed corner is last, the kept quad is split in two
+                    int k = !inside[v[0]] ? 0 : (!inside[v[1]] ? 1 : 2);
+                    vtkIdType cc = v[k], a = v[(k + 1) % 3], b = v[(k + 2) % 3];
+                    vtkIdType bc = cutPoint(b, cc), ca = cutPoint(cc, a);
+                    *o3++ = pointMap[a];
+                    *o3++ = pointMap[b];
+                    *o3++ = bc;
+                    *o3++ = pointMap[a];
+                    *o3++ = bc;
+                    *o3++ = ca;
+                }
+            }
+        }
+    });
+
+    if (isCancelled(cancel))
+        return nullptr;
+
+    vtkSMPTools::For(0, nOutTris + 1, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; ++i)
+            outOffsets[i] = 3 * i;
+    });
+
+    auto polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    auto output = vtkSmartPointer<vtkPolyData>::New();
+    output->SetPoints(outPoints);
+    output->SetPolys(polys);
+    return output;
+}
+
+template <typename P>
+vtkSmartPointer<vtkPolyData> clipWithIds(vtkPolyData* input, const double o[3], const double n[3], const std::atomic<bool>* cancel) {
+    vtkCellArray* polys = input->GetPolys();
+    vtkIdType nTris = polys->GetNumberOfCells();
+
+    if (polys->IsStorage64Bit())
+        return clipTriangles<P>(input->GetPoints(), polys->GetConnectivityArray64()->GetPointer(0), nTris, o, n, cancel);
+    return clipTriangles<P>(input->GetPoints(), polys->GetConnectivityArray32()->GetPointer(0), nTris, o, n, cancel);
+}
+}
+
+bool ClipKernel::canClip(vtkPolyData* input) {
+    if (!input || !input->GetPoints())
+        return false;
+
+    int type = input->GetPoints()->GetDataType();
+    if (type != VTK_FLOAT && type != VTK_DOUBLE)
+        return false;
+
+    // only plain triangles, anything else is left to vtkClipPolyData
+    return input->GetNumberOfVerts() == 0 && input->GetNumberOfLines() == 0 &&
+           input->GetNumberOfStrips() == 0 && input->GetPolys()->IsHomogeneous() == 3;
+}
+
+vtkSmartPointer<vtkPolyData> ClipKernel::clipPlane(vtkPolyData* input, const double origin[3], const double normal[3],
+                                                   const std::atomic<bool>* cancel) {
+    if (input->GetPoints()->GetDataType() == VTK_FLOAT)
+        return clipWithIds<float>(input, origin, normal, cancel);
+    return clipWithIds<double>(input, origin, normal, cancel);
+}
+
+vtkSmartPointer<vtkPolyData> ClipKernel::clipBox(vtkPolyData* input, const double bounds[6], const std::atomic<bool>* cancel) {
+    /* A box is six planes facing inwards, each clip is exact so doing them in turn gives the box */
+    vtkSmartPointer<vtkPolyData> current = input;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = 0; side < 2; ++side) {
+            double origin[3] = { 0, 0, 0 };
+            double normal[3] = { 0, 0, 0 };
+            origin[axis] = bounds[2 * axis + side];
+            normal[axis] = side == 0 ? 1.0 : -1.0;
+            current = clipPlane(current, origin, normal, cancel);
+            if (!current)
+                return nullptr;
+        }
+    }
+    return current;
+}
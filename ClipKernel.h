@@ -0,0 +1,56 @@
+/**     @file ClipKernel.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded plane and box clipping for triangle meshes, used in place
+  *     of vtkClipPolyData when clipped geometry is needed for large parts.
+  */
+
+#ifndef VIEWER_CLIPKERNEL_H
+#define VIEWER_CLIPKERNEL_H
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+
+/**
+ * @brief Clips triangle meshes with a plane or a box
+ * @note Points are classified against the plane with SIMD instructions (SSE2 where available)
+ *       and the triangles are split in parallel chunks with vtkSMPTools. The result keeps the
+ *       same side of the plane as vtkClipPolyData (function value > 0) and puts the new points at
+ *       the same place along each cut edge, so it describes the same surface. Triangles cut so two
+ *       corners are kept are split into two triangles. Point and cell data arrays are not copied.
+ */
+class ClipKernel {
+public:
+    /**
+     * @brief Checks if the kernel can clip the data
+     * @param input the data to check
+     * @return true if the data only holds triangles, otherwise vtkClipPolyData has to be used
+     */
+    static bool canClip(vtkPolyData* input);
+
+    /**
+     * @brief Clips the data with a plane, keeping the side the normal points to
+     * @param input triangle mesh, see canClip()
+     * @param origin a point on the plane
+     * @param normal the plane normal
+     * @param cancel optional flag, checked between the steps of the clip and between chunks of work
+     * @return the clipped mesh, or nullptr if cancelled
+     */
+    static vtkSmartPointer<vtkPolyData> clipPlane(vtkPolyData* input, const double origin[3], const double normal[3],
+                                                  const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * @brief Clips the data to an axis aligned box, keeping what is inside
+     * @param input triangle mesh, see canClip()
+     * @param bounds box as (xmin, xmax, ymin, ymax, zmin, zmax)
+     * @param cancel optional flag, see clipPlane()
+     * @return the clipped mesh, or nullptr if cancelled
+     */
+    static vtkSmartPointer<vtkPolyData> clipBox(vtkPolyData* input, const double bounds[6],
+                                                const std::atomic<bool>* cancel = nullptr);
+};
+
+#endif
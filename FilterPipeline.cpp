@@ -0,0 +1,348 @@
+/**     @file FilterPipeline.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Ordered chain of filters applied to a model part, with the output of
+  *     each stage cached so that only stale stages are re-run.
+  */
+
+#include "FilterPipeline.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+
+namespace {
+/* Cancel flag of the pipeline currently running on this thread, stages read it through
+ * updateAlgorithm() so they do not need to pass it around themselves */
+thread_local const std::atomic<bool>* activeCancelFlag = nullptr;
+
+/* Restores the previous cancel flag when a pipeline run finishes */
+struct CancelFlagScope {
+    const std::atomic<bool>* previous;
+    explicit CancelFlagScope(const std::atomic<bool>* flag) : previous(activeCancelFlag) { activeCancelFlag = flag; }
+    ~CancelFlagScope() { activeCancelFlag = previous; }
+};
+
+bool isCancelled(const std::atomic<bool>* flag) {
+    return flag && flag->load(std::memory_order_relaxed);
+}
+}
+
+// ----------------------------- FilterStage ----------------------------------
+
+bool FilterStage::isEnabled() const {
+    return enabled;
+}
+
+void FilterStage::setEnabled(bool enabled) {
+    this->enabled = enabled;
+}
+
+QVariant FilterStage::parameter(const QString& key) const {
+    return parameters.value(key);
+}
+
+void FilterStage::setParameter(const QString& key, const QVariant& value) {
+    parameters.insert(key, value);
+}
+
+QString FilterStage::cacheKey() const {
+    /* QVariantMap is sorted by key so the same parameters always give the same string */
+    QString key;
+    for (auto it = parameters.constBegin(); it != parameters.constEnd(); ++it) {
+        key += it.key() + "=" + it.value().toString() + ";";
+    }
+    return key;
+}
+
+bool FilterStage::updateInPlace(vtkPolyData* input, vtkPolyData* output) const {
+    Q_UNUSED(input);
+    Q_UNUSED(output);
+    return false;
+}
+
+const std::atomic<bool>* FilterStage::cancelFlag() {
+    return activeCancelFlag;
+}
+
+bool FilterStage::updateAlgorithm(vtkAlgorithm* algorithm) {
+    const std::atomic<bool>* cancel = activeCancelFlag;
+    if (!cancel) {
+        algorithm->Update();
+        return true;
+    }
+
+    /* VTK filters report progress regularly while running, use that to check for cancel */
+    auto abortCheck = vtkSmartPointer<vtkCallbackCommand>::New();
+    abortCheck->SetClientData(const_cast<std::atomic<bool>*>(cancel));
+    abortCheck->SetCallback([](vtkObject* caller, unsigned long, void* clientData, void*) {
+        auto flag = static_cast<const std::atomic<bool>*>(clientData);
+        if (isCancelled(flag))
+            static_cast<vtkAlgorithm*>(caller)->SetAbortExecute(1);
+    });
+    unsigned long tag = algorithm->AddObserver(vtkCommand::ProgressEvent, abortCheck);
+
+    algorithm->Update();
+    algorithm->RemoveObserver(tag);
+
+    return !isCancelled(cancel);
+}
+
+// ----------------------------- FilterRegistry ----------------------------------
+
+FilterRegistry& FilterRegistry::instance() {
+    /* Function local static so filters registering from other files during static
+     * initialisation always find the registry constructed */
+    static FilterRegistry registry;
+    return registry;
+}
+
+bool FilterRegistry::registerFilter(const QString& name, int order, Factory factory) {
+    for (const Entry& entry : entries) {
+        if (entry.name == name) {
+            qDebug() << "Filter already registered:" << name;
+            return false;
+        }
+    }
+
+    Entry entry{ name, order, std::move(factory) };
+    auto position = std::upper_bound(entries.begin(), entries.end(), order,
+                                     [](int value, const Entry& e) { return value < e.order; });
+    entries.insert(position, std::move(entry));
+    return true;
+}
+
+std::unique_ptr<FilterStage> FilterRegistry::create(const QString& name) const {
+    for (const Entry& entry : entries) {
+        if (entry.name == name)
+            return entry.factory();
+    }
+    return nullptr;
+}
+
+QStringList FilterRegistry::filterNames() const {
+    QStringList names;
+    for (const Entry& entry : entries)
+        names.append(entry.name);
+    return names;
+}
+
+// ----------------------------- FilterPipeline ----------------------------------
+
+FilterPipeline::FilterPipeline() {
+    const FilterRegistry& registry = FilterRegistry::instance();
+    for (const QString& name : registry.filterNames()) {
+        stages.push_back(registry.create(name));
+    }
+    cache.resize(stages.size());
+}
+
+FilterPipeline::FilterPipeline(const FilterPipeline& other) {
+    *this = other;
+}
+
+FilterPipeline& FilterPipeline::operator=(const FilterPipeline& other) {
+    if (this == &other)
+        return *this;
+
+    stages.clear();
+    for (const auto& s : other.stages)
+        stages.push_back(s->clone());
+
+    /* Cached outputs are shared, updateInPlace() copies an output before changing it if
+     * any other pipeline still holds it */
+    cache = other.cache;
+    return *this;
+}
+
+FilterStage* FilterPipeline::stage(const QString& name) const {
+    for (const auto& s : stages) {
+        if (s->name() == name)
+            return s.get();
+    }
+    return nullptr;
+}
+
+int FilterPipeline::stageCount() const {
+    return static_cast<int>(stages.size());
+}
+
+FilterStage* FilterPipeline::stageAt(int index) const {
+    if (index < 0 || index >= stageCount())
+        return nullptr;
+    return stages[index].get();
+}
+
+bool FilterPipeline::hasActiveStages() const {
+    for (const auto& s : stages) {
+        if (s->isEnabled())
+            return true;
+    }
+    return false;
+}
+
+vtkSmartPointer<vtkPolyData> FilterPipeline::update(vtkPolyData* input,
+                                                    const std::atomic<bool>* cancel,
+                                                    const StageCallback& onStageFinished) {
+    CancelFlagScope cancelScope(cancel);
+    vtkSmartPointer<vtkPolyData> current = input;
+
+    for (int i = 0; i < stageCount(); ++i) {
+        if (isCancelled(cancel))
+            return nullptr;
+
+        const FilterStage* s = stages[i].get();
+        if (!s->isEnabled())
+            continue;
+
+        QString key = s->cacheKey();
+
+        /* Reuse a cached output if it was made from this exact input with these parameters.
+         * If an earlier stage was recomputed its output is a new object, so every stage after
+         * it misses here and is recomputed too */
+        if (CacheEntry* entry = findEntry(i, current, key)) {
+            current = entry->output;
+            if (onStageFinished)
+                onStageFinished(i, current);
+            continue;
+        }
+
+        qDebug() << "Running filter stage:" << s->name() << key;
+
+        /* VTK wraps the input in a producer and updates its pipeline information and bounds, so the
+         * stage gets its own data object sharing the arrays of the cached one */
+        auto stageInput = vtkSmartPointer<vtkPolyData>::New();
+        stageInput->ShallowCopy(current);
+        vtkSmartPointer<vtkPolyData> output = s->execute(stageInput);
+
+        /* An aborted stage leaves partial output behind, never cache it */
+        if (isCancelled(cancel) || !output)
+            return nullptr;
+
+        std::vector<CacheEntry>& entries = cache[i];
+        CacheEntry entry;
+        entry.input = current;
+        entry.inputTime = current->GetMTime();
+        entry.key = key;
+        entry.output = output;
+        entry.owners = std::make_shared<int>(0);
+        entries.insert(entries.begin(), std::move(entry));
+        if (entries.size() > CacheEntriesPerStage)
+            entries.pop_back();
+        current = output;
+
+        if (onStageFinished)
+            onStageFinished(i, current);
+    }
+
+    return current;
+}
+
+vtkSmartPointer<vtkPolyData> FilterPipeline::updateInPlace(vtkPolyData* input) {
+    int last = -1;
+    for (int i = stageCount() - 1; i >= 0 && last < 0; --i) {
+        if (stages[i]->isEnabled())
+            last = i;
+    }
+    if (last < 0)
+        return nullptr;
+
+    /* Every stage before the last must already be cached for the current parameters */
+    vtkPolyData* current = input;
+    for (int i = 0; i < last; ++i) {
+        if (!stages[i]->isEnabled())
+            continue;
+        CacheEntry* entry = findEntry(i, current, stages[i]->cacheKey());
+        if (!entry)
+            return nullptr;
+        current = entry->output;
+    }
+
+    QString key = stages[last]->cacheKey();
+    if (CacheEntry* entry = findEntry(last, current, key))
+        return entry->output;
+
+    /* Rewrite the most recent output made from the same input */
+    std::vector<CacheEntry>& entries = cache[last];
+    auto it = std::find_if(entries.begin(), entries.end(), [current](const CacheEntry& e) {
+        return e.input == current && e.inputTime == current->GetMTime();
+    });
+    if (it == entries.end())
+        return nullptr;
+    CacheEntry& entry = *it;
+
+    /* Another pipeline (e.g. the copy kept to undo the filter dialog) or the VR scene still holds
+     * the output, so write into the spare one made from the same input. While an output is held
+     * the two take turns, a copy is only made if the spare is still held as well */
+    vtkSmartPointer<vtkPolyData> output = entry.output;
+    std::shared_ptr<int> owners;
+    if (entry.owners.use_count() > 1) {
+        if (entry.spare && entry.spareOwners.use_count() == 1) {
+            output = entry.spare;
+            owners = entry.spareOwners;
+        } else {
+            output = vtkSmartPointer<vtkPolyData>::New();
+            output->DeepCopy(entry.output);
+            owners = std::make_shared<int>(0);
+        }
+    }
+
+    if (!stages[last]->updateInPlace(current, output))
+        return nullptr;
+
+    qDebug() << "Updated filter stage in place:" << stages[last]->name() << key;
+    if (output != entry.output) {
+        entry.spare = entry.output;
+        entry.spareOwners = entry.owners;
+        entry.output = output;
+        entry.owners = owners;
+    }
+    entry.key = key;
+    std::rotate(entries.begin(), it, it + 1);
+    return output;
+}
+
+std::shared_ptr<int> FilterPipeline::shareOutput(vtkPolyData* output) const {
+    for (const std::vector<CacheEntry>& entries : cache) {
+        for (const CacheEntry& entry : entries) {
+            if (output && entry.output == output)
+                return entry.owners;
+        }
+    }
+    return nullptr;
+}
+
+void FilterPipeline::replaceInput(vtkPolyData* from, vtkPolyData* to) {
+    if (!from || !to || from == to)
+        return;
+
+    for (std::vector<CacheEntry>& entries : cache) {
+        for (CacheEntry& entry : entries) {
+            if (entry.input == from && entry.inputTime == from->GetMTime()) {
+                entry.input = to;
+                entry.inputTime = to->GetMTime();
+            }
+        }
+    }
+}
+
+void FilterPipeline::clearCache() {
+    for (std::vector<CacheEntry>& entries : cache)
+        entries.clear();
+}
+
+FilterPipeline::CacheEntry* FilterPipeline::findEntry(int index, vtkPolyData* input, const QString& key) {
+    std::vector<CacheEntry>& entries = cache[index];
+    auto it = std::find_if(entries.begin(), entries.end(), [input, &key](const CacheEntry& e) {
+        return e.output && e.input == input && e.inputTime == input->GetMTime() && e.key == key;
+    });
+    if (it == entries.end())
+        return nullptr;
+
+    std::rotate(entries.begin(), it, it + 1);
+    return &entries.front();
+}
@@ -0,0 +1,300 @@
+/**     @file FilterPipeline.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Ordered chain of filters applied to a model part, with the output of
+  *     each stage cached so that only stale stages are re-run.
+  */
+
+#ifndef VIEWER_FILTERPIPELINE_H
+#define VIEWER_FILTERPIPELINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+#include <vtkAlgorithm.h>
+
+/**
+ * @brief A single filter in a part's filter chain
+ * @note Stages are described entirely by their parameters, the cache key of a stage is built
+ *       from those parameters so two stages with the same parameters and input give the same output
+ */
+class FilterStage {
+public:
+    virtual ~FilterStage() = default;
+
+    /**
+     * @brief Name the stage was registered under (e.g. "clip")
+     * @return the registry name of the stage
+     */
+    virtual QString name() const = 0;
+
+    /**
+     * @brief Creates a copy of this stage with the same parameters and enabled state
+     * @return newly allocated copy of the stage
+     */
+    virtual std::unique_ptr<FilterStage> clone() const = 0;
+
+    /**
+     * @brief Runs the filter on the input data
+     * @param input the output of the previous stage (or the unfiltered part)
+     * @return the filtered data, must be a new object and not modify the input
+     */
+    virtual vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const = 0;
+
+    /**
+     * @brief Updates an earlier output of this stage for the current parameters without allocating
+     * @note stages that cannot do this keep the default, which always returns false
+     * @param input the same input the output was made from
+     * @param output the earlier output, changed in place
+     * @return true if the output was updated, false if execute() has to be used instead
+     */
+    virtual bool updateInPlace(vtkPolyData* input, vtkPolyData* output) const;
+
+    /**
+     * @brief Checks if the stage is enabled, disabled stages are skipped by the pipeline
+     * @return true if the stage is enabled
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Enables or disables the stage
+     * @param enabled true to enable the stage
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Gets a parameter of the stage
+     * @param key parameter name
+     * @return the parameter value, or an invalid QVariant if not set
+     */
+    QVariant parameter(const QString& key) const;
+
+    /**
+     * @brief Sets a parameter of the stage
+     * @param key parameter name
+     * @param value parameter value
+     */
+    void setParameter(const QString& key, const QVariant& value);
+
+    /**
+     * @brief Builds a string that uniquely identifies the current parameters
+     * @return the cache key for the current parameters
+     */
+    QString cacheKey() const;
+
+protected:
+    /**
+     * @brief Updates a VTK algorithm used by the stage
+     * @note if the pipeline running this stage was given a cancel flag, the algorithm is aborted
+     *       as soon as the flag is set so a background run can be restarted quickly
+     * @param algorithm the algorithm to update
+     * @return false if the update was cancelled and the output should not be used
+     */
+    static bool updateAlgorithm(vtkAlgorithm* algorithm);
+
+    /**
+     * @brief Gets the cancel flag of the pipeline running this stage on the current thread
+     * @note stages with their own loops (not VTK algorithms) should check it between passes
+     * @return the flag, or nullptr if the run cannot be cancelled
+     */
+    static const std::atomic<bool>* cancelFlag();
+
+    QVariantMap parameters;         /**< Parameters of the stage, sorted by name */
+    bool        enabled = false;    /**< Status of the stage */
+};
+
+
+/**
+ * @brief Registry of every filter stage that can be added to a part's pipeline
+ * @note Filters register themselves with a factory function so new filters can be added
+ *       without changing MainWindow or ModelPart
+ */
+class FilterRegistry {
+public:
+    using Factory = std::function<std::unique_ptr<FilterStage>()>;  /**< Creates a default stage */
+
+    /**
+     * @brief Gets the single registry instance
+     * @return the registry
+     */
+    static FilterRegistry& instance();
+
+    /**
+     * @brief Registers a new filter
+     * @param name unique name of the filter
+     * @param order position of the filter in the default chain, lower values run first
+     * @param factory function creating a stage with default parameters
+     * @return true if the filter was registered, false if the name is already in use
+     */
+    bool registerFilter(const QString& name, int order, Factory factory);
+
+    /**
+     * @brief Creates a stage with default parameters
+     * @param name registered name of the filter
+     * @return the new stage, or nullptr if the name is unknown
+     */
+    std::unique_ptr<FilterStage> create(const QString& name) const;
+
+    /**
+     * @brief Lists the registered filters in chain order
+     * @return list of filter names
+     */
+    QStringList filterNames() const;
+
+private:
+    FilterRegistry() = default;
+
+    /** Registered filter */
+    struct Entry {
+        QString name;
+        int     order;
+        Factory factory;
+    };
+
+    std::vector<Entry> entries;     /**< Registered filters, kept sorted by order */
+};
+
+
+/**
+ * @brief Ordered chain of filter stages belonging to one model part
+ * @note The output of each stage is cached along with the input it was computed from and its
+ *       parameter key, so changing one stage only recomputes that stage and the ones after it.
+ *       Each stage keeps its last few outputs, so toggling a stage off and on again or moving a
+ *       slider back to an earlier value reuses the earlier results instead of recomputing them
+ */
+class FilterPipeline {
+public:
+    /** Called after each stage is run or taken from the cache, with the stage index and its output */
+    using StageCallback = std::function<void(int, vtkSmartPointer<vtkPolyData>)>;
+
+    /**
+     * @brief Constructs a pipeline with one disabled stage for every registered filter
+     */
+    FilterPipeline();
+
+    /**
+     * @brief Copies a pipeline, the stages are cloned and the cached outputs are shared
+     * @param other pipeline to copy
+     */
+    FilterPipeline(const FilterPipeline& other);
+
+    /**
+     * @brief Copies a pipeline, the stages are cloned and the cached outputs are shared
+     * @param other pipeline to copy
+     * @return this pipeline
+     */
+    FilterPipeline& operator=(const FilterPipeline& other);
+
+    /**
+     * @brief Gets a stage by registered name
+     * @param name name of the filter
+     * @return pointer to the stage, or nullptr if the pipeline does not contain it
+     */
+    FilterStage* stage(const QString& name) const;
+
+    /**
+     * @brief Gets the number of stages in the pipeline
+     * @return number of stages
+     */
+    int stageCount() const;
+
+    /**
+     * @brief Gets a stage by position in the chain
+     * @param index position of the stage
+     * @return pointer to the stage
+     */
+    FilterStage* stageAt(int index) const;
+
+    /**
+     * @brief Checks if any stage is enabled
+     * @return true if the pipeline will change the input
+     */
+    bool hasActiveStages() const;
+
+    /**
+     * @brief Runs the pipeline, only the stages whose input or parameters changed are executed
+     * @note each stage runs on a shallow copy of its input, so the cached outputs (and the input) are
+     *       never touched by the VTK pipeline and can be read by other threads while it runs. The
+     *       outputs returned and passed to onStageFinished are the cached objects, callers that show
+     *       them elsewhere must do so through their own shallow copy, see ModelPart::setFilteredOutput()
+     * @param input unfiltered data of the part
+     * @param cancel optional flag, when set by another thread the run stops as soon as possible
+     * @param onStageFinished optional callback used to show progressive results
+     * @return output of the last enabled stage, the input if no stage is enabled, or nullptr if cancelled
+     */
+    vtkSmartPointer<vtkPolyData> update(vtkPolyData* input,
+                                        const std::atomic<bool>* cancel = nullptr,
+                                        const StageCallback& onStageFinished = StageCallback());
+
+    /**
+     * @brief Updates the output of the last enabled stage in place if it is the only stage out of date
+     * @note must only be called on the thread that renders the output, as the rendered data changes.
+     *       Used when e.g. only the shrink factor changed, so no memory is allocated and the mapper
+     *       keeps its input and only re-uploads the points. An output still shared (see shareOutput(),
+     *       e.g. shown in VR) is not rewritten, the stage writes into the entry's spare output instead
+     *       and the two swap, so a shared output only costs a copy when both are held
+     * @param input unfiltered data of the part
+     * @return output of the last enabled stage, or nullptr if update() has to be used instead
+     */
+    vtkSmartPointer<vtkPolyData> updateInPlace(vtkPolyData* input);
+
+    /**
+     * @brief Gets a share of a cached output, while it is kept updateInPlace() never rewrites the output
+     * @note lets another thread render an output without copying it first
+     * @param output an output returned by update() or updateInPlace()
+     * @return the share, null if the output is not in the cache (then no pipeline will ever rewrite it)
+     */
+    std::shared_ptr<int> shareOutput(vtkPolyData* output) const;
+
+    /**
+     * @brief Makes the outputs cached from one input object count as made from another holding the same data
+     * @note the filter worker runs on its own shallow copy of the part's data, this lets the copy and
+     *       the part's data find the same cached outputs. Must be called on the thread that owns both
+     * @param from the input the outputs were made from
+     * @param to the input they should be found with from now on
+     */
+    void replaceInput(vtkPolyData* from, vtkPolyData* to);
+
+    /**
+     * @brief Removes all cached outputs
+     */
+    void clearCache();
+
+private:
+    /** Cached result of one stage */
+    struct CacheEntry {
+        vtkSmartPointer<vtkPolyData> input;         /**< Data the output was computed from */
+        vtkMTimeType                 inputTime = 0; /**< Modified time of the input when computed */
+        QString                      key;           /**< Parameter key when computed */
+        vtkSmartPointer<vtkPolyData> output;        /**< Cached output */
+        std::shared_ptr<int>         owners;        /**< Copied with the entry, so use_count() > 1 while another pipeline shares the output */
+        vtkSmartPointer<vtkPolyData> spare;         /**< Output replaced by updateInPlace() while shared, rewritten next time once nobody holds it */
+        std::shared_ptr<int>         spareOwners;   /**< Owners of the spare output */
+    };
+
+    /**
+     * @brief Finds a cached output of a stage and marks it as most recently used
+     * @param index position of the stage
+     * @param input data given to the stage
+     * @param key current parameter key of the stage
+     * @return the entry, or nullptr if nothing matching is cached
+     */
+    CacheEntry* findEntry(int index, vtkPolyData* input, const QString& key);
+
+    static constexpr size_t CacheEntriesPerStage = 4;  /**< Outputs kept per stage, each can be as large as the part */
+
+    std::vector<std::unique_ptr<FilterStage>>   stages;     /**< Stages in chain order */
+    std::vector<std::vector<CacheEntry>>        cache;      /**< Recent outputs of each stage, most recently used first */
+};
+
+#endif
@@ -0,0 +1,275 @@
+/**     @file FilterStages.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Filter stages available in every part's filter pipeline.
+  */
+
+#include "FilterStages.h"
+#include "ClipKernel.h"
+#include "ShrinkKernel.h"
+#include "SmoothKernel.h"
+#include "MeshValidator.h"
+
+#include <QtGlobal>
+
+#include <vtkPlane.h>
+#include <vtkClipPolyData.h>
+#include <vtkShrinkPolyData.h>
+#include <vtkTriangleFilter.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkSmoothPolyDataFilter.h>
+#include <vtkWindowedSincPolyDataFilter.h>
+#include <vtkPolyDataNormals.h>
+
+/* Each stage registers itself here, a new filter only needs a class and a line below */
+namespace {
+[[maybe_unused]] const bool repairRegistered = FilterRegistry::instance().registerFilter(
+    "repair", 10, [] { return std::unique_ptr<FilterStage>(new RepairFilterStage()); });
+
+[[maybe_unused]] const bool decimateRegistered = FilterRegistry::instance().registerFilter(
+    "decimate", 20, [] { return std::unique_ptr<FilterStage>(new DecimateFilterStage()); });
+
+[[maybe_unused]] const bool smoothRegistered = FilterRegistry::instance().registerFilter(
+    "smooth", 40, [] { return std::unique_ptr<FilterStage>(new SmoothFilterStage()); });
+
+[[maybe_unused]] const bool clipRegistered = FilterRegistry::instance().registerFilter(
+    "clip", 100, [] { return std::unique_ptr<FilterStage>(new ClipFilterStage()); });
+
+[[maybe_unused]] const bool shrinkRegistered = FilterRegistry::instance().registerFilter(
+    "shrink", 200, [] { return std::unique_ptr<FilterStage>(new ShrinkFilterStage()); });
+
+// normals are computed last so they match the final geometry
+[[maybe_unused]] const bool normalsRegistered = FilterRegistry::instance().registerFilter(
+    "normals", 300, [] { return std::unique_ptr<FilterStage>(new NormalsFilterStage()); });
+}
+
+// ----------------------------- Repair filter ----------------------------------
+
+RepairFilterStage::RepairFilterStage() {
+    setParameter("maxHoleEdges", 32);
+}
+
+QString RepairFilterStage::name() const {
+    return "repair";
+}
+
+std::unique_ptr<FilterStage> RepairFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new RepairFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> RepairFilterStage::execute(vtkPolyData* input) const {
+    // the repair works on triangles only
+    vtkSmartPointer<vtkPolyData> triangles = input;
+    if (!MeshValidator::canValidate(input)) {
+        auto triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+        triangleFilter->SetInputData(input);
+        triangleFilter->PassVertsOff();
+        triangleFilter->PassLinesOff();
+        if (!updateAlgorithm(triangleFilter))
+            return nullptr;
+        triangles = triangleFilter->GetOutput();
+    }
+
+    if (!MeshValidator::canValidate(triangles)) {
+        auto output = vtkSmartPointer<vtkPolyData>::New();
+        output->ShallowCopy(triangles);
+        return output;
+    }
+
+    return MeshValidator::repair(triangles, parameter("maxHoleEdges").toInt(), cancelFlag());
+}
+
+// ----------------------------- Decimate filter ----------------------------------
+
+DecimateFilterStage::DecimateFilterStage() {
+    setParameter("targetTriangles", 100000);
+}
+
+QString DecimateFilterStage::name() const {
+    return "decimate";
+}
+
+std::unique_ptr<FilterStage> DecimateFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new DecimateFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> DecimateFilterStage::execute(vtkPolyData* input) const {
+    const vtkIdType target = parameter("targetTriangles").toLongLong();
+    const vtkIdType cells = input->GetNumberOfPolys() + input->GetNumberOfStrips();
+
+    // already small enough, pass the part through
+    if (cells <= target || cells == 0) {
+        auto output = vtkSmartPointer<vtkPolyData>::New();
+        output->ShallowCopy(input);
+        return output;
+    }
+
+    // quadric decimation only reads triangles
+    vtkSmartPointer<vtkPolyData> triangles = input;
+    if (input->GetNumberOfStrips() > 0 || input->GetPolys()->IsHomogeneous() != 3) {
+        auto triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+        triangleFilter->SetInputData(input);
+        if (!updateAlgorithm(triangleFilter))
+            return nullptr;
+        triangles = triangleFilter->GetOutput();
+    }
+
+    auto decimate = vtkSmartPointer<vtkQuadricDecimation>::New();
+    decimate->SetInputData(triangles);
+    decimate->SetTargetReduction(1.0 - static_cast<double>(target) / triangles->GetNumberOfPolys());
+    decimate->VolumePreservationOn();
+    if (!updateAlgorithm(decimate))
+        return nullptr;
+
+    return decimate->GetOutput();
+}
+
+// ----------------------------- Smooth filter ----------------------------------
+
+SmoothFilterStage::SmoothFilterStage() {
+    setParameter("method", QString("taubin"));
+    setParameter("iterations", 10);
+    setParameter("lambda", 0.5);
+    setParameter("mu", -0.53);
+}
+
+QString SmoothFilterStage::name() const {
+    return "smooth";
+}
+
+std::unique_ptr<FilterStage> SmoothFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new SmoothFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> SmoothFilterStage::execute(vtkPolyData* input) const {
+    const bool taubin = parameter("method").toString() == "taubin";
+    const int iterations = parameter("iterations").toInt();
+    const double lambda = parameter("lambda").toDouble();
+
+    // triangle meshes (all STL parts) use the multi-threaded kernel
+    if (SmoothKernel::canSmooth(input))
+        return SmoothKernel::smooth(input, iterations, lambda, taubin ? parameter("mu").toDouble() : 0.0, cancelFlag());
+
+    // VTK's closest equivalent of Taubin smoothing is the windowed sinc filter
+    if (taubin) {
+        auto smoothFilter = vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+        smoothFilter->SetInputData(input);
+        smoothFilter->SetNumberOfIterations(iterations);
+        smoothFilter->NormalizeCoordinatesOn();
+        if (!updateAlgorithm(smoothFilter))
+            return nullptr;
+        return smoothFilter->GetOutput();
+    }
+
+    auto smoothFilter = vtkSmartPointer<vtkSmoothPolyDataFilter>::New();
+    smoothFilter->SetInputData(input);
+    smoothFilter->SetNumberOfIterations(iterations);
+    smoothFilter->SetRelaxationFactor(lambda);
+    if (!updateAlgorithm(smoothFilter))
+        return nullptr;
+    return smoothFilter->GetOutput();
+}
+
+// ----------------------------- Clip filter ----------------------------------
+
+ClipFilterStage::ClipFilterStage() {
+    setParameter("origin", 0.0);
+    setParameter("normalX", -1.0);
+    setParameter("normalY", 0.0);
+    setParameter("normalZ", 0.0);
+}
+
+QString ClipFilterStage::name() const {
+    return "clip";
+}
+
+std::unique_ptr<FilterStage> ClipFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new ClipFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> ClipFilterStage::execute(vtkPolyData* input) const {
+    double origin[3] = { parameter("origin").toDouble(), 0, 0 };
+    double normal[3] = { parameter("normalX").toDouble(),
+                         parameter("normalY").toDouble(),
+                         parameter("normalZ").toDouble() };
+
+    // triangle meshes (all STL parts) use the multi-threaded kernel
+    if (ClipKernel::canClip(input))
+        return ClipKernel::clipPlane(input, origin, normal, cancelFlag());
+
+    // creating the clipping plane
+    auto plane = vtkSmartPointer<vtkPlane>::New();
+    plane->SetOrigin(origin);
+    plane->SetNormal(normal);
+
+    //applying the clipping filter to the part
+    auto clipFilter = vtkSmartPointer<vtkClipPolyData>::New();
+    clipFilter->SetInputData(input);
+    clipFilter->SetClipFunction(plane);
+    if (!updateAlgorithm(clipFilter))
+        return nullptr;
+
+    return clipFilter->GetOutput();
+}
+
+// ----------------------------- Shrink filter ----------------------------------
+
+ShrinkFilterStage::ShrinkFilterStage() {
+    setParameter("factor", 0.8);
+}
+
+QString ShrinkFilterStage::name() const {
+    return "shrink";
+}
+
+std::unique_ptr<FilterStage> ShrinkFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new ShrinkFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> ShrinkFilterStage::execute(vtkPolyData* input) const {
+    // triangle meshes (all STL parts) use the multi-threaded kernel
+    if (ShrinkKernel::canShrink(input))
+        return ShrinkKernel::shrink(input, parameter("factor").toDouble());
+
+    // setup the shrink filter
+    auto shrinkFilter = vtkSmartPointer<vtkShrinkPolyData>::New();
+    shrinkFilter->SetInputData(input);
+    shrinkFilter->SetShrinkFactor(parameter("factor").toDouble());
+    if (!updateAlgorithm(shrinkFilter))
+        return nullptr;
+
+    return shrinkFilter->GetOutput();
+}
+
+bool ShrinkFilterStage::updateInPlace(vtkPolyData* input, vtkPolyData* output) const {
+    return ShrinkKernel::shrinkInto(input, parameter("factor").toDouble(), output);
+}
+
+// ----------------------------- Normals filter ----------------------------------
+
+NormalsFilterStage::NormalsFilterStage() {
+    setParameter("creaseAngle", 30.0);
+}
+
+QString NormalsFilterStage::name() const {
+    return "normals";
+}
+
+std::unique_ptr<FilterStage> NormalsFilterStage::clone() const {
+    return std::unique_ptr<FilterStage>(new NormalsFilterStage(*this));
+}
+
+vtkSmartPointer<vtkPolyData> NormalsFilterStage::execute(vtkPolyData* input) const {
+    // points on edges sharper than the crease angle are split so both sides keep their own normal
+    auto normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+    normals->SetInputData(input);
+    normals->SetFeatureAngle(parameter("creaseAngle").toDouble());
+    normals->SplittingOn();
+    normals->ComputePointNormalsOn();
+    normals->ComputeCellNormalsOff();
+    if (!updateAlgorithm(normals))
+        return nullptr;
+
+    return normals->GetOutput();
+}
@@ -0,0 +1,112 @@
+/**     @file FilterStages.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Filter stages available in every part's filter pipeline.
+  */
+
+#ifndef VIEWER_FILTERSTAGES_H
+#define VIEWER_FILTERSTAGES_H
+
+#include "FilterPipeline.h"
+
+/**
+ * @brief Repairs broken meshes before any other filter runs
+ * @note Parameters: "maxHoleEdges", the largest hole that is closed. See MeshValidator::repair()
+ */
+class RepairFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage filling holes of up to 32 edges
+     */
+    RepairFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+};
+
+/**
+ * @brief Reduces the number of triangles of the part with quadric decimation
+ * @note Parameters: "targetTriangles", parts with fewer triangles are passed through unchanged
+ */
+class DecimateFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage with a target of 100000 triangles
+     */
+    DecimateFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+};
+
+/**
+ * @brief Smooths the surface of the part to remove scan noise
+ * @note Parameters: "method" ("laplacian" or "taubin"), "iterations", "lambda" and "mu" (Taubin only).
+ *       Triangle meshes use the multi-threaded SmoothKernel
+ */
+class SmoothFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage with 10 Taubin iterations
+     */
+    SmoothFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+};
+
+/**
+ * @brief Clips the part with a plane
+ * @note Parameters: "origin" (x position of the plane), "normalX", "normalY", "normalZ"
+ */
+class ClipFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage with the plane at x = 0 facing -x
+     */
+    ClipFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+};
+
+/**
+ * @brief Shrinks every cell of the part towards its centre
+ * @note Parameters: "factor" in the range (0->1). Triangle meshes use the multi-threaded
+ *       ShrinkKernel, which can rewrite its last output in place when only the factor changes
+ */
+class ShrinkFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage with a shrink factor of 0.8
+     */
+    ShrinkFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+    bool updateInPlace(vtkPolyData* input, vtkPolyData* output) const override;
+};
+
+/**
+ * @brief Computes point normals so the part is shaded smoothly instead of showing flat facets
+ * @note Parameters: "creaseAngle" in degrees, edges sharper than this stay sharp
+ */
+class NormalsFilterStage : public FilterStage {
+public:
+    /**
+     * @brief Constructs the stage with a crease angle of 30 degrees
+     */
+    NormalsFilterStage();
+
+    QString name() const override;
+    std::unique_ptr<FilterStage> clone() const override;
+    vtkSmartPointer<vtkPolyData> execute(vtkPolyData* input) const override;
+};
+
+#endif
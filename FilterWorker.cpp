@@ -0,0 +1,202 @@
+/**     @file FilterWorker.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Background thread that runs a part's filter pipeline so the GUI
+  *     never waits for a filter to finish.
+  */
+
+#include "FilterWorker.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <algorithm>
+
+FilterWorker::FilterWorker(QObject* parent) : QThread(parent) {
+    start(QThread::LowPriority);
+}
+
+FilterWorker::~FilterWorker() {
+    {
+        QMutexLocker lock(&mutex);
+        quit = true;
+        cancelled = true;
+        quitting = true;
+        condition.wakeAll();
+    }
+    wait();
+}
+
+FilterWorker::Job FilterWorker::makeJob(int generation, const FilterPipeline& pipeline, vtkSmartPointer<vtkPolyData> input) {
+    /* The worker gets its own data object, only the arrays are shared with the part. The GUI mapper
+     * renders the part's data and VTK builds its cells, links and bounds lazily, so the two threads
+     * must never use the same object. The cache is moved over to the copy so no stage is re-run */
+    auto copy = vtkSmartPointer<vtkPolyData>::New();
+    copy->ShallowCopy(input);
+
+    Job job;
+    job.generation = generation;
+    job.pipeline = pipeline;
+    job.pipeline.replaceInput(input, copy);
+    job.input = copy;
+    job.source = input;
+    return job;
+}
+
+void FilterWorker::submit(int generation, const FilterPipeline& pipeline, vtkSmartPointer<vtkPolyData> input) {
+    Job job = makeJob(generation, pipeline, input);
+
+    QMutexLocker lock(&mutex);
+    preview = job;
+    hasPreview = true;
+
+    /* Abort the preview being run, the thread picks up the new request straight after */
+    cancelled = true;
+    condition.wakeAll();
+}
+
+void FilterWorker::submitBatch(const QList<Request>& requests) {
+    if (requests.isEmpty())
+        return;
+
+    QList<Job> batch;
+    batch.reserve(requests.size());
+    for (const Request& request : requests)
+        batch.append(makeJob(request.generation, request.pipeline, request.input));
+
+    QMutexLocker lock(&mutex);
+    batches.append(batch);
+    condition.wakeAll();
+}
+
+void FilterWorker::cancel() {
+    QMutexLocker lock(&mutex);
+    hasPreview = false;
+    preview = Job();
+    cancelled = true;
+}
+
+QList<FilterWorker::Result> FilterWorker::takeResults() {
+    QMutexLocker lock(&mutex);
+    QList<Result> taken;
+    taken.swap(results);
+    lock.unlock();
+
+    for (Result& result : taken) {
+        if (result.finished)
+            result.pipeline.replaceInput(result.input, result.source);
+    }
+    return taken;
+}
+
+void FilterWorker::run() {
+    forever {
+        QList<Job> batch;
+        {
+            QMutexLocker lock(&mutex);
+            while (!hasPreview && batches.isEmpty() && !quit)
+                condition.wait(&mutex);
+            if (quit)
+                return;
+            if (!hasPreview)
+                batch = batches.takeFirst();
+        }
+
+        if (batch.isEmpty()) {
+            runPreview();
+            continue;
+        }
+
+        /* The whole batch goes back in one go, so the GUI updates the tree and view once */
+        QList<Result> finished;
+        finished.reserve(batch.size());
+        for (Job& job : batch) {
+            runPreview();       // the part being edited is not held up by the rest of the batch
+
+            Result result = runBatchJob(job);
+            if (quitting)
+                return;
+            if (result.output)
+                finished.append(result);
+        }
+
+        {
+            QMutexLocker lock(&mutex);
+            results.append(finished);
+        }
+        emit resultReady();
+    }
+}
+
+void FilterWorker::runPreview() {
+    Job job;
+    {
+        QMutexLocker lock(&mutex);
+        if (!hasPreview)
+            return;
+        job = preview;
+        preview = Job();
+        hasPreview = false;
+        cancelled = false;
+    }
+
+    /* Each finished stage is published straight away as a preview. If the GUI is slower
+     * than the filters only the newest preview is kept, so the GUI never falls behind. The
+     * outputs stay with the cache, the GUI only renders its own shallow copy of them */
+    auto dropPreviews = [this]() {
+        results.erase(std::remove_if(results.begin(), results.end(), [](const Result& result) { return !result.finished; }), results.end());
+    };
+    auto publishPreview = [&](int, vtkSmartPointer<vtkPolyData> output) {
+        QMutexLocker lock(&mutex);
+        if (cancelled)
+            return;
+        Result result;
+        result.generation = job.generation;
+        result.output = output;
+        result.outputShare = job.pipeline.shareOutput(output);
+        dropPreviews();
+        results.append(result);
+        lock.unlock();
+        emit resultReady();
+    };
+
+    vtkSmartPointer<vtkPolyData> output = job.pipeline.update(job.input, &cancelled, publishPreview);
+
+    if (!output) {
+        qDebug() << "Filter request" << job.generation << "cancelled";
+        return;
+    }
+
+    {
+        QMutexLocker lock(&mutex);
+        if (cancelled)
+            return;
+        Result result;
+        result.generation = job.generation;
+        result.finished = true;
+        result.output = output;
+        result.outputShare = job.pipeline.shareOutput(output);
+        result.pipeline = job.pipeline;
+        result.input = job.input;
+        result.source = job.source;
+        dropPreviews();
+        results.append(result);
+    }
+    emit resultReady();
+}
+
+FilterWorker::Result FilterWorker::runBatchJob(Job& job) {
+    Result result;
+    result.generation = job.generation;
+    result.output = job.pipeline.update(job.input, &quitting);
+    if (!result.output)
+        return result;
+
+    result.finished = true;
+    result.outputShare = job.pipeline.shareOutput(result.output);
+    result.pipeline = job.pipeline;
+    result.input = job.input;
+    result.source = job.source;
+    return result;
+}
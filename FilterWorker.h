@@ -0,0 +1,138 @@
+/**     @file FilterWorker.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Background thread that runs a part's filter pipeline so the GUI
+  *     never waits for a filter to finish.
+  */
+
+#ifndef VIEWER_FILTERWORKER_H
+#define VIEWER_FILTERWORKER_H
+
+#include "FilterPipeline.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+#include <atomic>
+
+/**
+ * @brief Runs filter pipelines on a separate thread
+ * @note There are two kinds of request. A preview request (submit()) is for the part being edited:
+ *       only the newest one matters, submitting one cancels the one being run (VTK filters are
+ *       aborted part way through) and each finished stage is sent back as a preview. A batch
+ *       (submitBatch()) filters several parts, e.g. a filter change applied to a selection: batches
+ *       run in order and are never cancelled by a preview, a preview waiting is run between two
+ *       parts of a batch, and the results of a whole batch are sent back together. Results are
+ *       collected from the GUI thread with takeResults() after resultReady() is emitted.
+ */
+class FilterWorker : public QThread {
+    Q_OBJECT
+
+public:
+    /** A part to filter */
+    struct Request {
+        int                           generation = -1;  /**< Number identifying the request, returned with its result */
+        FilterPipeline                pipeline;         /**< Copy of the part's pipeline (the cache is shared, not copied) */
+        vtkSmartPointer<vtkPolyData>  input;            /**< Unfiltered data of the part, only read (through a shallow copy) by the worker */
+    };
+
+    /** A result of a request, either a progressive preview or the final output */
+    struct Result {
+        int                           generation = -1;  /**< Generation of the request this came from */
+        bool                          finished = false; /**< True when every stage has been run */
+        vtkSmartPointer<vtkPolyData>  output;           /**< Output of the last stage run so far */
+        std::weak_ptr<int>            outputShare;      /**< Cache entry holding output, see FilterPipeline::shareOutput() */
+        FilterPipeline                pipeline;         /**< Pipeline with its cache filled in, only valid when finished */
+        vtkSmartPointer<vtkPolyData>  input;            /**< The worker's copy of the part's data */
+        vtkSmartPointer<vtkPolyData>  source;           /**< The part's data, the finished pipeline's cache refers to it again once taken */
+    };
+
+    /**
+     * @brief Constructs the worker, the thread is started straight away
+     * @param parent Optional parent object
+     */
+    explicit FilterWorker(QObject* parent = nullptr);
+
+    /**
+     * @brief Stops the thread and waits for it to finish
+     */
+    ~FilterWorker();
+
+    /**
+     * @brief Requests a preview run of a pipeline, replacing any preview request that has not finished
+     * @param generation number identifying the request, returned with its results
+     * @param pipeline copy of the part's pipeline (the cache is shared, not copied)
+     * @param input unfiltered data of the part, only read (through a shallow copy) by the worker
+     */
+    void submit(int generation, const FilterPipeline& pipeline, vtkSmartPointer<vtkPolyData> input);
+
+    /**
+     * @brief Requests that several pipelines be run, their results are sent back together
+     * @param requests one request per part, each with its own generation
+     */
+    void submitBatch(const QList<Request>& requests);
+
+    /**
+     * @brief Cancels the current preview request without starting a new one, batches carry on
+     */
+    void cancel();
+
+    /**
+     * @brief Takes the results made since the last call, only the newest preview is kept
+     * @note a finished pipeline's cache is moved from the worker's copy of the data back to the part's data
+     * @return the results, oldest first
+     */
+    QList<Result> takeResults();
+
+signals:
+    /**
+     * @brief Emitted from the worker thread when new results can be taken
+     */
+    void resultReady();
+
+protected:
+    /** This is a re-implementation of a QThread function
+      */
+    void run() override;
+
+private:
+    /** A part waiting to be filtered */
+    struct Job {
+        int                          generation = -1;
+        FilterPipeline               pipeline;
+        vtkSmartPointer<vtkPolyData> input;     /**< Shallow copy of source, only used by the worker */
+        vtkSmartPointer<vtkPolyData> source;    /**< The part's data, never touched by the worker */
+    };
+
+    /**
+     * @brief Gives a request its own copy of the part's data, see submit()
+     */
+    static Job makeJob(int generation, const FilterPipeline& pipeline, vtkSmartPointer<vtkPolyData> input);
+
+    /**
+     * @brief Runs the waiting preview request if there is one, sending back each stage as it finishes
+     */
+    void runPreview();
+
+    /**
+     * @brief Runs the filters of one part of a batch
+     * @return the finished result, output is null if the run was aborted
+     */
+    Result runBatchJob(Job& job);
+
+    QMutex              mutex;          /**< Protects everything below except the atomics */
+    QWaitCondition      condition;      /**< Wakes the thread when a request arrives */
+    Job                 preview;        /**< Newest preview request not yet started */
+    bool                hasPreview = false;
+    QList<QList<Job>>   batches;        /**< Batches not yet started, oldest first */
+    QList<Result>       results;        /**< Results not yet taken */
+    bool                quit = false;   /**< Set by the destructor to end the thread */
+
+    std::atomic<bool>   cancelled{ false }; /**< Set to abort the preview request being run */
+    std::atomic<bool>   quitting{ false };  /**< Set by the destructor to abort a batch being run */
+};
+
+#endif
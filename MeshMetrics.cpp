@@ -0,0 +1,122 @@
+/**     @file MeshMetrics.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Surface area, volume, triangle count and size of a part, computed in
+  *     parallel when the part is loaded.
+  */
+
+#include "MeshMetrics.h"
+
+#include <vtkSMPTools.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <cmath>
+
+namespace {
+
+/* Partial sums of one thread */
+struct Sums {
+    vtkIdType triangles = 0;
+    double    area = 0.0;
+    double    volume = 0.0;
+};
+
+/* vtkSMPTools functor, each thread accumulates into its own Sums and Reduce() adds them up */
+template <typename P, typename IdT>
+struct MetricsFunctor {
+    const P*    points;
+    const IdT*  offsets;
+    const IdT*  conn;
+    vtkSMPThreadLocal<Sums> local;
+    Sums        total;
+
+    void Initialize() { local.Local() = Sums(); }
+
+    void operator()(vtkIdType first, vtkIdType last) {
+        Sums& sums = local.Local();
+        double area = 0.0, volume = 0.0;
+
+        for (vtkIdType cell = first; cell < last; ++cell) {
+            const IdT begin = offsets[cell], end = offsets[cell + 1];
+            if (end - begin < 3)
+                continue;
+
+            // polygons are split into a fan around their first point
+            const P* a = points + 3 * conn[begin];
+            for (IdT i = begin + 1; i + 1 < end; ++i) {
+                const P* b = points + 3 * conn[i];
+                const P* c = points + 3 * conn[i + 1];
+
+                const double ab[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+                const double ac[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+                const double cross[3] = { ab[1] * ac[2] - ab[2] * ac[1],
+                                          ab[2] * ac[0] - ab[0] * ac[2],
+                                          ab[0] * ac[1] - ab[1] * ac[0] };
+
+                area += std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+                // signed volume of the tetrahedron made with the origin, a . (ab x ac) = a . (b x c)
+                volume += a[0] * cross[0] + a[1] * cross[1] + a[2] * cross[2];
+                ++sums.triangles;
+            }
+        }
+
+        sums.area += 0.5 * area;
+        sums.volume += volume / 6.0;
+    }
+
+    void Reduce() {
+        for (const Sums& sums : local) {
+            total.triangles += sums.triangles;
+            total.area += sums.area;
+            total.volume += sums.volume;
+        }
+    }
+};
+
+template <typename P, typename IdT>
+Sums sumPolys(const P* points, const IdT* offsets, const IdT* conn, vtkIdType cells) {
+    MetricsFunctor<P, IdT> functor{ points, offsets, conn };
+    vtkSMPTools::For(0, cells, functor);
+    return functor.total;
+}
+
+template <typename P>
+Sums sumPolys(const P* points, vtkCellArray* polys) {
+    if (polys->IsStorage64Bit())
+        return sumPolys(points, polys->GetOffsetsArray64()->GetPointer(0),
+                        polys->GetConnectivityArray64()->GetPointer(0), polys->GetNumberOfCells());
+    return sumPolys(points, polys->GetOffsetsArray32()->GetPointer(0),
+                    polys->GetConnectivityArray32()->GetPointer(0), polys->GetNumberOfCells());
+}
+}
+
+MeshMetrics MeshMetrics::compute(vtkPolyData* data) {
+    MeshMetrics metrics;
+    if (!data || !data->GetPoints() || data->GetNumberOfPoints() == 0)
+        return metrics;
+
+    double bounds[6];
+    data->GetBounds(bounds);
+    for (int k = 0; k < 3; ++k)
+        metrics.size[k] = bounds[2 * k + 1] - bounds[2 * k];
+
+    vtkPoints* points = data->GetPoints();
+    vtkCellArray* polys = data->GetPolys();
+    Sums sums;
+    if (points->GetDataType() == VTK_FLOAT)
+        sums = sumPolys(static_cast<const float*>(points->GetVoidPointer(0)), polys);
+    else if (points->GetDataType() == VTK_DOUBLE)
+        sums = sumPolys(static_cast<const double*>(points->GetVoidPointer(0)), polys);
+
+    metrics.triangles = sums.triangles;
+    metrics.area = sums.area;
+    metrics.volume = std::abs(sums.volume);   // negative if the triangles face inwards
+    metrics.valid = true;
+    return metrics;
+}
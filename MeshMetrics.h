@@ -0,0 +1,37 @@
+/**     @file MeshMetrics.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Surface area, volume, triangle count and size of a part, computed in
+  *     parallel when the part is loaded.
+  */
+
+#ifndef VIEWER_MESHMETRICS_H
+#define VIEWER_MESHMETRICS_H
+
+#include <vtkType.h>
+#include <vtkPolyData.h>
+
+/**
+ * @brief Measurements of a part used for QA and shown as columns in the tree view
+ * @note Volume is the volume enclosed by the surface, it is only meaningful for closed meshes
+ */
+struct MeshMetrics {
+    bool        valid = false;              /**< False until computed from a loaded part */
+    vtkIdType   triangles = 0;              /**< Number of triangles */
+    double      area = 0.0;                 /**< Total surface area */
+    double      volume = 0.0;               /**< Enclosed volume */
+    double      size[3] = { 0.0, 0.0, 0.0 };/**< Bounding box dimensions in x, y and z */
+
+    /**
+     * @brief Measures a mesh
+     * @note triangles are processed in parallel with vtkSMPTools, each thread sums its own
+     *       area and volume and the partial sums are added at the end. Polygons with more than
+     *       three points are measured as triangle fans
+     * @param data the mesh to measure
+     * @return the metrics, not valid if the data has no points
+     */
+    static MeshMetrics compute(vtkPolyData* data);
+};
+
+#endif
@@ -0,0 +1,503 @@
+/**     @file MeshValidator.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Parallel detection and repair of common STL defects: degenerate
+  *     triangles, non-manifold edges, inconsistent orientation and holes.
+  */
+
+#include "MeshValidator.h"
+
+#include <QDebug>
+
+#include <vtkSMPTools.h>
+#include <vtkSMPThreadLocal.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkIdTypeArray.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const int ShardCount = 64;      // edge map shards, each merged by one task
+
+/* Edge between two points, always stored with the smaller id first */
+struct Edge {
+    vtkIdType a;
+    vtkIdType b;
+    bool operator==(const Edge& other) const { return a == other.a && b == other.b; }
+};
+
+struct EdgeHash {
+    size_t operator()(const Edge& e) const {
+        uint64_t h = static_cast<uint64_t>(e.a) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint64_t>(e.b) + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+/* One triangle using an edge, forward if the triangle runs along it from a to b */
+struct EdgeUse {
+    Edge      edge;
+    vtkIdType triangle;
+    bool      forward;
+};
+
+/* Everything known about an edge, the first two triangles are kept to link neighbours */
+struct EdgeInfo {
+    int       count = 0;
+    int       forwardCount = 0;
+    vtkIdType triangles[2] = { -1, -1 };
+    bool      forward[2] = { false, false };
+};
+
+using EdgeShard = std::unordered_map<Edge, EdgeInfo, EdgeHash>;
+
+int shardOf(const Edge& e) {
+    return static_cast<int>((EdgeHash()(e) >> 7) % ShardCount);
+}
+
+bool isCancelled(const std::atomic<bool>* cancel) {
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+
+/* Calls f with a pointer to the point coordinates as float or double */
+template <typename F>
+void withPointData(vtkPoints* points, F&& f) {
+    if (points->GetDataType() == VTK_FLOAT)
+        f(static_cast<const float*>(points->GetVoidPointer(0)));
+    else
+        f(static_cast<const double*>(points->GetVoidPointer(0)));
+}
+
+/* Copies the triangle connectivity into one array, three ids per triangle */
+template <typename IdT>
+void copyTriangles(const IdT* conn, std::vector<vtkIdType>& tris) {
+    vtkSMPTools::For(0, static_cast<vtkIdType>(tris.size()), [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; ++i)
+            tris[i] = conn[i];
+    });
+}
+
+std::vector<vtkIdType> readTriangles(vtkPolyData* input) {
+    vtkCellArray* polys = input->GetPolys();
+    std::vector<vtkIdType> tris(3 * polys->GetNumberOfCells());
+    if (polys->IsStorage64Bit())
+        copyTriangles(polys->GetConnectivityArray64()->GetPointer(0), tris);
+    else
+        copyTriangles(polys->GetConnectivityArray32()->GetPointer(0), tris);
+    return tris;
+}
+
+/* Builds the edge map of the triangles not flagged as removed */
+std::vector<EdgeShard> buildEdgeMap(const std::vector<vtkIdType>& tris, const std::vector<uint8_t>& removed) {
+    const vtkIdType nTris = static_cast<vtkIdType>(tris.size() / 3);
+
+    // every thread sorts the edges of its triangles into its own per shard lists
+    vtkSMPThreadLocal<std::vector<std::vector<EdgeUse>>> local;
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        std::vector<std::vector<EdgeUse>>& buckets = local.Local();
+        if (buckets.empty())
+            buckets.resize(ShardCount);
+
+        for (vtkIdType t = first; t < last; ++t) {
+            if (removed[t])
+                continue;
+            for (int k = 0; k < 3; ++k) {
+                vtkIdType a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+                Edge e = a < b ? Edge{ a, b } : Edge{ b, a };
+                buckets[shardOf(e)].push_back({ e, t, a < b });
+            }
+        }
+    });
+
+    std::vector<std::vector<EdgeUse>*> threadBuckets;
+    for (std::vector<std::vector<EdgeUse>>& buckets : local) {
+        if (!buckets.empty())
+            threadBuckets.push_back(&buckets);
+    }
+
+    // each shard is only written by the task merging it
+    std::vector<EdgeShard> shards(ShardCount);
+    vtkSMPTools::For(0, ShardCount, 1, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType s = first; s < last; ++s) {
+            size_t uses = 0;
+            for (const auto* buckets : threadBuckets)
+                uses += (*buckets)[s].size();
+
+            EdgeShard& shard = shards[s];
+            shard.reserve(uses / 2 + 1);
+            for (const auto* buckets : threadBuckets) {
+                for (const EdgeUse& use : (*buckets)[s]) {
+                    EdgeInfo& info = shard[use.edge];
+                    if (info.count < 2) {
+                        info.triangles[info.count] = use.triangle;
+                        info.forward[info.count] = use.forward;
+                    }
+                    ++info.count;
+                    info.forwardCount += use.forward ? 1 : 0;
+                }
+            }
+        }
+    });
+    return shards;
+}
+
+/* Flags triangles with repeated points or no area, the area test is relative to the edge
+ * lengths so it works for parts of any scale */
+template <typename P>
+vtkIdType markDegenerate(const P* p, const std::vector<vtkIdType>& tris, std::vector<uint8_t>& removed) {
+    const vtkIdType nTris = static_cast<vtkIdType>(tris.size() / 3);
+    vtkSMPThreadLocal<vtkIdType> count(0);
+
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        vtkIdType& found = count.Local();
+        for (vtkIdType t = first; t < last; ++t) {
+            vtkIdType ia = tris[3 * t], ib = tris[3 * t + 1], ic = tris[3 * t + 2];
+            bool degenerate = ia == ib || ib == ic || ic == ia;
+
+            if (!degenerate) {
+                const P* a = p + 3 * ia;
+                const P* b = p + 3 * ib;
+                const P* c = p + 3 * ic;
+                const double ab[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+                const double ac[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+                const double cross[3] = { ab[1] * ac[2] - ab[2] * ac[1],
+                                          ab[2] * ac[0] - ab[0] * ac[2],
+                                          ab[0] * ac[1] - ab[1] * ac[0] };
+                const double cross2 = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+                const double ab2 = ab[0] * ab[0] + ab[1] * ab[1] + ab[2] * ab[2];
+                const double ac2 = ac[0] * ac[0] + ac[1] * ac[1] + ac[2] * ac[2];
+
+                // sin^2 of the angle at a below 1e-12
+                degenerate = cross2 <= 1e-12 * ab2 * ac2;
+            }
+
+            removed[t] = degenerate ? 1 : 0;
+            if (degenerate)
+                ++found;
+        }
+    });
+
+    vtkIdType total = 0;
+    for (vtkIdType found : count)
+        total += found;
+    return total;
+}
+
+vtkIdType markDegenerate(vtkPolyData* input, const std::vector<vtkIdType>& tris, std::vector<uint8_t>& removed) {
+    vtkIdType count = 0;
+    withPointData(input->GetPoints(), [&](auto* p) { count = markDegenerate(p, tris, removed); });
+    return count;
+}
+
+/* Counts the loops formed by the boundary edges with a union-find over their points */
+vtkIdType countLoops(const std::vector<Edge>& boundary) {
+    std::unordered_map<vtkIdType, vtkIdType> parent;
+    parent.reserve(2 * boundary.size());
+
+    auto find = [&parent](vtkIdType v) {
+        vtkIdType root = v;
+        while (parent[root] != root)
+            root = parent[root];
+        while (parent[v] != root) {
+            vtkIdType next = parent[v];
+            parent[v] = root;
+            v = next;
+        }
+        return root;
+    };
+
+    vtkIdType loops = 0;
+    for (const Edge& e : boundary) {
+        for (vtkIdType v : { e.a, e.b }) {
+            if (parent.emplace(v, v).second)
+                ++loops;
+        }
+        vtkIdType ra = find(e.a), rb = find(e.b);
+        if (ra != rb) {
+            parent[ra] = rb;
+            --loops;
+        }
+    }
+    return loops;
+}
+
+/* Edge statistics of a mesh, counted per shard in parallel */
+struct EdgeCounts {
+    vtkIdType         nonManifold = 0;
+    vtkIdType         misoriented = 0;
+    std::vector<Edge> boundary;
+};
+
+EdgeCounts countEdges(const std::vector<EdgeShard>& shards) {
+    std::vector<EdgeCounts> perShard(ShardCount);
+    vtkSMPTools::For(0, ShardCount, 1, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType s = first; s < last; ++s) {
+            EdgeCounts& counts = perShard[s];
+            for (const auto& entry : shards[s]) {
+                const EdgeInfo& info = entry.second;
+                if (info.count == 1)
+                    counts.boundary.push_back(entry.first);
+                else if (info.count > 2)
+                    ++counts.nonManifold;
+                else if (info.forwardCount != 1)
+                    ++counts.misoriented;   // both triangles run along the edge the same way
+            }
+        }
+    });
+
+    EdgeCounts total;
+    for (EdgeCounts& counts : perShard) {
+        total.nonManifold += counts.nonManifold;
+        total.misoriented += counts.misoriented;
+        total.boundary.insert(total.boundary.end(), counts.boundary.begin(), counts.boundary.end());
+    }
+    return total;
+}
+
+/* Signed volume enclosed by each connected piece, negative if the piece faces inwards */
+template <typename P>
+std::vector<double> pieceVolumes(const P* p, const std::vector<vtkIdType>& tris, const std::vector<uint8_t>& removed,
+                                 const std::vector<int>& piece, int pieces) {
+    std::vector<double> volumes(pieces, 0.0);
+    for (size_t t = 0; t < removed.size(); ++t) {
+        if (removed[t])
+            continue;
+        const P* a = p + 3 * tris[3 * t];
+        const P* b = p + 3 * tris[3 * t + 1];
+        const P* c = p + 3 * tris[3 * t + 2];
+        volumes[piece[t]] += (a[0] * (double(b[1]) * c[2] - double(b[2]) * c[1]) +
+                              a[1] * (double(b[2]) * c[0] - double(b[0]) * c[2]) +
+                              a[2] * (double(b[0]) * c[1] - double(b[1]) * c[0])) / 6.0;
+    }
+    return volumes;
+}
+
+/* Turns every triangle to face the same way as its neighbours, then turns each piece outwards */
+void unifyOrientation(vtkPolyData* input, std::vector<vtkIdType>& tris, const std::vector<uint8_t>& removed,
+                      const std::vector<EdgeShard>& shards) {
+    const vtkIdType nTris = static_cast<vtkIdType>(removed.size());
+
+    // neighbours across manifold edges, same is set if both triangles run along the edge the same way
+    std::vector<vtkIdType> neighbour(3 * nTris, -1);
+    std::vector<uint8_t> same(3 * nTris, 0);
+    std::vector<uint8_t> neighbourCount(nTris, 0);
+    for (const EdgeShard& shard : shards) {
+        for (const auto& entry : shard) {
+            const EdgeInfo& info = entry.second;
+            if (info.count != 2)
+                continue;
+            const vtkIdType t0 = info.triangles[0], t1 = info.triangles[1];
+            const uint8_t sameWay = info.forward[0] == info.forward[1] ? 1 : 0;
+            neighbour[3 * t0 + neighbourCount[t0]] = t1;
+            same[3 * t0 + neighbourCount[t0]++] = sameWay;
+            neighbour[3 * t1 + neighbourCount[t1]] = t0;
+            same[3 * t1 + neighbourCount[t1]++] = sameWay;
+        }
+    }
+
+    std::vector<uint8_t> flip(nTris, 0);
+    std::vector<int> piece(nTris, -1);
+    std::vector<vtkIdType> stack;
+    int pieces = 0;
+
+    for (vtkIdType seed = 0; seed < nTris; ++seed) {
+        if (removed[seed] || piece[seed] >= 0)
+            continue;
+
+        piece[seed] = pieces;
+        stack.push_back(seed);
+        while (!stack.empty()) {
+            vtkIdType t = stack.back();
+            stack.pop_back();
+            for (int k = 0; k < neighbourCount[t]; ++k) {
+                vtkIdType u = neighbour[3 * t + k];
+                if (piece[u] >= 0)
+                    continue;   // already placed, a one-sided piece (e.g. a Moebius strip) keeps its choice
+                piece[u] = pieces;
+                flip[u] = flip[t] ^ same[3 * t + k];
+                stack.push_back(u);
+            }
+        }
+        ++pieces;
+    }
+
+    // reversing a triangle swaps its last two points
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            if (flip[t])
+                std::swap(tris[3 * t + 1], tris[3 * t + 2]);
+        }
+    });
+
+    std::vector<double> volumes;
+    withPointData(input->GetPoints(), [&](auto* p) { volumes = pieceVolumes(p, tris, removed, piece, pieces); });
+
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            if (!removed[t] && volumes[piece[t]] < 0.0)
+                std::swap(tris[3 * t + 1], tris[3 * t + 2]);
+        }
+    });
+}
+
+/* Closes holes of up to maxEdges edges with a fan of triangles. Flipping triangles does not
+ * change which edges are boundary edges, so the edge map from before the orientation is used */
+vtkIdType fillHoles(const std::vector<vtkIdType>& tris, const std::vector<uint8_t>& removed,
+                    const std::vector<EdgeShard>& shards, int maxEdges, std::vector<vtkIdType>& added) {
+    // a boundary edge a->b of a triangle is walked b->a around the hole, so the new triangles
+    // face the same way as the old ones
+    std::unordered_map<vtkIdType, vtkIdType> next;
+    std::unordered_map<vtkIdType, int> starts;
+    const vtkIdType nTris = static_cast<vtkIdType>(removed.size());
+    for (vtkIdType t = 0; t < nTris; ++t) {
+        if (removed[t])
+            continue;
+        for (int k = 0; k < 3; ++k) {
+            vtkIdType a = tris[3 * t + k], b = tris[3 * t + (k + 1) % 3];
+            Edge e = a < b ? Edge{ a, b } : Edge{ b, a };
+            const EdgeShard& shard = shards[shardOf(e)];
+            auto it = shard.find(e);
+            if (it != shard.end() && it->second.count == 1) {
+                next[b] = a;
+                ++starts[b];
+            }
+        }
+    }
+
+    vtkIdType filled = 0;
+    std::unordered_map<vtkIdType, bool> visited;
+    std::vector<vtkIdType> loop;
+    for (const auto& entry : next) {
+        if (visited[entry.first])
+            continue;
+
+        // follow the loop, points where several holes touch are left alone
+        loop.clear();
+        bool closed = false, usable = true;
+        vtkIdType v = entry.first;
+        while (!visited[v]) {
+            visited[v] = true;
+            loop.push_back(v);
+            if (starts[v] != 1)
+                usable = false;
+            auto it = next.find(v);
+            if (it == next.end())
+                break;
+            v = it->second;
+            closed = v == entry.first;
+        }
+
+        if (!closed || !usable || loop.size() < 3 || static_cast<int>(loop.size()) > maxEdges)
+            continue;
+
+        for (size_t i = 1; i + 1 < loop.size(); ++i) {
+            added.push_back(loop[0]);
+            added.push_back(loop[i]);
+            added.push_back(loop[i + 1]);
+        }
+        ++filled;
+    }
+    return filled;
+}
+}
+
+bool MeshValidator::canValidate(vtkPolyData* input) {
+    if (!input || !input->GetPoints())
+        return false;
+
+    int type = input->GetPoints()->GetDataType();
+    if (type != VTK_FLOAT && type != VTK_DOUBLE)
+        return false;
+
+    return input->GetNumberOfVerts() == 0 && input->GetNumberOfLines() == 0 &&
+           input->GetNumberOfStrips() == 0 && input->GetPolys()->IsHomogeneous() == 3;
+}
+
+MeshDefects MeshValidator::validate(vtkPolyData* input) {
+    MeshDefects defects;
+    if (!canValidate(input))
+        return defects;
+
+    const std::vector<vtkIdType> tris = readTriangles(input);
+    std::vector<uint8_t> removed(tris.size() / 3, 0);
+
+    defects.degenerateTriangles = markDegenerate(input, tris, removed);
+
+    // degenerate triangles are left out of the edge map so they do not show up twice
+    const EdgeCounts counts = countEdges(buildEdgeMap(tris, removed));
+    defects.nonManifoldEdges = counts.nonManifold;
+    defects.misorientedEdges = counts.misoriented;
+    defects.boundaryEdges = static_cast<vtkIdType>(counts.boundary.size());
+    defects.holes = countLoops(counts.boundary);
+    defects.valid = true;
+    return defects;
+}
+
+vtkSmartPointer<vtkPolyData> MeshValidator::repair(vtkPolyData* input, int maxHoleEdges,
+                                                   const std::atomic<bool>* cancel) {
+    std::vector<vtkIdType> tris = readTriangles(input);
+    std::vector<uint8_t> removed(tris.size() / 3, 0);
+
+    const vtkIdType degenerate = markDegenerate(input, tris, removed);
+    if (isCancelled(cancel))
+        return nullptr;
+
+    const std::vector<EdgeShard> shards = buildEdgeMap(tris, removed);
+    if (isCancelled(cancel))
+        return nullptr;
+
+    unifyOrientation(input, tris, removed, shards);
+    if (isCancelled(cancel))
+        return nullptr;
+
+    std::vector<vtkIdType> added;
+    const vtkIdType filled = fillHoles(tris, removed, shards, maxHoleEdges, added);
+
+    // kept triangles followed by the hole fillers
+    std::vector<vtkIdType> keptOffset(removed.size() + 1, 0);
+    for (size_t t = 0; t < removed.size(); ++t)
+        keptOffset[t + 1] = keptOffset[t] + (removed[t] ? 0 : 1);
+    const vtkIdType kept = keptOffset.back();
+    const vtkIdType nTris = kept + static_cast<vtkIdType>(added.size() / 3);
+
+    auto connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(3 * nTris);
+    auto offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(nTris + 1);
+    vtkIdType* conn = connectivity->GetPointer(0);
+    vtkIdType* offs = offsets->GetPointer(0);
+
+    vtkSMPTools::For(0, static_cast<vtkIdType>(removed.size()), [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            if (removed[t])
+                continue;
+            const vtkIdType out = keptOffset[t];
+            conn[3 * out] = tris[3 * t];
+            conn[3 * out + 1] = tris[3 * t + 1];
+            conn[3 * out + 2] = tris[3 * t + 2];
+        }
+    });
+    std::copy(added.begin(), added.end(), conn + 3 * kept);
+    for (vtkIdType t = 0; t <= nTris; ++t)
+        offs[t] = 3 * t;
+
+    auto polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    auto output = vtkSmartPointer<vtkPolyData>::New();
+    output->SetPoints(input->GetPoints());
+    output->SetPolys(polys);
+
+    qDebug() << "Mesh repair removed" << degenerate << "degenerate triangles and filled" << filled << "holes";
+    return output;
+}
@@ -0,0 +1,72 @@
+/**     @file MeshValidator.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Parallel detection and repair of common STL defects: degenerate
+  *     triangles, non-manifold edges, inconsistent orientation and holes.
+  */
+
+#ifndef VIEWER_MESHVALIDATOR_H
+#define VIEWER_MESHVALIDATOR_H
+
+#include <atomic>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/**
+ * @brief Defects found in a part, shown in the tree view
+ */
+struct MeshDefects {
+    bool        valid = false;              /**< False until the part has been validated */
+    vtkIdType   degenerateTriangles = 0;    /**< Triangles with repeated points or no area */
+    vtkIdType   nonManifoldEdges = 0;       /**< Edges shared by more than two triangles */
+    vtkIdType   misorientedEdges = 0;       /**< Edges whose two triangles face opposite ways (flipped normals) */
+    vtkIdType   boundaryEdges = 0;          /**< Edges used by only one triangle */
+    vtkIdType   holes = 0;                  /**< Connected loops of boundary edges */
+
+    /**
+     * @brief Total number of defects, boundary edges are counted through the holes they form
+     * @return number of defects
+     */
+    vtkIdType total() const { return degenerateTriangles + nonManifoldEdges + misorientedEdges + holes; }
+};
+
+/**
+ * @brief Finds and repairs defects in triangle meshes
+ * @note Edges are counted in hash maps split into shards. Every thread fills its own list of
+ *       edges per shard, then each shard is merged into its map by one thread, so no locks are
+ *       needed. Degenerate triangles are also found in parallel. Making the orientation consistent
+ *       walks across neighbouring triangles and runs on one thread.
+ */
+class MeshValidator {
+public:
+    /**
+     * @brief Checks if the data can be validated
+     * @param input the data to check
+     * @return true if the data only holds triangles with float or double points
+     */
+    static bool canValidate(vtkPolyData* input);
+
+    /**
+     * @brief Counts the defects of a mesh
+     * @param input triangle mesh, see canValidate()
+     * @return the defects, not valid if the data could not be validated
+     */
+    static MeshDefects validate(vtkPolyData* input);
+
+    /**
+     * @brief Makes a repaired copy of a mesh
+     * @note degenerate triangles are removed, the triangles of each connected piece are turned to
+     *       face the same way (outwards if the piece encloses a volume) and holes with up to
+     *       maxHoleEdges edges are closed with new triangles. The points are shared with the input
+     * @param input triangle mesh, see canValidate()
+     * @param maxHoleEdges largest hole that is filled, in boundary edges
+     * @param cancel optional flag, checked between the repair steps
+     * @return the repaired mesh, or nullptr if cancelled
+     */
+    static vtkSmartPointer<vtkPolyData> repair(vtkPolyData* input, int maxHoleEdges,
+                                               const std::atomic<bool>* cancel = nullptr);
+};
+
+#endif
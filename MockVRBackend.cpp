@@ -0,0 +1,130 @@
+/**     @file MockVRBackend.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Headless stand-in for a VR headset, used to run and time the VR
+  *     render loop without SteamVR, a headset or a real GPU.
+  */
+
+#include "MockVRBackend.h"
+
+#include <QDebug>
+#include <QStringList>
+
+#include <vtkCamera.h>
+#include <vtkMath.h>
+
+#include <algorithm>
+#include <cmath>
+
+bool MockVRBackend::initialise() {
+    QStringList size = qEnvironmentVariable("VRMV_MOCK_EYE_SIZE").split('x');
+    if (size.size() == 2 && size[0].toInt() > 0 && size[1].toInt() > 0) {
+        eyeSize[0] = size[0].toInt();
+        eyeSize[1] = size[1].toInt();
+    }
+
+    mockRenderer = vtkSmartPointer<vtkRenderer>::New();
+
+    window = vtkSmartPointer<vtkRenderWindow>::New();
+    window->SetOffScreenRendering(1);
+    window->SetSize(eyeSize[0], eyeSize[1]);
+    window->SetMultiSamples(0);
+    window->AddRenderer(mockRenderer);
+
+    // roughly the field of view of a headset
+    mockRenderer->GetActiveCamera()->SetViewAngle(100.);
+    mockRenderer->GetActiveCamera()->SetViewUp(0., 1., 0.);
+
+    qDebug() << "Mock VR backend drawing" << eyeSize[0] << "x" << eyeSize[1] << "per eye";
+    start = std::chrono::steady_clock::now();
+    return true;
+}
+
+void MockVRBackend::finalise() {
+    if (window)
+        window->Finalize();
+}
+
+void MockVRBackend::renderFrame() {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the scene grows while parts stream in, so the orbit is resized once a second
+    if (frame % static_cast<qint64>(Hz) == 0) {
+        double bounds[6];
+        mockRenderer->ComputeVisiblePropBounds(bounds);
+        if (vtkMath::AreBoundsInitialized(bounds)) {
+            double diagonal = 0.;
+            for (int k = 0; k < 3; ++k) {
+                centre[k] = 0.5 * (bounds[2 * k] + bounds[2 * k + 1]);
+                diagonal += (bounds[2 * k + 1] - bounds[2 * k]) * (bounds[2 * k + 1] - bounds[2 * k]);
+            }
+            radius = std::max(1., std::sqrt(diagonal));
+        }
+    }
+
+    for (int eye = 0; eye < 2; ++eye) {
+        placeEye(seconds, eye);
+
+        std::chrono::steady_clock::time_point eyeStart = std::chrono::steady_clock::now();
+        window->Render();
+        window->WaitForCompletion();
+        eyeMs[eye] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - eyeStart).count();
+    }
+
+    if (eyeMs[0] + eyeMs[1] > 1000. / Hz)
+        lateFrames++;
+    frame++;
+}
+
+bool MockVRBackend::eyeFrameMs(double ms[2]) const {
+    ms[0] = eyeMs[0];
+    ms[1] = eyeMs[1];
+    return true;
+}
+
+bool MockVRBackend::compositorStats(CompositorStats& stats) {
+    // a real compositor would have dropped every frame that was not ready in time
+    stats.droppedFrames = lateFrames;
+    stats.reprojectedFrames = 0;
+    return true;
+}
+
+void MockVRBackend::setRenderScale(double scale) {
+    window->SetSize(std::max(1, static_cast<int>(eyeSize[0] * scale)), std::max(1, static_cast<int>(eyeSize[1] * scale)));
+}
+
+bool MockVRBackend::takeSelectRay(double origin[3], double direction[3]) {
+    // once a second, just after the orbit is resized, from the head towards the centre of the scene
+    if (frame == 0 || (frame - 1) % static_cast<qint64>(Hz) != 0)
+        return false;
+    for (int k = 0; k < 3; ++k) {
+        origin[k] = head[k];
+        direction[k] = centre[k] - head[k];
+    }
+    return true;
+}
+
+void MockVRBackend::placeEye(double seconds, int eye) {
+    // head circles the scene with a slight bob, looking at the centre
+    const double angle = 2. * vtkMath::Pi() * seconds / OrbitSeconds;
+    head[0] = centre[0] + radius * std::cos(angle);
+    head[1] = centre[1] + 0.05 * radius * std::sin(3. * angle);
+    head[2] = centre[2] + radius * std::sin(angle);
+
+    // the eyes sit either side of the head, along the direction to its right
+    double forward[3] = { centre[0] - head[0], centre[1] - head[1], centre[2] - head[2] };
+    vtkMath::Normalize(forward);
+    const double up[3] = { 0., 1., 0. };
+    double right[3];
+    vtkMath::Cross(forward, up, right);
+    vtkMath::Normalize(right);
+
+    // the scene's units are unknown, so the eyes are spaced relative to the orbit to keep the parallax the same
+    const double offset = (eye == 0 ? -0.5 : 0.5) * Ipd * radius;
+    vtkCamera* camera = mockRenderer->GetActiveCamera();
+    camera->SetPosition(head[0] + offset * right[0], head[1] + offset * right[1], head[2] + offset * right[2]);
+    camera->SetFocalPoint(centre[0] + offset * right[0], centre[1] + offset * right[1], centre[2] + offset * right[2]);
+    camera->SetViewUp(up[0], up[1], up[2]);
+    mockRenderer->ResetCameraClippingRange();
+}
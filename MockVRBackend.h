@@ -0,0 +1,69 @@
+/**     @file MockVRBackend.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Headless stand-in for a VR headset, used to run and time the VR
+  *     render loop without SteamVR, a headset or a real GPU.
+  */
+
+#ifndef VIEWER_MOCKVRBACKEND_H
+#define VIEWER_MOCKVRBACKEND_H
+
+#include "VRBackend.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+
+#include <chrono>
+
+/**
+ * @brief Draws both eyes to an offscreen window with a scripted head pose
+ * @note The head circles the scene at its own height, looking at the centre, with the eyes
+ *       IPD apart. Each eye is drawn and waited for (glFinish) on its own so the eye times are the
+ *       real cost of the scene, with software OpenGL as well. Frames are not paced, the render loop
+ *       sleeps out the rest of each frame as it does when the compositor returns early.
+ *       The eye size is 1440x1600 unless VRMV_MOCK_EYE_SIZE is set (e.g. "640x720").
+ *       Once a second the head "presses select" along its view direction, so picking is timed too
+ */
+class MockVRBackend : public VRBackend {
+public:
+    static constexpr double Hz = 90.;               /**< Refresh rate reported to the render loop */
+    static constexpr double Ipd = 0.064;            /**< Distance between the eyes, as a fraction of the distance to the scene */
+    static constexpr double OrbitSeconds = 20.;     /**< Time for the head to circle the scene once */
+
+    QString name() const override { return "mock"; }
+    bool initialise() override;
+    void finalise() override;
+    vtkRenderer* renderer() const override { return mockRenderer; }
+    double displayHz() const override { return Hz; }
+    void renderFrame() override;
+    bool done() const override { return false; }
+    double gpuFrameMs() override { return eyeMs[0] + eyeMs[1]; }
+    bool eyeFrameMs(double ms[2]) const override;
+    bool compositorStats(CompositorStats& stats) override;
+    void setRenderScale(double scale) override;
+    bool takeSelectRay(double origin[3], double direction[3]) override;
+
+private:
+    /**
+     * @brief Moves the camera to the scripted head pose for a time, offset for one eye
+     * @param seconds time since the backend started
+     * @param eye 0 for the left eye, 1 for the right
+     */
+    void placeEye(double seconds, int eye);
+
+    vtkSmartPointer<vtkRenderWindow>    window;                 /**< Offscreen window the eyes are drawn to */
+    vtkSmartPointer<vtkRenderer>        mockRenderer;           /**< Renderer holding the scene */
+
+    int                                 eyeSize[2] = { 1440, 1600 };    /**< Full size of one eye */
+    double                              eyeMs[2] = { 0., 0. };  /**< Time taken to draw each eye of the last frame */
+    double                              centre[3] = { 0., 0., 0. };     /**< Centre of the scene, the head looks at it */
+    double                              radius = 1.;            /**< Distance of the head from the centre */
+    double                              head[3] = { 0., 0., 0. };       /**< Position of the head in the last frame */
+    qint64                              frame = 0;              /**< Frames drawn */
+    qint64                              lateFrames = 0;         /**< Frames that took longer than 1/Hz to draw */
+    std::chrono::steady_clock::time_point start;                /**< When initialise() was called */
+};
+
+#endif
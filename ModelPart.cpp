@@ -11,6 +11,8 @@
 #include "ModelPart.h"
 #include <QDebug>
 
+#include <algorithm>
+
 
 
 /* Commented out for now, will be uncommented later when you have
@@ -42,6 +44,7 @@ ModelPart::ModelPart(const QList<QVariant>& data, ModelPart* parent )
 
 ModelPart::~ModelPart() {
     qDeleteAll(m_childItems);
+    qDeleteAll(unloadedParts);
 }
 
 
@@ -50,10 +53,18 @@ void ModelPart::appendChild( ModelPart* item ) {
      * (it will appear as a sub-branch in the treeview)
      */
     item->m_parentItem = this;
+    item->m_row = m_childItems.size();
     m_childItems.append(item);
 }
 
 
+void ModelPart::appendChildren( const QList<ModelPart*>& items ) {
+    m_childItems.reserve(m_childItems.size() + items.size());
+    for (ModelPart* item : items)
+        appendChild(item);
+}
+
+
 ModelPart* ModelPart::child( int row ) {
     /* Return pointer to child item in row below this item.
      */
@@ -94,6 +105,7 @@ void ModelPart::set(int column, const QVariant &value) {
         return;
 
     m_itemData.replace(column, value);
+    savedState.reset();
 }
 
 
@@ -106,13 +118,26 @@ int ModelPart::row() const {
     /* Return the row index of this item, relative to it's parent.
      */
     if (m_parentItem)
-        return m_parentItem->m_childItems.indexOf(const_cast<ModelPart*>(this));
+        return m_row;
     return 0;
 }
 
 
+void ModelPart::sortChildren(const std::function<bool(const ModelPart*, const ModelPart*)>& lessThan) {
+    std::stable_sort(m_childItems.begin(), m_childItems.end(), lessThan);
+    renumberChildren(0);
+}
+
+
+void ModelPart::renumberChildren(int first) {
+    for (int i = first; i < m_childItems.size(); ++i)
+        m_childItems[i]->m_row = i;
+}
+
+
 void ModelPart::loadSTL(QString fileName) {
     qDebug() << "Loading STL file:" << fileName;
+    savedState.reset();
 
     file = vtkSmartPointer<vtkSTLReader>::New();
     file->SetFileName(fileName.toStdString().c_str());
@@ -131,14 +156,18 @@ void ModelPart::loadSTL(QString fileName) {
         qDebug() << "STL file loaded successfully with" << file->GetOutput()->GetNumberOfPoints() << "points.";
     }
 
+    updateMetrics();
+    defects = MeshDefects();   // validated separately, see validateMesh()
+
     if (!actor){
         mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
         mapper->SetInputConnection(file->GetOutputPort());
         
-        // create a separate actor for VR rendering
+        // create a separate actor for VR rendering, given the data rather than the reader's
+        // port so the VR thread never runs the GUI thread's pipeline
         vrMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-        vrMapper->SetInputConnection(file->GetOutputPort());
     }
+    vtkPolyDataMapper::SafeDownCast(vrMapper)->SetInputData(vrDataFor(file->GetOutput()));
 
     actor = vtkSmartPointer<vtkActor>::New();
     actor->SetMapper(mapper);
@@ -161,21 +190,161 @@ void ModelPart::loadSTL(QString fileName) {
 
     actor->GetProperty()->SetColor(255.0, 1.0, 1.0);  // Red model for testing
 
-    vrActor->GetProperty()->SetColor(1.0, 1.0, 1.0);  // White model for testing
+    // VR actor starts with the part's colour, later changes are sent with takeVrChanges()
+    vrActor->GetProperty()->SetColor(modelColourR / 255.0, modelColourG / 255.0, modelColourB / 255.0);
+    vrActor->SetVisibility(partIsVisible);
+    vrColour[0] = modelColourR;
+    vrColour[1] = modelColourG;
+    vrColour[2] = modelColourB;
+    vrVisible = partIsVisible;
+    vrGeometryDirty = false;
 
-    vrActor->SetVisibility(1); // Make sure it's visible
 
+}
+
+void ModelPart::updateMetrics() {
+    metrics = file ? MeshMetrics::compute(file->GetOutput()) : MeshMetrics();
+    savedState.reset();
+    qDebug() << "Model metrics:" << metrics.triangles << "triangles, area" << metrics.area
+             << "volume" << metrics.volume;
+}
+
+const MeshMetrics& ModelPart::getMetrics() const {
+    return metrics;
+}
 
+void ModelPart::validateMesh() {
+    defects = file ? MeshValidator::validate(file->GetOutput()) : MeshDefects();
+    savedState.reset();
+    qDebug() << "Model defects:" << defects.degenerateTriangles << "degenerate," << defects.nonManifoldEdges
+             << "non-manifold edges," << defects.misorientedEdges << "flipped edges," << defects.holes << "holes";
+}
+
+const MeshDefects& ModelPart::getDefects() const {
+    return defects;
 }
 
 void ModelPart::removeChild(ModelPart* child) {
-    if (!child) return;
+    if (takeChild(child))
+        delete child;                          // free memory if you allocated with new
+}
+
+bool ModelPart::takeChild(ModelPart* child) {
+    if (!child) return false;
+
+    // the stored row saves searching the list, it is only wrong if the part is not our child
+    int index = child->m_parentItem == this ? child->m_row : -1;
+    if (index < 0 || index >= m_childItems.size() || m_childItems[index] != child)
+        return false;
 
-    int index = m_childItems.indexOf(child);
-    if (index != -1) {
-        delete m_childItems[index];            // free memory if you allocated with new
-        m_childItems.removeAt(index);          // remove from list
+    m_childItems.removeAt(index);              // remove from list
+    renumberChildren(index);
+    child->m_parentItem = nullptr;
+    return true;
+}
+
+void ModelPart::insertChild(int row, ModelPart* item) {
+    row = std::max(0, std::min(row, static_cast<int>(m_childItems.size())));
+    item->m_parentItem = this;
+    m_childItems.insert(row, item);
+    renumberChildren(row);
+}
+
+PartStatePtr ModelPart::saveState() const {
+    if (!savedState) {
+        auto state = std::make_shared<PartState>();
+        state->name = data(0).toString();
+        state->file = file;
+        state->mapper = mapper;
+        state->actor = actor;
+        state->metrics = metrics;
+        state->defects = defects;
+        savedState = state;
     }
+    return savedState;
+}
+
+void ModelPart::restoreState(const PartStatePtr& state) {
+    if (!state)
+        return;
+
+    if (!m_itemData.isEmpty())
+        m_itemData.replace(0, state->name);
+    file = state->file;
+    mapper = state->mapper;
+    actor = state->actor;
+    metrics = state->metrics;
+    defects = state->defects;
+    vrGeometryDirty = true;     // the VR actor shows whatever the part had before
+    savedState = state;
+}
+
+
+// ------------------------------ folders ---------------------------------
+
+void ModelPart::setFolder(const QString& path) {
+    folder = path;
+    folderListed = false;
+    qDeleteAll(unloadedParts);
+    unloadedParts.clear();
+}
+
+QString ModelPart::getFolder() const {
+    return folder;
+}
+
+bool ModelPart::isFolder() const {
+    return !folder.isEmpty();
+}
+
+bool ModelPart::isFolderListed() const {
+    return folderListed;
+}
+
+void ModelPart::setFolderListing(const QList<ModelPart*>& parts) {
+    folderListed = true;
+    qDeleteAll(unloadedParts);
+    unloadedParts = parts;
+    for (ModelPart* part : unloadedParts)
+        part->listingFolder = this;
+}
+
+QList<ModelPart*> ModelPart::takeUnloadedParts(int count) {
+    QList<ModelPart*> taken = unloadedParts.mid(0, count);
+    unloadedParts.erase(unloadedParts.begin(), unloadedParts.begin() + taken.size());
+    for (ModelPart* part : taken)
+        part->listingFolder = nullptr;
+    return taken;
+}
+
+QList<ModelPart*> ModelPart::takeUnloadedParts(const QSet<ModelPart*>& parts) {
+    QList<ModelPart*> taken, kept;
+    for (ModelPart* part : unloadedParts)
+        (parts.contains(part) ? taken : kept).append(part);
+    unloadedParts.swap(kept);
+    for (ModelPart* part : taken)
+        part->listingFolder = nullptr;
+    return taken;
+}
+
+const QList<ModelPart*>& ModelPart::getUnloadedParts() const {
+    return unloadedParts;
+}
+
+ModelPart* ModelPart::getListingFolder() const {
+    return listingFolder;
+}
+
+bool ModelPart::hasUnloadedParts() const {
+    return !unloadedParts.isEmpty();
+}
+
+void ModelPart::setPendingFile(const QString& path) {
+    pendingFile = path;
+}
+
+QString ModelPart::getPendingFile() const {
+    return pendingFile;
 }
 
 
@@ -226,25 +395,23 @@ vtkSmartPointer<vtkActor> ModelPart::getVrActor() {
 // ----------------------------- Filters ----------------------------------
 
 bool ModelPart::getShrinkFilterStatus(){
-    return shrinkFilterEnabled;
+    return filters.stage("shrink")->isEnabled();
 }
 
 bool ModelPart::getClipFilterStatus(){
-    return clipFilterEnabled;
+    return filters.stage("clip")->isEnabled();
 }
 
 int ModelPart::getShrinkFactor(){
-    return shrinkFactor;
+    return qRound(getShrinkFactorAsFloat() * 100);  //stage stores 0->1.0 but UI uses 0->100
 }
 
 float ModelPart::getShrinkFactorAsFloat(){
-
-    float shrinkFactorAsFloat = static_cast<float>(shrinkFactor);   //output from UI is int so have to convert to float
-    return shrinkFactorAsFloat/100; //output from UI is 80 but need 0->1.0
+    return filters.stage("shrink")->parameter("factor").toFloat();
 }
 
 int ModelPart::getClipOrigin(){
-    return clipOrigin;
+    return qRound(filters.stage("clip")->parameter("origin").toDouble());
 }
 
 vtkSmartPointer<vtkActor> ModelPart::getFiltedActor() const {
@@ -277,16 +444,15 @@ void ModelPart::setActorValues(){
     actor->SetVisibility(partIsVisible);
 
     //if a filter is enabled then dont show base model
-    if (clipFilterEnabled || shrinkFilterEnabled){
+    if (hasActiveFilters() && filtedActor){
         actor->SetVisibility(0);
         filtedActor->GetProperty()->SetColor(modelColourR,modelColourG,modelColourB);
         filtedActor->SetVisibility(partIsVisible);
-        qDebug() << "clipFilterEnabled || shrinkFilterEnabled";
+        qDebug() << "filters enabled";
     }
-
-    if (!(clipFilterEnabled) || !(shrinkFilterEnabled)){
+    else if (filtedActor){
         filtedActor->SetVisibility(0);
-        qDebug() << "(!(clipFilterEnabled) || !(shrinkFilterEnabled))";
+        qDebug() << "filters disabled";
     }
 
 }
@@ -294,32 +460,38 @@ void ModelPart::setActorValues(){
 void ModelPart::setFile(vtkSmartPointer<vtkSTLReader> reader){
 
     this->file = reader;
+    defects = MeshDefects();    // found for the previous file
+    vrGeometryDirty = true;     // the VR actor still shows the previous file
+    savedState.reset();
 }
 
 // ----------------------------- Filters ----------------------------------
 
 void ModelPart::setClipFilterStatus(bool inputClipFilterEnabled){
-    clipFilterEnabled = inputClipFilterEnabled;
+    filters.stage("clip")->setEnabled(inputClipFilterEnabled);
 }
 
 void ModelPart::setShrinkFilterStatus(bool inputShrinkFilterEnabled){
-    shrinkFilterEnabled = inputShrinkFilterEnabled;
+    filters.stage("shrink")->setEnabled(inputShrinkFilterEnabled);
 }
 
 void ModelPart::setClipOrigin(int inputClipOrigin){
-    clipOrigin = inputClipOrigin;
+    filters.stage("clip")->setParameter("origin", static_cast<double>(inputClipOrigin));
 }
 
 void ModelPart::setShrinkFactor(int inputShrinkFactor){
-    shrinkFactor = inputShrinkFactor;
+    //output from UI is 80 but need 0->1.0
+    filters.stage("shrink")->setParameter("factor", inputShrinkFactor / 100.0);
 }
 
 void ModelPart::setActor(vtkSmartPointer<vtkActor> actor) {
     this->actor = actor;
+    savedState.reset();
 }
 
 void ModelPart::setMapper(vtkSmartPointer<vtkPolyDataMapper> mapper) {
     this->mapper = mapper;
+    savedState.reset();
 }
 
 void ModelPart::setFiltedActor(vtkSmartPointer<vtkActor> filtedActor){
@@ -329,6 +501,125 @@ void ModelPart::setFiltedActor(vtkSmartPointer<vtkActor> filtedActor){
 
 }
 
+FilterPipeline& ModelPart::getFilters(){
+    return filters;
+}
+
+bool ModelPart::hasActiveFilters() const {
+    return filters.hasActiveStages();
+}
+
+void ModelPart::applyFilters(){
+    if (!file || !actor)
+        return;
+
+    if (!hasActiveFilters()) {
+        if (filtedActor)
+            filtedActor->SetVisibility(0);
+        actor->SetVisibility(partIsVisible);
+        vrGeometryDirty = true;
+        return;
+    }
+
+    vtkSmartPointer<vtkPolyData> output = filters.update(file->GetOutput());
+    setFilteredOutput(output, filters.shareOutput(output));
+}
+
+bool ModelPart::updateFiltersInPlace(){
+    if (!file || !actor || !filtedActor || !hasActiveFilters())
+        return false;
+
+    vtkSmartPointer<vtkPolyData> output = filters.updateInPlace(file->GetOutput());
+    if (!output)
+        return false;
+
+    setFilteredOutput(output, filters.shareOutput(output));
+    return true;
+}
+
+void ModelPart::setFilteredOutput(vtkSmartPointer<vtkPolyData> output, std::weak_ptr<int> share){
+    if (!actor || !output)
+        return;
+    filteredShare = share;
+
+    // the mapper and actor are only made once, later changes just swap the mapper input
+    if (!filtedActor) {
+        filtedMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        filtedActor = vtkSmartPointer<vtkActor>::New();
+        filtedActor->SetMapper(filtedMapper);
+    }
+    // rendering updates the data object's pipeline information and bounds, so the mapper gets its own
+    // object sharing the arrays, the cached output may be the next stage's input on the worker thread
+    auto shown = vtkSmartPointer<vtkPolyData>::New();
+    shown->ShallowCopy(output);
+    filtedMapper->SetInputData(shown);
+    vrGeometryDirty = true;
+
+    //copy position data to filtered actor
+    filtedActor->SetPosition(actor->GetPosition());
+    filtedActor->SetOrientation(actor->GetOrientation());
+    filtedActor->SetScale(actor->GetScale());
+    filtedActor->SetUserTransform(actor->GetUserTransform());
+
+    setActorValues();
+}
+
+vtkSmartPointer<vtkActor> ModelPart::getDisplayActor() const {
+    if (hasActiveFilters() && filtedActor)
+        return filtedActor;
+    return actor;
+}
+
+void ModelPart::resendToVr() {
+    // a geometry change writes the colour and visibility as well
+    vrGeometryDirty = true;
+}
+
+bool ModelPart::takeVrChanges(VRSceneBuffer& scene) {
+    if (!vrActor)
+        return false;
+
+    const bool colourChanged = vrColour[0] != modelColourR || vrColour[1] != modelColourG || vrColour[2] != modelColourB;
+    const bool geometryChanged = vrGeometryDirty && file;
+    if (!colourChanged && vrVisible == partIsVisible && !geometryChanged)
+        return false;
+
+    VRPartState& state = scene.edit(vrActor);
+    state.colour[0] = modelColourR / 255.0;
+    state.colour[1] = modelColourG / 255.0;
+    state.colour[2] = modelColourB / 255.0;
+    state.visible = partIsVisible;
+    vrColour[0] = modelColourR;
+    vrColour[1] = modelColourG;
+    vrColour[2] = modelColourB;
+    vrVisible = partIsVisible;
+
+    if (geometryChanged) {
+        if (hasActiveFilters() && filtedMapper && filtedMapper->GetInput()) {
+            // the arrays are the cached output's, while the VR side holds a share of the cache entry
+            // updateInPlace() writes to the spare output instead, an output no pipeline caches is never rewritten
+            state.geometry = vrDataFor(filtedMapper->GetInput());
+            state.geometryShare = filteredShare.lock();
+        } else {
+            // the loaded arrays are never changed once read
+            state.geometry = vrDataFor(file->GetOutput());
+            state.geometryShare.reset();
+        }
+        vrGeometryDirty = false;
+    }
+
+    return true;
+}
+
+vtkPolyData* ModelPart::vrDataFor(vtkPolyData* data) {
+    if (data != vrSource || !vrData) {
+        vrSource = data;
+        vrData = vtkSmartPointer<vtkPolyData>::New();
+        vrData->ShallowCopy(data);
+    }
+    return vrData;
+}
+
 // ---------------------------------------------------------------------
 
 
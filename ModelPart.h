@@ -11,7 +11,9 @@
 #define VIEWER_MODELPART_H
 
 #include <QString>
+#include <QStringList>
 #include <QList>
+#include <QSet>
 #include <QVariant>
 
 // vtk headers
@@ -23,6 +25,14 @@
 #include <vtkProperty.h>
 #include <vtkShrinkFilter.h>
 
+#include "FilterPipeline.h"
+#include "MeshMetrics.h"
+#include "MeshValidator.h"
+#include "PartState.h"
+#include "VRSceneSnapshot.h"
+
+#include <functional>
+
 /**
  * @brief Contains all model part related information
  * @note Contains RGB colour component values, visibility status, filter status and filter values
@@ -52,6 +62,11 @@ public:
       */
     void appendChild(ModelPart* item);
 
+    /** Add several children to this item at once, in order.
+      * @param items Pointers to the child objects (must already be allocated using new)
+      */
+    void appendChildren(const QList<ModelPart*>& items);
+
     /** Return child at position 'row' below this item
       * @param row is the row number (below this item)
       * @return pointer to the item requested.
@@ -94,10 +109,17 @@ public:
     ModelPart* parentItem();
 
     /** Get row index of item, relative to parent item
+      * @note the row is stored in the item and kept up to date by the parent, so this does not
+      *       search the parent's children (the tree view asks for it very often)
       * @return row index
       */
     int row() const;
 
+    /** Reorder the children of this item, used when sorting the tree view
+      * @param lessThan returns true if the first part should be listed before the second
+      */
+    void sortChildren(const std::function<bool(const ModelPart*, const ModelPart*)>& lessThan);
+
 
     /**
      * @brief Sets the RGB color components of the model part
@@ -146,6 +168,30 @@ public:
       */
     void loadSTL(QString fileName);
 
+    /**
+     * @brief Measures the loaded part (area, volume, triangle count and size)
+     * @note called by loadSTL(), call again if the file of the part is replaced
+     */
+    void updateMetrics();
+
+    /**
+     * @brief Gets the measurements of the part
+     * @return the metrics, not valid if no file has been loaded
+     */
+    const MeshMetrics& getMetrics() const;
+
+    /**
+     * @brief Checks the loaded part for defects (degenerate triangles, non-manifold edges, flipped normals, holes)
+     * @note optional as it takes about as long as loading, see MainWindow's "Validate Parts On Load" action
+     */
+    void validateMesh();
+
+    /**
+     * @brief Gets the defects found by validateMesh()
+     * @return the defects, not valid if the part has not been validated
+     */
+    const MeshDefects& getDefects() const;
+
     /** Return actor
       * @brief gets the VR actor from the model
       * @return pointer to vrthread actor use in VR
@@ -159,12 +205,117 @@ public:
       */
     void removeChild(ModelPart* child);
 
+    /**
+     * @brief Takes a child out of the item tree without deleting it
+     * @note the child keeps everything under it and can be put back with insertChild()
+     * @param child Pointer to the child ModelPart to take out
+     * @return true if it was a child of this item
+     */
+    bool takeChild(ModelPart* child);
+
+    /**
+     * @brief Puts a child into the item tree at a given row
+     * @param row position of the child, rows from there on move down one
+     * @param item Pointer to the child object (must already be allocated using new)
+     */
+    void insertChild(int row, ModelPart* item);
+
+    /**
+     * @brief Saves the part's name and geometry so a later change can be undone
+     * @note the same state is returned until the part is renamed or its geometry changes, see PartState
+     * @return the saved state
+     */
+    PartStatePtr saveState() const;
+
+    /**
+     * @brief Puts back a saved name and geometry
+     * @note the VR actor is given the geometry the next time takeVrChanges() is called. The caller
+     *       takes the previous actor out of the renderer
+     * @param state the state to put back
+     */
+    void restoreState(const PartStatePtr& state);
+
      /** set file
       * @brief sets the STL reader (file) thats associated with this model part
       * @param reader Smart pointer to a vtkSTLReader that contains the model data
       */
     void setFile(vtkSmartPointer<vtkSTLReader> reader );
 
+    //------------------------------Folders---------------------------------------------
+    /**
+     * @brief Makes this item show a folder on disk, its contents are read when it is expanded
+     * @param path path of the folder
+     */
+    void setFolder(const QString& path);
+
+    /**
+     * @brief Gets the folder this item shows
+     * @return path of the folder, empty if the item is a part
+     */
+    QString getFolder() const;
+
+    /**
+     * @brief Checks if this item shows a folder
+     * @return true for a folder, false for a part
+     */
+    bool isFolder() const;
+
+    /**
+     * @brief Checks if the folder's contents have been read, see ModelPartList::fetchMore()
+     * @return true once setFolderListing() has been called
+     */
+    bool isFolderListed() const;
+
+    /**
+     * @brief Stores the parts made for the STL files found in the folder, they are added to the tree a batch at a time
+     * @param parts name-only parts (see setPendingFile()) in the order they are listed, owned by the folder until taken
+     */
+    void setFolderListing(const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Takes the next parts of the folder to add to the tree
+     * @param count most parts to take
+     * @return the parts, now owned by the caller
+     */
+    QList<ModelPart*> takeUnloadedParts(int count);
+
+    /**
+     * @brief Takes some of the parts of the folder that have not been added to the tree, e.g. ones found by a search
+     * @param parts the parts wanted, any that are not waiting in this folder are ignored
+     * @return the parts taken in the order they are listed, now owned by the caller
+     */
+    QList<ModelPart*> takeUnloadedParts(const QSet<ModelPart*>& parts);
+
+    /**
+     * @brief Gets the parts of the folder that have not been added to the tree yet
+     * @return the parts, in the order they are listed
+     */
+    const QList<ModelPart*>& getUnloadedParts() const;
+
+    /**
+     * @brief Gets the folder a part is waiting in before it is added to the tree
+     * @return the folder, nullptr once the part has been taken out of it
+     */
+    ModelPart* getListingFolder() const;
+
+    /**
+     * @brief Checks if the folder has parts that have not been added to the tree yet
+     * @return true if there are parts left to add
+     */
+    bool hasUnloadedParts() const;
+
+    /**
+     * @brief Stores the STL file of a part added to the tree before its geometry, see ModelPartList::fetchMore()
+     * @param path path of the file, empty once it has been loaded
+     */
+    void setPendingFile(const QString& path);
+
+    /**
+     * @brief Gets the STL file still to be loaded for this part
+     * @return path of the file, empty if the part has been loaded (or was never waiting)
+     */
+    QString getPendingFile() const;
+
 
     //------------------------------Filters---------------------------------------------
     /// Added by Ben :)
@@ -237,7 +388,7 @@ public:
 
     /**
      * @brief gets the FLOAT shrink factor to be used in SetShrinkFactor()
-     * @note conversion to float is needed as shrinkFactor is stored as an int, its also divided by 100 to fit in the range (0->1)
+     * @note the shrink stage of the filter pipeline stores the factor in the range (0->1) already
      * @return returns the shrink factor as a float in the range (0->1)
      */
     float getShrinkFactorAsFloat();
@@ -284,6 +435,65 @@ public:
      */
     vtkSmartPointer<vtkActor> getFiltedActor() const;
 
+    /**
+     * @brief Gets the filter pipeline of the part so stages can be configured
+     * @note call applyFilters() after changing the pipeline to update the filtered actor
+     * @return reference to the part's filter pipeline
+     */
+    FilterPipeline& getFilters();
+
+    /**
+     * @brief Checks if any filter in the pipeline is enabled
+     * @return true if the filtered actor should be rendered instead of the base actor
+     */
+    bool hasActiveFilters() const;
+
+    /**
+     * @brief Runs the filter pipeline and updates the filtered actor with the result
+     * @note only the stages whose parameters (or input) changed since the last call are re-run,
+     *       the filtered mapper and actor are reused between calls
+     */
+    void applyFilters();
+
+    /**
+     * @brief Updates the filtered actor without running the pipeline if only the last stage changed
+     * @note must be called on the GUI thread, see FilterPipeline::updateInPlace()
+     * @return true if the filtered actor is up to date, false if the pipeline has to be run
+     */
+    bool updateFiltersInPlace();
+
+    /**
+     * @brief Shows already filtered data on the filtered actor
+     * @note used by the background filter worker, the filtered mapper just swaps its input
+     *       so no new mapper or actor is made. The mapper is given a shallow copy, the output
+     *       itself stays with the filter cache and may be read by the worker thread
+     * @param output the filtered data to render
+     * @param share the filter cache entry holding the output, see FilterPipeline::shareOutput()
+     */
+    void setFilteredOutput(vtkSmartPointer<vtkPolyData> output, std::weak_ptr<int> share = std::weak_ptr<int>());
+
+    /**
+     * @brief Gets the actor that should currently be rendered on the desktop
+     * @return the filtered actor if any filter is enabled, otherwise the base actor
+     */
+    vtkSmartPointer<vtkActor> getDisplayActor() const;
+
+    /**
+     * @brief Writes the part's colour, visibility and geometry after filtering into the VR scene
+     * @note the scene is only edited if something changed since the last call, the caller publishes
+     *       it. Geometry is passed as a shallow copy made here, so the VR thread has its own data object
+     *       sharing the arrays, see vrDataFor(). Filtered geometry also carries a share of its filter
+     *       cache entry, so the pipeline never rewrites it in place, see FilterPipeline::updateInPlace()
+     * @param scene working VR scene of the VR thread
+     * @return true if the scene was edited
+     */
+    bool takeVrChanges(VRSceneBuffer& scene);
+
+    /**
+     * @brief Makes the next takeVrChanges() write everything, used when the VR actor is added to the scene again
+     */
+    void resendToVr();
+
     //---------------------------------------------------------------------------------
 
 
@@ -292,6 +502,7 @@ private:
     QList<ModelPart*>                           m_childItems;       /**< List (array) of child items */
     QList<QVariant>                             m_itemData;         /**< List (array of column data for item */
     ModelPart*                                  m_parentItem;       /**< Pointer to parent */
+    int                                         m_row = 0;          /**< Position in the parent's m_childItems, see row() */
 
     /* These are some typical properties that I think the part will need, you might
      * want to add you own.
@@ -308,16 +519,48 @@ private:
     vtkSmartPointer<vtkActor>                   actor;              /**< Actor for rendering */
     vtkSmartPointer<vtkActor>                   vrActor;              /**< Actor for rendering in vr*/
     vtkSmartPointer<vtkActor>                   filtedActor;            /**< Filtered Actor for rendering*/
+    vtkSmartPointer<vtkPolyDataMapper>          filtedMapper;           /**< Mapper for the filtered actor, reused between filter changes */
+    std::weak_ptr<int>                          filteredShare;          /**< Filter cache entry holding the filtered actor's data, see takeVrChanges() */
 
     //vtkColor3<unsigned char>                    colour;             /**< User defineable colour */
 
 
     //------------------------------Filters defaults---------------------------------------------
     // Added by Ben :)
-    bool clipFilterEnabled = false;         /**< Status of the clip flter */
-    bool shrinkFilterEnabled = false;       /**< Status of the shrink flter */
-    int clipOrigin = 0;                     /**< x position of the clip flter */
-    int shrinkFactor = 80;                  /**< Decides how much the planes of the model are */
+    FilterPipeline filters;                 /**< Ordered filter chain, holds the status and values of every filter */
+
+    MeshMetrics metrics;                    /**< Measurements of the unfiltered part */
+    MeshDefects defects;                    /**< Defects of the unfiltered part, the "repair" filter fixes them */
+
+    unsigned char vrColour[3] = { 255, 255, 255 };  /**< Colour the VR actor was last given */
+    bool vrVisible = true;                  /**< Visibility the VR actor was last given */
+    bool vrGeometryDirty = false;           /**< True if the filtered geometry changed since it was last sent to VR */
+    vtkSmartPointer<vtkPolyData> vrSource;  /**< Desktop data the VR data was last made from */
+    vtkSmartPointer<vtkPolyData> vrData;    /**< Shallow copy of vrSource owned by the VR side, see vrDataFor() */
+
+    QString folder;                         /**< Folder on disk shown by this item, empty for a part */
+    bool folderListed = false;              /**< True once the folder's contents have been read */
+    QList<ModelPart*> unloadedParts;        /**< Parts of the folder's STL files not added to the tree yet, owned here */
+    ModelPart* listingFolder = nullptr;     /**< Folder holding this part in its unloadedParts */
+    QString pendingFile;                    /**< STL file of a part whose geometry has not been loaded yet */
+
+    mutable PartStatePtr savedState;        /**< Last state saved or restored, cleared when the name or geometry changes */
+
+    /**
+     * @brief Gets the data object the VR side renders for some desktop data, made on this (GUI) thread
+     * @note VTK updates a data object's pipeline information and bounds while it is rendered, so the
+     *       two threads never use the same object. The shallow copy shares the arrays, so no mesh is
+     *       copied, and it is only made again when the desktop data changes
+     * @param data data rendered on the desktop
+     * @return the VR side's copy of it
+     */
+    vtkPolyData* vrDataFor(vtkPolyData* data);
+
+    /**
+     * @brief Stores the row of each child from a given row onwards, after children were moved or removed
+     * @param first the first row that changed
+     */
+    void renumberChildren(int first);
 
 
     //-------------------------------------------------------------------------------------------
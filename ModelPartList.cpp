@@ -10,11 +10,23 @@
 #include "ModelPartList.h"
 #include "ModelPart.h"
 
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QLocale>
+#include <QSet>
+
+#include <algorithm>
+
 ModelPartList::ModelPartList( const QString& data, QObject* parent ) : QAbstractItemModel(parent) {
     /* Have option to specify number of visible properties for each item in tree - the root item
      * acts as the column headers
      */
-    rootItem = new ModelPart( { tr("Part"), tr("Visible") } );
+    rootItem = new ModelPart( { tr("Part"), tr("Visible"), tr("Triangles"), tr("Area"), tr("Volume"), tr("Size"), tr("Defects") } );
+
+    loadTimer.setInterval(0);   // a slice each time the event loop is idle
+    connect(&loadTimer, &QTimer::timeout, this, &ModelPartList::loadPendingParts);
 }
 
 
@@ -37,15 +49,71 @@ QVariant ModelPartList::data( const QModelIndex& index, int role ) const {
     if( !index.isValid() )
         return QVariant();
 
+    /* Get a a pointer to the item referred to by the QModelIndex */
+    ModelPart* item = static_cast<ModelPart*>( index.internalPointer() );
+
+    /* Defects are only known once the part has been validated */
+    if (index.column() == DefectsColumn) {
+        const MeshDefects& defects = item->getDefects();
+        if (!defects.valid)
+            return QVariant();
+
+        FilterStage* repair = item->getFilters().stage("repair");
+        bool repaired = repair && repair->isEnabled();
+
+        switch (role) {
+        case Qt::TextAlignmentRole:
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        case SortRole:
+            return QVariant::fromValue<qlonglong>(defects.total());
+        case Qt::DisplayRole:
+            return repaired ? tr("%1 (repaired)").arg(defects.total()) : QString::number(defects.total());
+        case Qt::ToolTipRole:
+            return tr("Degenerate triangles: %1\nNon-manifold edges: %2\nFlipped edges: %3\nHoles: %4 (%5 boundary edges)")
+                .arg(defects.degenerateTriangles).arg(defects.nonManifoldEdges).arg(defects.misorientedEdges)
+                .arg(defects.holes).arg(defects.boundaryEdges);
+        }
+        return QVariant();
+    }
+
+    /* The metric columns are not stored in the item's column data */
+    if (index.column() >= TrianglesColumn) {
+        const MeshMetrics& metrics = item->getMetrics();
+        if (!metrics.valid)
+            return QVariant();
+
+        if (role == Qt::TextAlignmentRole)
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+
+        if (role == SortRole) {
+            switch (index.column()) {
+            case TrianglesColumn: return QVariant::fromValue<qlonglong>(metrics.triangles);
+            case AreaColumn:      return metrics.area;
+            case VolumeColumn:    return metrics.volume;
+            case SizeColumn:      return metrics.size[0] * metrics.size[1] * metrics.size[2];
+            }
+        }
+
+        if (role == Qt::DisplayRole) {
+            QLocale locale;
+            switch (index.column()) {
+            case TrianglesColumn: return locale.toString(static_cast<qlonglong>(metrics.triangles));
+            case AreaColumn:      return locale.toString(metrics.area, 'f', 2);
+            case VolumeColumn:    return locale.toString(metrics.volume, 'f', 2);
+            case SizeColumn:      return QString("%1 x %2 x %3").arg(metrics.size[0], 0, 'f', 1)
+                                                               .arg(metrics.size[1], 0, 'f', 1)
+                                                               .arg(metrics.size[2], 0, 'f', 1);
+            }
+        }
+        return QVariant();
+    }
+
     /* Role represents what this data will be used for, we only need deal with the case
      * when QT is asking for data to create and display the treeview. Return a new,
      * empty QVariant if any other request comes through. */
-    if (role != Qt::DisplayRole)
+    if (role != Qt::DisplayRole && role != SortRole)
         return QVariant();
 
-    /* Get a a pointer to the item referred to by the QModelIndex */
-    ModelPart* item = static_cast<ModelPart*>( index.internalPointer() );
-
     /* Each item in the tree has a number of columns ("Part" and "Visible" in this 
      * initial example) return the column requested by the QModelIndex */
     return item->data( index.column() );
@@ -67,6 +135,68 @@ QVariant ModelPartList::headerData( int section, Qt::Orientation orientation, in
     return QVariant();
 }
 
+void ModelPartList::sort( int column, Qt::SortOrder order ) {
+    if (column < 0 || column >= ColumnCount)
+        return;
+
+    /* Sort key of a part, parts without metrics (e.g. folders) are listed last */
+    auto hasKey = [column](const ModelPart* part) {
+        return column == DefectsColumn ? part->getDefects().valid : part->getMetrics().valid;
+    };
+    auto metricKey = [column](const ModelPart* part) {
+        const MeshMetrics& m = part->getMetrics();
+        switch (column) {
+        case DefectsColumn:   return static_cast<double>(part->getDefects().total());
+        case TrianglesColumn: return static_cast<double>(m.triangles);
+        case AreaColumn:      return m.area;
+        case VolumeColumn:    return m.volume;
+        case SizeColumn:      return m.size[0] * m.size[1] * m.size[2];
+        }
+        return 0.0;
+    };
+
+    auto lessThan = [&](const ModelPart* a, const ModelPart* b) {
+        if (column == NameColumn || column == VisibleColumn) {
+            int result = QString::compare(a->data(column).toString(), b->data(column).toString(), Qt::CaseInsensitive);
+            return order == Qt::AscendingOrder ? result < 0 : result > 0;
+        }
+
+        bool aValid = hasKey(a), bValid = hasKey(b);
+        if (aValid != bValid)
+            return aValid;
+        return order == Qt::AscendingOrder ? metricKey(a) < metricKey(b) : metricKey(a) > metricKey(b);
+    };
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    /* Remember which part each persistent index (selection, current item) points at */
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QList<QPair<ModelPart*, int>> oldItems;
+    oldItems.reserve(oldIndexes.size());
+    for (const QModelIndex& index : oldIndexes)
+        oldItems.append({ static_cast<ModelPart*>(index.internalPointer()), index.column() });
+
+    /* Sort every level of the tree, each part stores its new row as its parent is sorted */
+    QList<ModelPart*> pending{ rootItem };
+    while (!pending.isEmpty()) {
+        ModelPart* parent = pending.takeLast();
+        parent->sortChildren(lessThan);
+        for (int row = 0; row < parent->childCount(); ++row) {
+            ModelPart* child = parent->child(row);
+            if (child->childCount() > 0)
+                pending.append(child);
+        }
+    }
+
+    QModelIndexList newIndexes;
+    newIndexes.reserve(oldItems.size());
+    for (const auto& item : oldItems)
+        newIndexes.append(item.first ? createIndex(item.first->row(), item.second, item.first) : QModelIndex());
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
 ModelPart* ModelPartList::getPart(const QModelIndex& index) {
     if (!index.isValid())
         return rootItem;
@@ -139,8 +269,9 @@ QModelIndex ModelPartList::appendChild(QModelIndex& parent, const QList<QVariant
     ModelPart* childPart = new ModelPart( data, parentPart );
 
     parentPart->appendChild(childPart);
+    indexNames(childPart);
 
-    QModelIndex child = createIndex(0, 0, childPart);
+    QModelIndex child = createIndex(childPart->row(), 0, childPart);
 
     endInsertRows();
 
@@ -150,39 +281,278 @@ QModelIndex ModelPartList::appendChild(QModelIndex& parent, const QList<QVariant
 }
 
 bool ModelPartList::removePart(const QModelIndex &index){
-    if (!index.isValid())
+    ModelPart* removed = takePart(index);
+    if (!removed)
         return false;
+    delete removed; // free memory, takePart() only detaches it
 
-    ModelPart* partToBeRemoved = static_cast<ModelPart*>(index.internalPointer());
-    ModelPart* parent = partToBeRemoved->parentItem();
+    emit layoutChanged(); // optional but helpful to refresh the view
+
+    qDebug() << "removePart:";
 
+    return true;
+
+}
+
+ModelPart* ModelPartList::takePart(const QModelIndex& index) {
+    if (!index.isValid())
+        return nullptr;
+
+    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+    ModelPart* parent = part->parentItem();
     if (!parent)
-        return false;
+        return nullptr;
 
-    int row = partToBeRemoved->row(); // assumes ModelPart::row() gives correct position in parent's children
+    int row = part->row(); // assumes ModelPart::row() gives correct position in parent's children
 
     beginRemoveRows(index.parent(), row, row);
-    parent->removeChild(partToBeRemoved); // make sure this deletes the child from the parent's list
-    //delete part; // free memory if you're managing raw pointers
+    unindexNames(part);
+    dropLoads(part);
+    parent->takeChild(part);
     endRemoveRows();
+    return part;
+}
 
-    emit layoutChanged(); // optional but helpful to refresh the view
+QModelIndex ModelPartList::insertPart(const QModelIndex& parent, int row, ModelPart* part) {
+    ModelPart* parentPart = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    row = std::max(0, std::min(row, parentPart->childCount()));
 
-    qDebug() << "removePart:";
+    beginInsertRows(parent, row, row);
+    parentPart->insertChild(row, part);
+    indexNames(part);
+    queueLoads(part);
+    endInsertRows();
+    return createIndex(row, 0, part);
+}
 
-    return true;
+QModelIndex ModelPartList::indexOf(ModelPart* part) const {
+    if (!part || part == rootItem || !part->parentItem())
+        return QModelIndex();
+    return createIndex(part->row(), 0, part);
+}
 
+void ModelPartList::restorePart(const QModelIndex& index, const PartStatePtr& state) {
+    if (!index.isValid() || !state)
+        return;
+
+    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+    part->restoreState(state);
+    nameIndex.add(part, state->name);
+
+    // the name, the metric columns and the defects all come from the state
+    emit dataChanged(index.siblingAtColumn(NameColumn), index.siblingAtColumn(ColumnCount - 1));
 }
 
 void ModelPartList::insertPartAtRoot(ModelPart* newPart) {
-    ModelPart* rootItem = getRootItem();
-    int row = rootItem->childCount();
+    insertParts(QModelIndex(), { newPart });
+}
 
-    beginInsertRows(QModelIndex(), row, row);
-    rootItem->appendChild(newPart);
+void ModelPartList::insertParts(const QModelIndex& parent, const QList<ModelPart*>& parts) {
+    if (parts.isEmpty())
+        return;
+
+    ModelPart* parentPart = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    int first = parentPart->childCount();
+
+    beginInsertRows(parent, first, first + parts.size() - 1);
+    parentPart->appendChildren(parts);
+    for (ModelPart* part : parts) {
+        indexNames(part);
+        queueLoads(part);
+    }
     endInsertRows();
 }
 
 ModelPart* ModelPartList::getRootItem() const {
     return rootItem; // assuming `rootItem` is a private member
 }
+
+void ModelPartList::setRootFolder(const QString& path) {
+    rootItem->setFolder(path);
+}
+
+void ModelPartList::setPartLoader(PartLoader loader) {
+    partLoader = std::move(loader);
+}
+
+bool ModelPartList::hasChildren( const QModelIndex& parent ) const {
+    if (parent.column() > 0)
+        return false;
+
+    const ModelPart* item = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    if (item->isFolder() && (!item->isFolderListed() || item->hasUnloadedParts()))
+        return true;
+    return item->childCount() > 0;
+}
+
+bool ModelPartList::canFetchMore( const QModelIndex& parent ) const {
+    if (parent.column() > 0)
+        return false;
+
+    const ModelPart* item = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    return item->isFolder() && (!item->isFolderListed() || item->hasUnloadedParts());
+}
+
+void ModelPartList::fetchMore( const QModelIndex& parent ) {
+    if (!canFetchMore(parent))
+        return;
+
+    ModelPart* folder = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : rootItem;
+    QList<ModelPart*> added;
+
+    if (!folder->isFolderListed()) {
+        QDir dir(folder->getFolder());
+
+        /* Every file gets a name-only part straight away so the search finds it before it is in the tree */
+        QList<ModelPart*> files;
+        for (const QFileInfo& info : dir.entryInfoList(QStringList() << "*.stl", QDir::Files, QDir::Name | QDir::IgnoreCase)) {
+            ModelPart* part = new ModelPart({ info.completeBaseName(), "true" });
+            part->setPendingFile(info.filePath());
+            nameIndex.add(part, info.completeBaseName());
+            files.append(part);
+        }
+        folder->setFolderListing(files);
+
+        /* Subfolders are listed first, like a file browser, their contents are only read when expanded */
+        for (const QFileInfo& info : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDir::Name | QDir::IgnoreCase)) {
+            ModelPart* subfolder = new ModelPart({ info.fileName(), QString() });
+            subfolder->setFolder(info.filePath());
+            added.append(subfolder);
+        }
+    }
+
+    /* Only the names are added here, the files are read by loadPendingParts() once the rows are showing */
+    QList<ModelPart*> fetched = folder->takeUnloadedParts(FetchBatch);
+    added.append(fetched);
+
+    insertParts(parent, added);
+    emit partsFetched(parent, fetched);
+}
+
+QList<ModelPart*> ModelPartList::addFoundParts(const QList<ModelPart*>& parts, int limit) {
+    QHash<ModelPart*, QSet<ModelPart*>> wanted;
+    int count = 0;
+    for (ModelPart* part : parts) {
+        if (count >= limit)
+            break;
+        if (ModelPart* folder = part->getListingFolder()) {
+            wanted[folder].insert(part);
+            ++count;
+        }
+    }
+
+    QList<ModelPart*> added;
+    for (auto it = wanted.constBegin(); it != wanted.constEnd(); ++it) {
+        QModelIndex folderIndex = indexOf(it.key());
+        QList<ModelPart*> taken = it.key()->takeUnloadedParts(it.value());
+        insertParts(folderIndex, taken);
+        emit partsFetched(folderIndex, taken);
+        added.append(taken);
+    }
+    return added;
+}
+
+void ModelPartList::loadPendingParts() {
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<ModelPart*> loaded;
+    QModelIndexList rows;
+    while (!pendingLoads.isEmpty() && (loaded.isEmpty() || timer.elapsed() < LoadSliceMs)) {
+        ModelPart* part = pendingLoads.takeFirst();
+        QString filePath = part->getPendingFile();
+        part->setPendingFile(QString());
+
+        if (partLoader)
+            partLoader(part, filePath);
+        else
+            part->loadSTL(filePath);
+        loaded.append(part);
+        rows.append(indexOf(part));
+    }
+
+    if (pendingLoads.isEmpty())
+        loadTimer.stop();
+    if (loaded.isEmpty())
+        return;
+
+    qDebug() << "Loaded" << loaded.size() << "parts in" << timer.elapsed() << "ms," << pendingLoads.size() << "still to load";
+    partsChanged(rows);     // the metric and defect columns
+    emit partsLoaded(loaded);
+}
+
+void ModelPartList::queueLoads(ModelPart* part) {
+    if (!part->getPendingFile().isEmpty())
+        pendingLoads.append(part);
+    for (int row = 0; row < part->childCount(); ++row)
+        queueLoads(part->child(row));
+
+    if (!pendingLoads.isEmpty() && !loadTimer.isActive())
+        loadTimer.start();
+}
+
+void ModelPartList::dropLoads(ModelPart* part) {
+    if (pendingLoads.isEmpty())
+        return;
+
+    QSet<ModelPart*> dropped;
+    QList<ModelPart*> items { part };
+    while (!items.isEmpty()) {
+        ModelPart* item = items.takeLast();
+        dropped.insert(item);
+        for (int row = 0; row < item->childCount(); ++row)
+            items.append(item->child(row));
+    }
+    pendingLoads.erase(std::remove_if(pendingLoads.begin(), pendingLoads.end(),
+                                      [&dropped](ModelPart* pending) { return dropped.contains(pending); }),
+                       pendingLoads.end());
+}
+
+void ModelPartList::renamePart(const QModelIndex& index, const QString& name) {
+    if (!index.isValid())
+        return;
+
+    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+    part->set(NameColumn, name);
+    nameIndex.add(part, name);
+
+    QModelIndex nameCell = index.siblingAtColumn(NameColumn);
+    emit dataChanged(nameCell, nameCell);
+}
+
+QList<ModelPart*> ModelPartList::findParts(const QString& text) const {
+    return nameIndex.find(text);
+}
+
+void ModelPartList::partsChanged(const QModelIndexList& indexes) {
+    // first and last row changed under each parent
+    QHash<QModelIndex, QPair<int, int>> ranges;
+    for (const QModelIndex& index : indexes) {
+        if (!index.isValid())
+            continue;
+        auto range = ranges.find(index.parent());
+        if (range == ranges.end())
+            ranges.insert(index.parent(), { index.row(), index.row() });
+        else
+            *range = { std::min(range->first, index.row()), std::max(range->second, index.row()) };
+    }
+
+    for (auto range = ranges.constBegin(); range != ranges.constEnd(); ++range)
+        emit dataChanged(index(range->first, NameColumn, range.key()), index(range->second, ColumnCount - 1, range.key()));
+}
+
+void ModelPartList::indexNames(ModelPart* part) {
+    nameIndex.add(part, part->data(NameColumn).toString());
+    for (int row = 0; row < part->childCount(); ++row)
+        indexNames(part->child(row));
+    for (ModelPart* waiting : part->getUnloadedParts())
+        nameIndex.add(waiting, waiting->data(NameColumn).toString());
+}
+
+void ModelPartList::unindexNames(ModelPart* part) {
+    nameIndex.remove(part);
+    for (int row = 0; row < part->childCount(); ++row)
+        unindexNames(part->child(row));
+    for (ModelPart* waiting : part->getUnloadedParts())
+        nameIndex.remove(waiting);
+}
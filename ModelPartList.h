@@ -12,12 +12,16 @@
 
 
 #include "ModelPart.h"
+#include "PartNameIndex.h"
 
 #include <QAbstractItemModel>
 #include <QModelIndex>
 #include <QVariant>
 #include <QString>
 #include <QList>
+#include <QTimer>
+
+#include <functional>
 
 
 
@@ -26,6 +30,33 @@ class ModelPart;
 class ModelPartList : public QAbstractItemModel {
     Q_OBJECT        /**< A special Qt tag used to indicate that this is a special Qt class that might require preprocessing before compiling. */
 public:
+    /** Columns of the tree view, the metric columns are read from each part's MeshMetrics and MeshDefects */
+    enum Column {
+        NameColumn = 0,
+        VisibleColumn,
+        TrianglesColumn,
+        AreaColumn,
+        VolumeColumn,
+        SizeColumn,
+        DefectsColumn,
+        ColumnCount
+    };
+
+    /** Role returning the raw number behind a metric column (e.g. the volume as a double) */
+    static constexpr int SortRole = Qt::UserRole + 1;
+
+    /** Most STL files of a folder added by one fetchMore(), the rest are added as the view scrolls to them */
+    static const int FetchBatch = 256;
+
+    /** Longest time (in ms) spent loading parts before the event loop gets to run again */
+    static const int LoadSliceMs = 10;
+
+    /** Loads a part's geometry after its row has been added to the tree
+      * @param part the part, already in the tree
+      * @param filePath the part's STL file
+      */
+    using PartLoader = std::function<void(ModelPart* part, const QString& filePath)>;
+
     /** Constructor
       *  Arguments are standard arguments for this type of class but are not used in this example.
       * @param data is not used
@@ -64,6 +95,15 @@ public:
       */
     QVariant headerData( int section, Qt::Orientation orientation, int role ) const;
 
+    /**
+     * @brief Sorts the children of every item in the tree by a column
+     * @note the parts are compared directly on their stored values (not through data()), and the
+     *       view is updated with a single layout change, so sorting thousands of rows is quick
+     * @param column the column to sort by, a negative column leaves the order unchanged
+     * @param order ascending or descending
+     */
+    void sort( int column, Qt::SortOrder order = Qt::AscendingOrder ) override;
+
 
     /** Get a valid QModelIndex for a location in the tree (row is the row in the tree under "parent"
       * or under the root of the tree if parent isnt specified. Column is either 0 = "Part" or 1 = "Visible"
@@ -107,6 +147,38 @@ public:
      */
     bool removePart(const QModelIndex &index);
 
+    /**
+     * @brief Takes a part out of the model without deleting it, so it can be put back later
+     * @note the part keeps everything under it, none of it can be found with findParts() until it is put back
+     * @param index The QModelIndex of the part to take out
+     * @return the part, now owned by the caller, or nullptr if the index is invalid
+     */
+    ModelPart* takePart(const QModelIndex& index);
+
+    /**
+     * @brief Puts a part (with everything under it) back into the model, see takePart()
+     * @param parent The QModelIndex of the parent item, an invalid index inserts at the root
+     * @param row position under the parent, clamped to the rows there are
+     * @param part the part, the model takes ownership of it
+     * @return The QModelIndex of the part
+     */
+    QModelIndex insertPart(const QModelIndex& parent, int row, ModelPart* part);
+
+    /**
+     * @brief Gets the index of an item in the tree
+     * @param part the item
+     * @return its index (name column), invalid for the root or an item not in a tree
+     */
+    QModelIndex indexOf(ModelPart* part) const;
+
+    /**
+     * @brief Puts back a part's saved name and geometry, see ModelPart::restoreState()
+     * @note the name index and every column of the row are updated
+     * @param index The QModelIndex of the part
+     * @param state the state to put back
+     */
+    void restorePart(const QModelIndex& index, const PartStatePtr& state);
+
     /**
      * @brief Appends a child item to the parent index
      *
@@ -125,6 +197,92 @@ public:
      */
     void insertPartAtRoot(ModelPart* newPart);
 
+    /**
+     * @brief Appends several parts under a parent item with a single row insertion
+     * @note the view is told about all of the new rows at once, so loading a folder of thousands of
+     *       parts lays the tree out once instead of once per part
+     * @param parent The QModelIndex of the parent item, an invalid index inserts at the root
+     * @param parts The parts to append, in order, the model takes ownership of them
+     */
+    void insertParts(const QModelIndex& parent, const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Makes the root of the tree show a folder on disk
+     * @note nothing is read until the view (or the caller) fetches the root, subfolders become
+     *       folder items whose contents are read when they are expanded, see fetchMore()
+     * @param path path of the folder
+     */
+    void setRootFolder(const QString& path);
+
+    /**
+     * @brief Sets how parts are loaded after their folder is fetched
+     * @param loader called for each STL file, ModelPart::loadSTL() is used if none is set
+     */
+    void setPartLoader(PartLoader loader);
+
+    /**
+     * @brief Checks if an item has children, folders that have not been read yet are assumed to
+     * @param parent the item
+     * @return true if the view should show an expand arrow for the item
+     */
+    bool hasChildren( const QModelIndex& parent = QModelIndex() ) const override;
+
+    /**
+     * @brief Checks if a folder item has contents that have not been added to the tree yet
+     * @param parent the item
+     * @return true if fetchMore() would add rows
+     */
+    bool canFetchMore( const QModelIndex& parent ) const override;
+
+    /**
+     * @brief Adds more of a folder's contents to the tree, called by the view when the folder is expanded
+     *        or scrolled to its end
+     * @note the first call lists the folder, making a name-only part for each file (indexed for
+     *       findParts() but kept out of the tree), and adds its subfolders (without reading them) and
+     *       the first FetchBatch parts, later calls add the next FetchBatch parts. The parts are added with only
+     *       their names, their files are loaded afterwards a few at a time (see LoadSliceMs) so the
+     *       view stays responsive, and only the parts added are loaded, so memory grows with what has
+     *       been looked at rather than with the size of the folder
+     * @param parent the folder item, an invalid index for the root
+     */
+    void fetchMore( const QModelIndex& parent ) override;
+
+    /**
+     * @brief Renames a part, keeping the name index up to date
+     * @param index The QModelIndex of the part
+     * @param name the new name
+     */
+    void renamePart(const QModelIndex& index, const QString& name);
+
+    /**
+     * @brief Finds the items whose name contains some text, ignoring case, see PartNameIndex
+     * @note every file of a folder is indexed as soon as the folder is listed, so parts still waiting
+     *       to be added to the tree are found too (they have a ModelPart::getListingFolder(), see
+     *       addFoundParts()). The contents of folders that have not been listed yet are not found
+     * @param text the text to look for
+     * @return the items, in no particular order, none if the text is empty
+     */
+    QList<ModelPart*> findParts(const QString& text) const;
+
+    /**
+     * @brief Adds parts found by findParts() that are still waiting in their folders to the tree
+     * @note the parts are added under their folders with one row insertion per folder, and their
+     *       files are loaded like fetched parts. partsFetched() is emitted for each folder
+     * @param parts the parts found, ones already in the tree are ignored
+     * @param limit most parts to add
+     * @return the parts added
+     */
+    QList<ModelPart*> addFoundParts(const QList<ModelPart*>& parts, int limit);
+
+    /**
+     * @brief Tells the view that several items changed, with one dataChanged() per parent
+     * @note each signal covers every column of the rows from the first to the last item changed under
+     *       that parent, so editing a selection of hundreds of parts updates the view once
+     * @param indexes the items, in any order and any column
+     */
+    void partsChanged(const QModelIndexList& indexes);
+
+
     /**
      * @brief Retrieves the root item of the part hierarchy
      * Returns a pointer to the root ModelPart, which serves as the top-level node in the model's tree structure
@@ -133,8 +291,56 @@ public:
     ModelPart* getRootItem() const;
 
 
+signals:
+    /**
+     * @brief Emitted after fetchMore() added parts to the tree, before their geometry is loaded
+     * @param folder the folder item they were added under, invalid for the root
+     * @param parts the parts added, folder items are not included
+     */
+    void partsFetched(const QModelIndex& folder, const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Emitted after a slice of fetched parts had their geometry loaded
+     * @param parts the parts loaded, their rows have already been updated
+     */
+    void partsLoaded(const QList<ModelPart*>& parts);
+
+
 private:
     ModelPart *rootItem;    /**< This is a pointer to the item at the base of the tree */
+    PartLoader partLoader;  /**< Loads the parts of fetched folders */
+    PartNameIndex nameIndex;    /**< Names of every item under the root, for findParts() */
+    QList<ModelPart*> pendingLoads; /**< Parts in the tree whose geometry is still to be loaded, oldest first */
+    QTimer loadTimer;       /**< Runs loadPendingParts() while there are parts to load */
+
+    /**
+     * @brief Loads the geometry of waiting parts until LoadSliceMs has passed (at least one part is loaded)
+     */
+    void loadPendingParts();
+
+    /**
+     * @brief Queues the parts waiting for their geometry in an item and everything under it
+     * @param part the item, just put into the tree
+     */
+    void queueLoads(ModelPart* part);
+
+    /**
+     * @brief Stops loading the geometry of an item and everything under it, they keep their files to load later
+     * @param part the item, being taken out of the tree
+     */
+    void dropLoads(ModelPart* part);
+
+    /**
+     * @brief Adds an item and everything under it to the name index
+     * @param part the item
+     */
+    void indexNames(ModelPart* part);
+
+    /**
+     * @brief Removes an item and everything under it from the name index
+     * @param part the item
+     */
+    void unindexNames(ModelPart* part);
 };
 #endif
 
@@ -0,0 +1,172 @@
+/**     @file OpenVRBackend.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     VR backend for SteamVR headsets through VTK's OpenVR module.
+  */
+
+#include "OpenVRBackend.h"
+#include "VRRuntimeProbe.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <vtkEventData.h>
+#include <vtkObjectFactory.h>
+#include <vtk_glew.h>
+
+#include <openvr.h>
+
+#include <algorithm>
+#include <initializer_list>
+
+vtkStandardNewMacro(OpenVREyeWindow);
+
+bool OpenVREyeWindow::resizeEyes(int width, int height) {
+    if (width == this->Size[0] && height == this->Size[1])
+        return true;
+
+    /* The compositor is handed the whole eye texture, so the textures themselves change size */
+    this->MakeCurrent();
+    for (FramebufferDesc* eye : { &this->LeftEyeDesc, &this->RightEyeDesc }) {
+        glDeleteRenderbuffers(1, &eye->m_nDepthBufferId);
+        glDeleteTextures(1, &eye->m_nRenderTextureId);
+        glDeleteFramebuffers(1, &eye->m_nRenderFramebufferId);
+        glDeleteTextures(1, &eye->m_nResolveTextureId);
+        glDeleteFramebuffers(1, &eye->m_nResolveFramebufferId);
+    }
+
+    this->SetSize(width, height);
+    return this->CreateFrameBuffer(width, height, this->LeftEyeDesc)
+        && this->CreateFrameBuffer(width, height, this->RightEyeDesc);
+}
+
+bool OpenVRBackend::initialise() {
+    // The renderer generates the image
+    // which is then displayed on the render window.
+    // It can be thought of as a scene to which the actor is added
+    vrRenderer = vtkSmartPointer<vtkOpenVRRenderer>::New();
+
+    /* The render window is the actual GUI window
+     * that appears on the computer screen
+     */
+    window = vtkSmartPointer<OpenVREyeWindow>::New();
+
+    /* Initialize() starts OpenVR, which the runtime probe must not be doing at the same time */
+    {
+        QMutexLocker runtimeLock(&VRRuntimeProbe::runtimeMutex());
+        window->Initialize();
+    }
+    if (!vr::VRSystem())
+        return false;
+    window->AddRenderer(vrRenderer);
+
+    /* The window starts at the headset's recommended size, the render scale is applied to this */
+    baseSize[0] = window->GetSize()[0];
+    baseSize[1] = window->GetSize()[1];
+
+    window->SetUseOffScreenBuffers(true);  // Use dedicated offscreen buffers
+    window->SetSharedRenderWindow(nullptr); // Don't share context with main window
+    window->SetMultiSamples(0);            // Disable multisampling for the context
+
+    /* Create Open VR Camera */
+    camera = vtkSmartPointer<vtkOpenVRCamera>::New();
+    vrRenderer->SetActiveCamera(camera);
+
+    /* The render window interactor captures mouse events
+     * and will perform appropriate camera or actor manipulation
+     * depending on the nature of the events.
+     */
+    vrInteractor = vtkSmartPointer<vtkOpenVRRenderWindowInteractor>::New();
+    vrInteractor->SetRenderWindow(window);
+    vrInteractor->Initialize();
+
+    /* The trigger picks parts, the observer runs before the interactor style and stops it doing its own selection */
+    selectObserver = vtkSmartPointer<vtkCallbackCommand>::New();
+    selectObserver->SetCallback(&OpenVRBackend::onSelect);
+    selectObserver->SetClientData(this);
+    selectObserver->SetAbortFlagOnExecute(1);
+    vrInteractor->AddObserver(vtkCommand::Select3DEvent, selectObserver, 1.0);
+
+    window->Render();
+    return true;
+}
+
+void OpenVRBackend::finalise() {
+    if (window)
+        window->Finalize();     // clean up the OpenVR render window
+}
+
+double OpenVRBackend::displayHz() const {
+    if (!vr::VRSystem())
+        return 0.;
+    return vr::VRSystem()->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+}
+
+void OpenVRBackend::renderFrame() {
+    /* Handles headset and controller events then draws, waiting for the compositor */
+    vrInteractor->DoOneEvent(window, vrRenderer);
+}
+
+bool OpenVRBackend::done() const {
+    return vrInteractor && vrInteractor->GetDone();
+}
+
+double OpenVRBackend::gpuFrameMs() {
+    vr::IVRCompositor* compositor = vr::VRCompositor();
+    vr::Compositor_FrameTiming timing = {};
+    timing.m_nSize = sizeof(timing);
+    if (!compositor || !compositor->GetFrameTiming(&timing, 0))
+        return 0.;
+    return timing.m_flPreSubmitGpuMs + timing.m_flPostSubmitGpuMs;
+}
+
+bool OpenVRBackend::compositorStats(CompositorStats& stats) {
+    vr::IVRCompositor* compositor = vr::VRCompositor();
+    if (!compositor)
+        return false;
+
+    vr::Compositor_CumulativeStats cumulative = {};
+    compositor->GetCumulativeStats(&cumulative, sizeof(cumulative));
+    stats.droppedFrames = cumulative.m_nNumDroppedFrames;
+    stats.reprojectedFrames = cumulative.m_nNumReprojectedFrames;
+    return true;
+}
+
+void OpenVRBackend::setSuspended(bool suspended) {
+    if (vr::VRCompositor())
+        vr::VRCompositor()->SuspendRendering(suspended);   // the headset shows SteamVR's own scene meanwhile
+}
+
+bool OpenVRBackend::takeSelectRay(double origin[3], double direction[3]) {
+    if (!selected)
+        return false;
+    for (int k = 0; k < 3; ++k) {
+        origin[k] = selectOrigin[k];
+        direction[k] = selectDirection[k];
+    }
+    selected = false;
+    return true;
+}
+
+void OpenVRBackend::onSelect(vtkObject* caller, unsigned long eventId, void* clientData, void* callData) {
+    (void)caller;
+    (void)eventId;
+    OpenVRBackend* self = static_cast<OpenVRBackend*>(clientData);
+    vtkEventData* event = static_cast<vtkEventData*>(callData);
+    vtkEventDataDevice3D* device = event ? event->GetAsEventDataDevice3D() : nullptr;
+
+    /* The event comes from DoOneEvent() in renderFrame(), so this is the VR thread */
+    if (!device || device->GetAction() != vtkEventDataAction::Press)
+        return;
+    device->GetWorldPosition(self->selectOrigin);
+    device->GetWorldDirection(self->selectDirection);
+    self->selected = true;
+}
+
+void OpenVRBackend::setRenderScale(double scale) {
+    if (baseSize[0] <= 0)
+        return;
+    if (!window->resizeEyes(std::max(1, static_cast<int>(baseSize[0] * scale)), std::max(1, static_cast<int>(baseSize[1] * scale))))
+        qWarning() << "VR eye framebuffers could not be resized to render scale" << scale;
+}
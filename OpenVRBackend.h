@@ -0,0 +1,95 @@
+/**     @file OpenVRBackend.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     VR backend for SteamVR headsets through VTK's OpenVR module.
+  */
+
+#ifndef VIEWER_OPENVRBACKEND_H
+#define VIEWER_OPENVRBACKEND_H
+
+#include "VRBackend.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkOpenVRRenderWindow.h>
+#include <vtkOpenVRRenderWindowInteractor.h>
+#include <vtkOpenVRRenderer.h>
+#include <vtkOpenVRCamera.h>
+#include <vtkCallbackCommand.h>
+
+/**
+ * @brief OpenVR render window whose eye framebuffers can be remade at another size
+ * @note the eye framebuffers are made once in Initialize() at the headset's recommended size,
+ *       SetSize() alone only shrinks the part drawn into while the whole texture is still sent
+ *       to the compositor. Uses the window's own framebuffer descriptions (VTK 9.0 / 9.1)
+ */
+class OpenVREyeWindow : public vtkOpenVRRenderWindow {
+public:
+    static OpenVREyeWindow* New();
+    vtkTypeMacro(OpenVREyeWindow, vtkOpenVRRenderWindow);
+
+    /**
+     * @brief Remakes both eye framebuffers at a new size and draws at that size from the next frame
+     * @param width width of each eye in pixels
+     * @param height height of each eye in pixels
+     * @return false if a framebuffer could not be made
+     */
+    bool resizeEyes(int width, int height);
+
+protected:
+    OpenVREyeWindow() = default;
+    ~OpenVREyeWindow() override = default;
+
+private:
+    OpenVREyeWindow(const OpenVREyeWindow&) = delete;
+    void operator=(const OpenVREyeWindow&) = delete;
+};
+
+/**
+ * @brief Draws to a SteamVR headset, frames are paced by the OpenVR compositor
+ * @note window->Render() waits in the compositor's WaitGetPoses() until the headset wants the next
+ *       frame. Frame timing and dropped/reprojected frame counts come from the compositor.
+ *       Pressing a controller's trigger selects the part it points at (see VRPicker) instead of
+ *       VTK's own 3D selection
+ */
+class OpenVRBackend : public VRBackend {
+public:
+    QString name() const override { return "openvr"; }
+    bool initialise() override;
+    void finalise() override;
+    vtkRenderer* renderer() const override { return vrRenderer; }
+    double displayHz() const override;
+    void renderFrame() override;
+    bool done() const override;
+    double gpuFrameMs() override;
+    bool compositorStats(CompositorStats& stats) override;
+    void setSuspended(bool suspended) override;
+    void setRenderScale(double scale) override;
+    bool takeSelectRay(double origin[3], double direction[3]) override;
+
+    /**
+     * @brief Gets the interactor, used for controller input
+     * @return the interactor, null before initialise()
+     */
+    vtkOpenVRRenderWindowInteractor* interactor() const { return vrInteractor; }
+
+private:
+    /**
+     * @brief Keeps the controller ray of a trigger press, observer of the interactor's Select3DEvent
+     */
+    static void onSelect(vtkObject* caller, unsigned long eventId, void* clientData, void* callData);
+
+    vtkSmartPointer<OpenVREyeWindow>                    window;         /**< Window drawing to the headset */
+    vtkSmartPointer<vtkOpenVRRenderWindowInteractor>    vrInteractor;   /**< Handles headset and controller events */
+    vtkSmartPointer<vtkOpenVRRenderer>                  vrRenderer;     /**< Renderer holding the scene */
+    vtkSmartPointer<vtkOpenVRCamera>                    camera;         /**< Camera following the headset */
+    vtkSmartPointer<vtkCallbackCommand>                 selectObserver; /**< Calls onSelect() */
+
+    int baseSize[2] = { 0, 0 };     /**< Recommended render target size, the render scale is applied to this */
+
+    bool    selected = false;                   /**< True if there is a select ray not taken yet */
+    double  selectOrigin[3] = { 0., 0., 0. };   /**< Start of the last select ray */
+    double  selectDirection[3] = { 0., 0., 1. };/**< Direction of the last select ray */
+};
+
+#endif
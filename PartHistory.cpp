@@ -0,0 +1,67 @@
+/**     @file PartHistory.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Undo commands for removing and replacing parts. Removed parts are kept
+  *     whole and replaced parts keep their saved states, so undoing either never
+  *     reads an STL file again.
+  */
+
+#include "PartHistory.h"
+
+// ----------------------------- RemovePartCommand ----------------------------------
+
+RemovePartCommand::RemovePartCommand(ModelPartList* model, const QModelIndex& index, const PartSceneHooks& hooks)
+    : model(model), hooks(hooks) {
+    part = static_cast<ModelPart*>(index.internalPointer());
+    parentPart = part->parentItem();
+    row = part->row();
+    setText(QString("Remove %1").arg(part->data(0).toString()));
+}
+
+RemovePartCommand::~RemovePartCommand() {
+    if (owned)
+        delete part;
+}
+
+void RemovePartCommand::redo() {
+    QModelIndex index = model->indexOf(part);
+    if (hooks.hide)
+        hooks.hide(index);
+
+    model->takePart(index);
+    owned = true;
+}
+
+void RemovePartCommand::undo() {
+    // the parent is never deleted while this command can be undone, a removed parent is kept by its own command
+    QModelIndex index = model->insertPart(model->indexOf(parentPart), row, part);
+    owned = false;
+
+    if (hooks.show)
+        hooks.show(index);
+}
+
+// ----------------------------- ReplacePartCommand ----------------------------------
+
+ReplacePartCommand::ReplacePartCommand(ModelPartList* model, ModelPart* part, const PartStatePtr& replacement, const PartSceneHooks& hooks)
+    : model(model), hooks(hooks), part(part), before(part->saveState()), after(replacement) {
+    setText(QString("Replace %1").arg(part->data(0).toString()));
+}
+
+void ReplacePartCommand::redo() {
+    apply(after);
+}
+
+void ReplacePartCommand::undo() {
+    apply(before);
+}
+
+void ReplacePartCommand::apply(const PartStatePtr& state) {
+    QModelIndex index = model->indexOf(part);
+    vtkSmartPointer<vtkActor> previousActor = part->getActor();
+
+    model->restorePart(index, state);
+    if (hooks.geometryChanged)
+        hooks.geometryChanged(index, previousActor);
+}
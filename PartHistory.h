@@ -0,0 +1,118 @@
+/**     @file PartHistory.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Undo commands for removing and replacing parts. Removed parts are kept
+  *     whole and replaced parts keep their saved states, so undoing either never
+  *     reads an STL file again.
+  */
+
+#ifndef VIEWER_PARTHISTORY_H
+#define VIEWER_PARTHISTORY_H
+
+#include "ModelPartList.h"
+#include "ModelPart.h"
+#include "PartState.h"
+
+#include <QModelIndex>
+#include <QUndoCommand>
+
+#include <vtkActor.h>
+
+#include <functional>
+
+/**
+ * @brief What the undo commands ask of the window as parts leave and return to the tree
+ */
+struct PartSceneHooks {
+    /** Takes a part and everything under it out of the renderers, called while it is still in the tree */
+    std::function<void(const QModelIndex& index)> hide;
+
+    /** Puts a part and everything under it back in the renderers, called once it is back in the tree */
+    std::function<void(const QModelIndex& index)> show;
+
+    /** Shows a part's restored geometry, the previous actor is still in the renderer */
+    std::function<void(const QModelIndex& index, vtkActor* previousActor)> geometryChanged;
+};
+
+/**
+ * @brief Removes a part from the tree, undoing puts the same part back where it was
+ * @note the part is only taken out of the tree, not deleted, so its actors, mesh, filters and
+ *       everything under it come back as they were. It is deleted with the command once the
+ *       removal can no longer be undone
+ */
+class RemovePartCommand : public QUndoCommand {
+public:
+    /**
+     * @brief Prepares the removal, the part is removed when the command is pushed
+     * @param model the part list
+     * @param index the part to remove
+     * @param hooks takes the part's actors out of the renderers and puts them back
+     */
+    RemovePartCommand(ModelPartList* model, const QModelIndex& index, const PartSceneHooks& hooks);
+
+    /**
+     * @brief Deletes the part if it is still out of the tree
+     */
+    ~RemovePartCommand() override;
+
+    /**
+     * @brief Takes the part out of the tree
+     */
+    void redo() override;
+
+    /**
+     * @brief Puts the part back under its parent, at its old row
+     */
+    void undo() override;
+
+private:
+    ModelPartList*  model;                  /**< Part list the part belongs to */
+    PartSceneHooks  hooks;                  /**< Updates the renderers */
+    ModelPart*      part;                   /**< The removed part */
+    ModelPart*      parentPart;             /**< Item the part was under */
+    int             row;                    /**< Row the part was at */
+    bool            owned = false;          /**< True while the part is out of the tree */
+};
+
+/**
+ * @brief Gives a part another mesh, undoing puts back the one it had
+ * @note the part's states before and after are shared with the part, see PartState, so a long
+ *       history of replacements holds each mesh once
+ */
+class ReplacePartCommand : public QUndoCommand {
+public:
+    /**
+     * @brief Prepares the replacement, the new state is applied when the command is pushed
+     * @param model the part list
+     * @param part the part to change
+     * @param replacement the name and geometry to give it
+     * @param hooks shows the part's geometry after each change
+     */
+    ReplacePartCommand(ModelPartList* model, ModelPart* part, const PartStatePtr& replacement, const PartSceneHooks& hooks);
+
+    /**
+     * @brief Gives the part the new state
+     */
+    void redo() override;
+
+    /**
+     * @brief Gives the part back its previous state
+     */
+    void undo() override;
+
+private:
+    /**
+     * @brief Puts a state into the part and shows it
+     * @param state the state
+     */
+    void apply(const PartStatePtr& state);
+
+    ModelPartList*  model;                  /**< Part list the part belongs to */
+    PartSceneHooks  hooks;                  /**< Updates the renderers */
+    ModelPart*      part;                   /**< The part being changed */
+    PartStatePtr    before;                 /**< State before the replacement */
+    PartStatePtr    after;                  /**< State after the replacement */
+};
+
+#endif
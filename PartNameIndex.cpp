@@ -0,0 +1,85 @@
+/**     @file PartNameIndex.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Trigram index over the names of the parts in the tree, so the search
+  *     box can find parts by any part of their name without reading every item.
+  */
+
+#include "PartNameIndex.h"
+
+#include <algorithm>
+
+QSet<quint64> PartNameIndex::trigramsOf(const QString& folded) {
+    QSet<quint64> keys;
+    for (int i = 0; i + 3 <= folded.size(); ++i)
+        keys.insert(trigram(folded.constData() + i));
+    return keys;
+}
+
+void PartNameIndex::add(ModelPart* part, const QString& name) {
+    remove(part);
+
+    const QString folded = name.toCaseFolded();
+    names.insert(part, folded);
+    for (quint64 key : trigramsOf(folded))
+        trigrams[key].insert(part);
+}
+
+void PartNameIndex::remove(ModelPart* part) {
+    auto it = names.find(part);
+    if (it == names.end())
+        return;
+
+    for (quint64 key : trigramsOf(it.value())) {
+        auto parts = trigrams.find(key);
+        if (parts == trigrams.end())
+            continue;
+        parts->remove(part);
+        if (parts->isEmpty())
+            trigrams.erase(parts);
+    }
+    names.erase(it);
+}
+
+void PartNameIndex::clear() {
+    names.clear();
+    trigrams.clear();
+}
+
+QList<ModelPart*> PartNameIndex::find(const QString& text) const {
+    QList<ModelPart*> found;
+    const QString folded = text.toCaseFolded();
+    if (folded.isEmpty())
+        return found;
+
+    // too short for a trigram, but one or two characters match so many parts that a scan is as quick
+    if (folded.size() < 3) {
+        for (auto it = names.constBegin(); it != names.constEnd(); ++it) {
+            if (it.value().contains(folded))
+                found.append(it.key());
+        }
+        return found;
+    }
+
+    // every trigram of the text has to be in the name, the rarest one decides which parts are checked
+    QList<const QSet<ModelPart*>*> sets;
+    for (quint64 key : trigramsOf(folded)) {
+        auto parts = trigrams.constFind(key);
+        if (parts == trigrams.constEnd())
+            return found;
+        sets.append(&parts.value());
+    }
+    std::sort(sets.begin(), sets.end(), [](const QSet<ModelPart*>* a, const QSet<ModelPart*>* b) { return a->size() < b->size(); });
+
+    for (ModelPart* part : *sets.first()) {
+        bool inAll = true;
+        for (int i = 1; i < sets.size() && inAll; ++i)
+            inAll = sets[i]->contains(part);
+
+        // the trigrams can all be there without being next to each other
+        if (inAll && names.value(part).contains(folded))
+            found.append(part);
+    }
+    return found;
+}
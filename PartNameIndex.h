@@ -0,0 +1,81 @@
+/**     @file PartNameIndex.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Trigram index over the names of the parts in the tree, so the search
+  *     box can find parts by any part of their name without reading every item.
+  */
+
+#ifndef VIEWER_PARTNAMEINDEX_H
+#define VIEWER_PARTNAMEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+class ModelPart;
+
+/**
+ * @brief Finds parts whose name contains a piece of text, ignoring case
+ * @note Every run of three characters (trigram) of each case-folded name maps to the parts whose name
+ *       has it. A search intersects the parts of the search text's trigrams, starting from the
+ *       rarest, and checks the few left against their names. Text shorter than three characters is
+ *       checked against every name. ModelPartList keeps the index up to date as parts are added,
+ *       renamed and removed
+ */
+class PartNameIndex {
+public:
+    /**
+     * @brief Adds a part, or updates its name if it is already in the index
+     * @param part the part
+     * @param name its name
+     */
+    void add(ModelPart* part, const QString& name);
+
+    /**
+     * @brief Removes a part
+     * @param part the part, nothing happens if it is not in the index
+     */
+    void remove(ModelPart* part);
+
+    /**
+     * @brief Removes every part
+     */
+    void clear();
+
+    /**
+     * @brief Finds the parts whose name contains some text, ignoring case
+     * @param text the text to look for
+     * @return the parts, in no particular order, none if the text is empty
+     */
+    QList<ModelPart*> find(const QString& text) const;
+
+    /**
+     * @brief Gets the number of parts in the index
+     * @return parts indexed
+     */
+    int size() const { return static_cast<int>(names.size()); }
+
+private:
+    /**
+     * @brief Packs three characters into one key
+     * @param c the first of the three characters
+     * @return the key
+     */
+    static quint64 trigram(const QChar* c) {
+        return (quint64(c[0].unicode()) << 32) | (quint64(c[1].unicode()) << 16) | quint64(c[2].unicode());
+    }
+
+    /**
+     * @brief Gets the distinct trigrams of a case-folded name
+     * @param folded the name
+     * @return the keys, none if the name is shorter than three characters
+     */
+    static QSet<quint64> trigramsOf(const QString& folded);
+
+    QHash<ModelPart*, QString>          names;      /**< Case-folded name of each part */
+    QHash<quint64, QSet<ModelPart*>>    trigrams;   /**< Parts whose name has each trigram */
+};
+
+#endif
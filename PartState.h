@@ -0,0 +1,43 @@
+/**     @file PartState.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Saved state of a part, kept by the undo history. The geometry is held
+  *     by reference, so a saved state costs a few pointers rather than a mesh.
+  */
+
+#ifndef VIEWER_PARTSTATE_H
+#define VIEWER_PARTSTATE_H
+
+#include "MeshMetrics.h"
+#include "MeshValidator.h"
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkSTLReader.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActor.h>
+
+#include <memory>
+
+/**
+ * @brief What a part shows and where it was loaded from, at one point in its history
+ * @note A state is never changed once made and is shared by every undo command that refers to it.
+ *       ModelPart::saveState() hands out the same state until the part changes, and a restored part
+ *       keeps the state it was restored from, so undoing and redoing does not make new ones. The
+ *       reader, mapper and actor are shared with the part, the mesh is never copied
+ */
+struct PartState {
+    QString                             name;       /**< Name shown in the tree */
+    vtkSmartPointer<vtkSTLReader>       file;       /**< Reader holding the loaded mesh */
+    vtkSmartPointer<vtkPolyDataMapper>  mapper;     /**< Mapper of the desktop actor */
+    vtkSmartPointer<vtkActor>           actor;      /**< Desktop actor */
+    MeshMetrics                         metrics;    /**< Measurements of the mesh */
+    MeshDefects                         defects;    /**< Defects found in the mesh, if it was validated */
+};
+
+/** Shared, read-only handle to a saved state */
+using PartStatePtr = std::shared_ptr<const PartState>;
+
+#endif
@@ -0,0 +1,180 @@
+/**     @file SectionView.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Section view that cuts parts open with a clipping plane applied by the
+  *     GPU when drawing, rather than by re-computing the part geometry.
+  */
+
+#include "SectionView.h"
+#include "ModelPart.h"
+
+#include <vtkNew.h>
+#include <vtkMapper.h>
+#include <vtkPlaneCollection.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkMatrix4x4.h>
+#include <vtkCutter.h>
+#include <vtkContourTriangulator.h>
+#include <vtkMath.h>
+
+SectionView::SectionView(vtkRenderer* renderer) : renderer(renderer) {
+    plane = vtkSmartPointer<vtkPlane>::New();
+    plane->SetOrigin(0, 0, 0);
+    plane->SetNormal(-1, 0, 0);
+}
+
+SectionView::~SectionView() {
+    clear();
+}
+
+void SectionView::setParts(const QList<ModelPart*>& newParts) {
+    const QList<ModelPart*> current = parts;
+    for (ModelPart* part : current) {
+        if (!newParts.contains(part))
+            forgetPart(part);
+    }
+
+    for (ModelPart* part : newParts) {
+        if (!parts.contains(part))
+            parts.append(part);
+        setPartClipped(part, true);
+    }
+
+    updateCaps();
+}
+
+void SectionView::setPlane(const double origin[3], const double normal[3]) {
+    /* The mappers read the plane every time they draw, so this is all moving it takes */
+    plane->SetOrigin(origin[0], origin[1], origin[2]);
+    plane->SetNormal(normal[0], normal[1], normal[2]);
+
+    if (capsEnabled)
+        updateCaps();
+}
+
+void SectionView::setCapsEnabled(bool enabled) {
+    capsEnabled = enabled;
+    updateCaps();
+}
+
+void SectionView::refreshPart(ModelPart* part) {
+    if (!parts.contains(part))
+        return;
+
+    setPartClipped(part, true);
+    if (capsEnabled)
+        updateCap(part);
+}
+
+void SectionView::forgetPart(ModelPart* part) {
+    if (!parts.removeOne(part))
+        return;
+
+    setPartClipped(part, false);
+
+    auto cap = caps.take(part);
+    if (cap)
+        renderer->RemoveActor(cap);
+}
+
+void SectionView::clear() {
+    const QList<ModelPart*> current = parts;
+    for (ModelPart* part : current)
+        forgetPart(part);
+}
+
+// ----------------------------- private ----------------------------------
+
+void SectionView::setPartClipped(ModelPart* part, bool clipped) {
+    /* The base and filtered actors have their own mappers, both are clipped so switching
+     * filters on and off keeps the section */
+    vtkMapper* mappers[2] = { part->getMapper(), nullptr };
+    if (part->getFiltedActor())
+        mappers[1] = part->getFiltedActor()->GetMapper();
+
+    for (vtkMapper* mapper : mappers) {
+        if (!mapper)
+            continue;
+
+        bool present = mapper->GetClippingPlanes() && mapper->GetClippingPlanes()->IsItemPresent(plane);
+        if (clipped && !present)
+            mapper->AddClippingPlane(plane);
+        else if (!clipped && present)
+            mapper->RemoveClippingPlane(plane);
+    }
+}
+
+void SectionView::updateCap(ModelPart* part) {
+    vtkSmartPointer<vtkActor> actor = part->getDisplayActor();
+    if (!actor || !actor->GetMapper())
+        return;
+
+    vtkPolyData* input = vtkPolyData::SafeDownCast(actor->GetMapper()->GetInputDataObject(0, 0));
+    if (!input)
+        return;
+
+    /* The clipping plane is in world coordinates but the part data is not, move the
+     * plane into the part's own coordinates before cutting */
+    vtkNew<vtkMatrix4x4> worldToPart;
+    vtkMatrix4x4::Invert(actor->GetMatrix(), worldToPart);
+
+    double origin[4] = { 0, 0, 0, 1 };
+    plane->GetOrigin(origin);
+    worldToPart->MultiplyPoint(origin, origin);
+
+    // normals move with the transpose of the inverse transform, i.e. the transpose of the actor matrix
+    double normal[4] = { 0, 0, 0, 0 };
+    plane->GetNormal(normal);
+    vtkNew<vtkMatrix4x4> normalTransform;
+    vtkMatrix4x4::Transpose(actor->GetMatrix(), normalTransform);
+    normalTransform->MultiplyPoint(normal, normal);
+    vtkMath::Normalize(normal);
+
+    auto localPlane = vtkSmartPointer<vtkPlane>::New();
+    localPlane->SetOrigin(origin);
+    localPlane->SetNormal(normal);
+
+    // cut the part along the plane and fill the outline
+    auto cutter = vtkSmartPointer<vtkCutter>::New();
+    cutter->SetInputData(input);
+    cutter->SetCutFunction(localPlane);
+
+    auto triangulator = vtkSmartPointer<vtkContourTriangulator>::New();
+    triangulator->SetInputConnection(cutter->GetOutputPort());
+    triangulator->Update();
+
+    auto cap = caps.value(part);
+    if (!cap) {
+        cap = vtkSmartPointer<vtkActor>::New();
+        cap->SetMapper(vtkSmartPointer<vtkPolyDataMapper>::New());
+        caps.insert(part, cap);
+        renderer->AddActor(cap);
+    }
+
+    // a copy of the output so the filters can be released
+    auto capData = vtkSmartPointer<vtkPolyData>::New();
+    capData->ShallowCopy(triangulator->GetOutput());
+    static_cast<vtkPolyDataMapper*>(cap->GetMapper())->SetInputData(capData);
+
+    // caps are not clipped themselves (they lie on the plane) and are drawn darker than the part
+    double colour[3];
+    actor->GetProperty()->GetColor(colour);
+    cap->GetProperty()->SetColor(colour[0] * 0.7, colour[1] * 0.7, colour[2] * 0.7);
+    cap->SetUserMatrix(actor->GetMatrix());
+    cap->SetVisibility(actor->GetVisibility());
+}
+
+void SectionView::updateCaps() {
+    if (!capsEnabled) {
+        for (auto cap : caps)
+            renderer->RemoveActor(cap);
+        caps.clear();
+        return;
+    }
+
+    for (ModelPart* part : parts)
+        updateCap(part);
+}
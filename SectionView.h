@@ -0,0 +1,104 @@
+/**     @file SectionView.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Section view that cuts parts open with a clipping plane applied by the
+  *     GPU when drawing, rather than by re-computing the part geometry.
+  */
+
+#ifndef VIEWER_SECTIONVIEW_H
+#define VIEWER_SECTIONVIEW_H
+
+#include <QList>
+#include <QHash>
+
+#include <vtkSmartPointer.h>
+#include <vtkPlane.h>
+#include <vtkActor.h>
+#include <vtkRenderer.h>
+
+class ModelPart;
+
+/**
+ * @brief Cuts a selection of parts (or the whole assembly) open with one plane of any orientation
+ * @note The plane is given to the part mappers as a clipping plane, so the geometry is never
+ *       changed and moving the plane only needs a redraw. Caps (the filled cross section) are
+ *       optional and are the only thing re-computed when the plane moves.
+ */
+class SectionView {
+public:
+    /**
+     * @brief Constructs the section view, nothing is cut until parts are set
+     * @param renderer the desktop renderer the cap actors are added to
+     */
+    explicit SectionView(vtkRenderer* renderer);
+
+    /**
+     * @brief Removes the plane from all parts and removes the caps
+     */
+    ~SectionView();
+
+    /**
+     * @brief Sets the parts that are cut by the plane, replacing the previous selection
+     * @param parts the parts to cut, an empty list turns the section view off
+     */
+    void setParts(const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Moves the plane
+     * @param origin a point on the plane in world coordinates
+     * @param normal the plane normal, the side the normal points to is kept
+     */
+    void setPlane(const double origin[3], const double normal[3]);
+
+    /**
+     * @brief Turns rendering of the cross section caps on or off
+     * @param enabled true to draw caps
+     */
+    void setCapsEnabled(bool enabled);
+
+    /**
+     * @brief Makes sure the part's current mappers use the plane if it is being cut
+     * @note needed when a part gets a new mapper, e.g. the first time a filter is applied
+     * @param part the part to refresh
+     */
+    void refreshPart(ModelPart* part);
+
+    /**
+     * @brief Stops cutting a part, must be called before a part is deleted
+     * @param part the part to forget
+     */
+    void forgetPart(ModelPart* part);
+
+    /**
+     * @brief Stops cutting every part
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Adds or removes the plane on every mapper of a part
+     * @param part the part to change
+     * @param clipped true to add the plane
+     */
+    void setPartClipped(ModelPart* part, bool clipped);
+
+    /**
+     * @brief Re-computes the cap of one part for the current plane
+     * @param part the part whose cap is made
+     */
+    void updateCap(ModelPart* part);
+
+    /**
+     * @brief Re-computes all caps, or removes them if caps are disabled
+     */
+    void updateCaps();
+
+    vtkRenderer*                                    renderer;       /**< Renderer the caps are drawn in */
+    vtkSmartPointer<vtkPlane>                       plane;          /**< Plane shared by every clipped mapper */
+    QList<ModelPart*>                               parts;          /**< Parts currently cut */
+    QHash<ModelPart*, vtkSmartPointer<vtkActor>>    caps;           /**< Cap actor of each part */
+    bool                                            capsEnabled = false;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/**     @file ShrinkKernel.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded shrink for triangle meshes that can update its previous
+  *     output in place when only the shrink factor changes.
+  */
+
+#include "ShrinkKernel.h"
+
+#include <vtkSMPTools.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkIdTypeArray.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+namespace {
+
+/* Writes the shrunk corners of every triangle, triangle t owns output points 3t, 3t+1 and 3t+2 */
+template <typename P, typename IdT>
+void shrinkTriangles(const P* p, const IdT* conn, vtkIdType nTris, double factor, P* out) {
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            const P* a = p + 3 * conn[3 * t];
+            const P* b = p + 3 * conn[3 * t + 1];
+            const P* c = p + 3 * conn[3 * t + 2];
+            P* o = out + 9 * t;
+
+            for (int k = 0; k < 3; ++k) {
+                double centre = (static_cast<double>(a[k]) + b[k] + c[k]) / 3.0;
+                o[k]     = static_cast<P>(centre + factor * (a[k] - centre));
+                o[3 + k] = static_cast<P>(centre + factor * (b[k] - centre));
+                o[6 + k] = static_cast<P>(centre + factor * (c[k] - centre));
+            }
+        }
+    });
+}
+
+template <typename P>
+void shrinkTyped(vtkPolyData* input, double factor, vtkPoints* outPoints) {
+    const P* p = static_cast<const P*>(input->GetPoints()->GetVoidPointer(0));
+    P* out = static_cast<P*>(outPoints->GetVoidPointer(0));
+    vtkCellArray* polys = input->GetPolys();
+
+    if (polys->IsStorage64Bit())
+        shrinkTriangles(p, polys->GetConnectivityArray64()->GetPointer(0), polys->GetNumberOfCells(), factor, out);
+    else
+        shrinkTriangles(p, polys->GetConnectivityArray32()->GetPointer(0), polys->GetNumberOfCells(), factor, out);
+}
+
+void shrinkPoints(vtkPolyData* input, double factor, vtkPoints* outPoints) {
+    if (input->GetPoints()->GetDataType() == VTK_FLOAT)
+        shrinkTyped<float>(input, factor, outPoints);
+    else
+        shrinkTyped<double>(input, factor, outPoints);
+}
+}
+
+bool ShrinkKernel::canShrink(vtkPolyData* input) {
+    if (!input || !input->GetPoints())
+        return false;
+
+    int type = input->GetPoints()->GetDataType();
+    if (type != VTK_FLOAT && type != VTK_DOUBLE)
+        return false;
+
+    return input->GetNumberOfVerts() == 0 && input->GetNumberOfLines() == 0 &&
+           input->GetNumberOfStrips() == 0 && input->GetPolys()->IsHomogeneous() == 3;
+}
+
+vtkSmartPointer<vtkPolyData> ShrinkKernel::shrink(vtkPolyData* input, double factor) {
+    const vtkIdType nTris = input->GetNumberOfPolys();
+
+    auto outPoints = vtkSmartPointer<vtkPoints>::New();
+    outPoints->SetDataType(input->GetPoints()->GetDataType());
+    outPoints->SetNumberOfPoints(3 * nTris);
+    shrinkPoints(input, factor, outPoints);
+
+    // triangle t is made of points 3t, 3t+1, 3t+2
+    auto connectivity = vtkSmartPointer<vtkIdTypeArray>::New();
+    connectivity->SetNumberOfValues(3 * nTris);
+    auto offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->SetNumberOfValues(nTris + 1);
+
+    vtkIdType* conn = connectivity->GetPointer(0);
+    vtkIdType* offs = offsets->GetPointer(0);
+    vtkSMPTools::For(0, nTris + 1, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            offs[t] = 3 * t;
+            if (t < nTris) {
+                conn[3 * t] = 3 * t;
+                conn[3 * t + 1] = 3 * t + 1;
+                conn[3 * t + 2] = 3 * t + 2;
+            }
+        }
+    });
+
+    auto polys = vtkSmartPointer<vtkCellArray>::New();
+    polys->SetData(offsets, connectivity);
+
+    auto output = vtkSmartPointer<vtkPolyData>::New();
+    output->SetPoints(outPoints);
+    output->SetPolys(polys);
+    return output;
+}
+
+bool ShrinkKernel::shrinkInto(vtkPolyData* input, double factor, vtkPolyData* output) {
+    if (!canShrink(input) || !output || !output->GetPoints())
+        return false;
+
+    vtkPoints* outPoints = output->GetPoints();
+    if (outPoints->GetNumberOfPoints() != 3 * input->GetNumberOfPolys() ||
+        outPoints->GetDataType() != input->GetPoints()->GetDataType())
+        return false;
+
+    shrinkPoints(input, factor, outPoints);
+
+    // marks the points as changed so the mapper uploads them once on the next render
+    outPoints->Modified();
+    return true;
+}
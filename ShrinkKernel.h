@@ -0,0 +1,49 @@
+/**     @file ShrinkKernel.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded shrink for triangle meshes that can update its previous
+  *     output in place when only the shrink factor changes.
+  */
+
+#ifndef VIEWER_SHRINKKERNEL_H
+#define VIEWER_SHRINKKERNEL_H
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/**
+ * @brief Shrinks every triangle of a mesh towards its centre, like vtkShrinkPolyData
+ * @note The output gives each triangle its own three points. Its layout only depends on the
+ *       number of input triangles, so changing the factor rewrites the points of an existing
+ *       output without any allocation, and the mapper only has to upload the points again.
+ *       Work is split across threads with vtkSMPTools.
+ */
+class ShrinkKernel {
+public:
+    /**
+     * @brief Checks if the kernel can shrink the data
+     * @param input the data to check
+     * @return true if the data only holds triangles, otherwise vtkShrinkPolyData has to be used
+     */
+    static bool canShrink(vtkPolyData* input);
+
+    /**
+     * @brief Makes a new shrunk copy of the data
+     * @param input triangle mesh, see canShrink()
+     * @param factor shrink factor in the range (0->1), 1 leaves the triangles unchanged
+     * @return the shrunk mesh
+     */
+    static vtkSmartPointer<vtkPolyData> shrink(vtkPolyData* input, double factor);
+
+    /**
+     * @brief Rewrites the points of an earlier output of shrink() for a new factor
+     * @param input the same data the output was made from
+     * @param factor new shrink factor in the range (0->1)
+     * @param output earlier output of shrink(), updated in place
+     * @return false if the output does not match the input and must be made again
+     */
+    static bool shrinkInto(vtkPolyData* input, double factor, vtkPolyData* output);
+};
+
+#endif
@@ -0,0 +1,175 @@
+/**     @file SmoothKernel.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded Laplacian and Taubin smoothing for triangle meshes.
+  */
+
+#include "SmoothKernel.h"
+
+#include <vtkSMPTools.h>
+#include <vtkCellArray.h>
+#include <vtkPoints.h>
+#include <vtkPointData.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using DirectedEdge = std::pair<vtkIdType, vtkIdType>;
+
+/* Neighbours of every point in compressed form, the neighbours of point v are
+ * neighbours[offsets[v]] to neighbours[offsets[v + 1] - 1] */
+struct Neighbours {
+    std::vector<vtkIdType> offsets;
+    std::vector<vtkIdType> neighbours;
+};
+
+template <typename IdT>
+void collectEdges(const IdT* conn, vtkIdType nTris, std::vector<DirectedEdge>& edges) {
+    edges.resize(6 * nTris);
+    vtkSMPTools::For(0, nTris, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType t = first; t < last; ++t) {
+            vtkIdType a = conn[3 * t], b = conn[3 * t + 1], c = conn[3 * t + 2];
+            DirectedEdge* e = edges.data() + 6 * t;
+            e[0] = { a, b }; e[1] = { b, a };
+            e[2] = { b, c }; e[3] = { c, b };
+            e[4] = { c, a }; e[5] = { a, c };
+        }
+    });
+}
+
+Neighbours buildNeighbours(vtkPolyData* input) {
+    vtkCellArray* polys = input->GetPolys();
+    const vtkIdType nTris = polys->GetNumberOfCells();
+    const vtkIdType nPoints = input->GetNumberOfPoints();
+
+    // every triangle adds both directions of its three edges, shared edges are removed by the sort
+    std::vector<DirectedEdge> edges;
+    if (polys->IsStorage64Bit())
+        collectEdges(polys->GetConnectivityArray64()->GetPointer(0), nTris, edges);
+    else
+        collectEdges(polys->GetConnectivityArray32()->GetPointer(0), nTris, edges);
+
+    vtkSMPTools::Sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    Neighbours result;
+    result.offsets.resize(nPoints + 1);
+    result.neighbours.resize(edges.size());
+
+    vtkSMPTools::For(0, nPoints + 1, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType v = first; v < last; ++v) {
+            auto it = std::lower_bound(edges.begin(), edges.end(), v,
+                                       [](const DirectedEdge& e, vtkIdType id) { return e.first < id; });
+            result.offsets[v] = it - edges.begin();
+        }
+    });
+    vtkSMPTools::For(0, static_cast<vtkIdType>(edges.size()), [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; ++i)
+            result.neighbours[i] = edges[i].second;
+    });
+    return result;
+}
+
+/* One smoothing pass, points without neighbours are copied unchanged */
+void smoothPass(const Neighbours& n, const std::vector<double>& in, std::vector<double>& out, double factor) {
+    const vtkIdType nPoints = static_cast<vtkIdType>(n.offsets.size()) - 1;
+    vtkSMPTools::For(0, nPoints, [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType v = first; v < last; ++v) {
+            const double* p = in.data() + 3 * v;
+            double* o = out.data() + 3 * v;
+            const vtkIdType begin = n.offsets[v], end = n.offsets[v + 1];
+
+            if (begin == end) {
+                o[0] = p[0]; o[1] = p[1]; o[2] = p[2];
+                continue;
+            }
+
+            double sum[3] = { 0, 0, 0 };
+            for (vtkIdType i = begin; i < end; ++i) {
+                const double* q = in.data() + 3 * n.neighbours[i];
+                sum[0] += q[0]; sum[1] += q[1]; sum[2] += q[2];
+            }
+            const double count = static_cast<double>(end - begin);
+            for (int k = 0; k < 3; ++k)
+                o[k] = p[k] + factor * (sum[k] / count - p[k]);
+        }
+    });
+}
+
+template <typename P>
+void copyPointsTyped(vtkPoints* points, std::vector<double>& values, bool toPoints) {
+    P* p = static_cast<P*>(points->GetVoidPointer(0));
+    vtkSMPTools::For(0, static_cast<vtkIdType>(values.size()), [&](vtkIdType first, vtkIdType last) {
+        for (vtkIdType i = first; i < last; ++i) {
+            if (toPoints)
+                p[i] = static_cast<P>(values[i]);
+            else
+                values[i] = p[i];
+        }
+    });
+}
+
+void copyPoints(vtkPoints* points, std::vector<double>& values, bool toPoints) {
+    if (points->GetDataType() == VTK_FLOAT)
+        copyPointsTyped<float>(points, values, toPoints);
+    else
+        copyPointsTyped<double>(points, values, toPoints);
+}
+
+bool isCancelled(const std::atomic<bool>* cancel) {
+    return cancel && cancel->load(std::memory_order_relaxed);
+}
+}
+
+bool SmoothKernel::canSmooth(vtkPolyData* input) {
+    if (!input || !input->GetPoints())
+        return false;
+
+    int type = input->GetPoints()->GetDataType();
+    if (type != VTK_FLOAT && type != VTK_DOUBLE)
+        return false;
+
+    return input->GetNumberOfVerts() == 0 && input->GetNumberOfLines() == 0 &&
+           input->GetNumberOfStrips() == 0 && input->GetPolys()->IsHomogeneous() == 3;
+}
+
+vtkSmartPointer<vtkPolyData> SmoothKernel::smooth(vtkPolyData* input, int iterations, double lambda, double mu,
+                                                  const std::atomic<bool>* cancel) {
+    const Neighbours neighbours = buildNeighbours(input);
+
+    std::vector<double> current(3 * input->GetNumberOfPoints());
+    std::vector<double> next(current.size());
+    copyPoints(input->GetPoints(), current, false);
+
+    for (int i = 0; i < iterations; ++i) {
+        if (isCancelled(cancel))
+            return nullptr;
+
+        smoothPass(neighbours, current, next, lambda);
+        std::swap(current, next);
+
+        // Taubin: pull the mesh back out so it keeps its size
+        if (mu != 0.0) {
+            smoothPass(neighbours, current, next, mu);
+            std::swap(current, next);
+        }
+    }
+
+    auto outPoints = vtkSmartPointer<vtkPoints>::New();
+    outPoints->SetDataType(input->GetPoints()->GetDataType());
+    outPoints->SetNumberOfPoints(input->GetNumberOfPoints());
+    copyPoints(outPoints, current, true);
+
+    // the cells are shared, the input normals no longer match the moved points
+    auto output = vtkSmartPointer<vtkPolyData>::New();
+    output->ShallowCopy(input);
+    output->SetPoints(outPoints);
+    output->GetPointData()->SetNormals(nullptr);
+    return output;
+}
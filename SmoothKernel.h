@@ -0,0 +1,46 @@
+/**     @file SmoothKernel.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Multi-threaded Laplacian and Taubin smoothing for triangle meshes.
+  */
+
+#ifndef VIEWER_SMOOTHKERNEL_H
+#define VIEWER_SMOOTHKERNEL_H
+
+#include <atomic>
+
+#include <vtkSmartPointer.h>
+#include <vtkPolyData.h>
+
+/**
+ * @brief Moves every point of a triangle mesh towards the average of its neighbours
+ * @note Laplacian smoothing shrinks the mesh a little on every pass. Taubin smoothing follows
+ *       each Laplacian pass with a pass using a negative factor, which removes noise without
+ *       the shrinking. The neighbour lists are built once with a parallel sort and every pass
+ *       updates all points in parallel with vtkSMPTools. Only the points change, the cells of
+ *       the output are shared with the input.
+ */
+class SmoothKernel {
+public:
+    /**
+     * @brief Checks if the kernel can smooth the data
+     * @param input the data to check
+     * @return true if the data only holds triangles, otherwise vtkSmoothPolyDataFilter has to be used
+     */
+    static bool canSmooth(vtkPolyData* input);
+
+    /**
+     * @brief Makes a smoothed copy of the data
+     * @param input triangle mesh, see canSmooth()
+     * @param iterations number of passes (for Taubin, number of lambda/mu pass pairs)
+     * @param lambda factor moving each point towards the average of its neighbours (0->1)
+     * @param mu factor of the second Taubin pass (negative, slightly larger than lambda), or 0 for Laplacian
+     * @param cancel optional flag, checked between passes
+     * @return the smoothed mesh, or nullptr if cancelled
+     */
+    static vtkSmartPointer<vtkPolyData> smooth(vtkPolyData* input, int iterations, double lambda, double mu,
+                                               const std::atomic<bool>* cancel = nullptr);
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**     @file SpscQueue.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Bounded lock-free queue for passing data from one thread to one other thread.
+  */
+
+#ifndef VIEWER_SPSCQUEUE_H
+#define VIEWER_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Fixed size ring buffer with one producer thread and one consumer thread
+ * @note Neither side ever waits for a lock. The producer only writes the tail and the consumer only
+ *       writes the head, each on its own cache line, and a slot is published with a release store
+ *       so the consumer sees the whole value. Calling tryPush() from two threads (or tryPop() from
+ *       two threads) at once is not safe
+ * @tparam T element type, must be default constructible and movable
+ * @tparam Capacity number of slots, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    /**
+     * @brief Adds an element, only call from the producer thread
+     * @param value element to add, moved into the queue
+     * @return false if the queue is full, the value is left unchanged
+     */
+    bool tryPush(T&& value) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        slots[t & (Capacity - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Takes the oldest element, only call from the consumer thread
+     * @param value set to the element
+     * @return false if the queue is empty
+     */
+    bool tryPop(T& value) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+
+        // the slot is reset so it does not keep anything it refers to alive
+        T& slot = slots[h & (Capacity - 1)];
+        value = std::move(slot);
+        slot = T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Checks if the queue is empty, the answer may be out of date as soon as it returns
+     * @return true if there was nothing to pop
+     */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head{ 0 };     /**< Next slot to read, only written by the consumer */
+    alignas(64) std::atomic<size_t> tail{ 0 };     /**< Next slot to write, only written by the producer */
+    alignas(64) std::array<T, Capacity> slots;     /**< Ring buffer storage */
+};
+
+#endif
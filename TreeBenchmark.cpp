@@ -0,0 +1,134 @@
+/**     @file TreeBenchmark.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Fills the parts tree with many empty parts and times inserting them,
+  *     walking the model the way the view does, scrolling a tree view
+  *     through them and searching their names. Built with -DVRMV_BUILD_BENCHMARKS=ON.
+  *
+  *     TreeBenchmark [--parts N] [--folders N]
+  */
+
+#include "ModelPartList.h"
+#include "ModelPart.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QTextStream>
+#include <QTreeView>
+
+#include <algorithm>
+
+/**
+ * @brief Makes parts without geometry, named like the parts of a loaded folder
+ * @param count number of parts
+ * @param first number of the first part, used in the names
+ * @return the parts, not yet in a tree
+ */
+static QList<ModelPart*> makeParts(int count, int first) {
+    QList<ModelPart*> parts;
+    parts.reserve(count);
+    for (int i = 0; i < count; ++i)
+        parts.append(new ModelPart({ QString("part_%1").arg(first + i, 6, 10, QChar('0')), "true" }));
+    return parts;
+}
+
+int main(int argc, char *argv[])
+{
+    // the view is never shown on screen
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times filling and scrolling the parts tree");
+    parser.addHelpOption();
+    parser.addOption({ "parts", "Number of parts in the tree.", "count", "100000" });
+    parser.addOption({ "folders", "Folders the parts are split across, 0 puts them all at the root.", "count", "0" });
+    parser.process(app);
+
+    const int parts = std::max(1, parser.value("parts").toInt());
+    const int folders = std::max(0, parser.value("folders").toInt());
+
+    QTextStream out(stdout);
+    out << "Tree benchmark: " << parts << " parts";
+    if (folders > 0)
+        out << " in " << folders << " folders";
+    out << Qt::endl;
+
+    ModelPartList model("Parts List");
+    QTreeView view;
+    view.setModel(&model);
+    view.resize(800, 600);
+    view.show();
+    if (folders > 0)
+        view.expandAll();   // expanded before the parts go in, so they are laid out as they are inserted
+    app.processEvents();
+
+    // one insertion per folder (or one for the whole root), as loadFolderAsTree() does
+    QElapsedTimer timer;
+    timer.start();
+    if (folders == 0) {
+        model.insertParts(QModelIndex(), makeParts(parts, 0));
+    } else {
+        QList<ModelPart*> folderParts = makeParts(folders, 0);
+        model.insertParts(QModelIndex(), folderParts);
+        for (int f = 0; f < folders; ++f) {
+            const int first = static_cast<int>(static_cast<qint64>(parts) * f / folders);
+            const int last = static_cast<int>(static_cast<qint64>(parts) * (f + 1) / folders);
+            model.insertParts(model.index(f, 0, QModelIndex()), makeParts(last - first, first));
+        }
+    }
+    app.processEvents();
+    out << "insert:          " << timer.elapsed() << " ms" << Qt::endl;
+
+    // index() and parent() for every part, which is what the view does for each row it lays out
+    timer.restart();
+    qint64 rows = 0;
+    QList<QModelIndex> pending{ QModelIndex() };
+    while (!pending.isEmpty()) {
+        const QModelIndex parent = pending.takeLast();
+        const int count = model.rowCount(parent);
+        for (int row = 0; row < count; ++row) {
+            const QModelIndex child = model.index(row, 0, parent);
+            if (model.parent(child) != parent)
+                out << "parent() is wrong for row " << row << Qt::endl;
+            if (model.rowCount(child) > 0)
+                pending.append(child);
+            rows++;
+        }
+    }
+    out << "index/parent:    " << timer.elapsed() << " ms for " << rows << " rows" << Qt::endl;
+
+    // scroll from top to bottom a page at a time, drawing each page
+    QScrollBar* scrollBar = view.verticalScrollBar();
+    const int pages = std::max(1, std::min(1000, scrollBar->maximum() / std::max(1, scrollBar->pageStep())));
+    timer.restart();
+    for (int page = 0; page <= pages; ++page) {
+        scrollBar->setValue(static_cast<int>(static_cast<qint64>(scrollBar->maximum()) * page / pages));
+        view.viewport()->repaint();
+    }
+    const qint64 scrollMs = timer.elapsed();
+    out << "scroll:          " << scrollMs << " ms for " << pages + 1 << " pages, "
+        << static_cast<double>(scrollMs) / (pages + 1) << " ms per page" << Qt::endl;
+
+    // searches of different lengths through the name index, the part names are "part_000000" onwards
+    for (const QString& text : { QString("7"), QString("t_0"), QString("12"), QString("4242"), QString("part_0999"), QString("none") }) {
+        QElapsedTimer searchTimer;
+        searchTimer.start();
+        const qint64 found = model.findParts(text).size();
+        out << "search \"" << text << "\": " << static_cast<double>(searchTimer.nsecsElapsed()) / 1e6 << " ms, "
+            << found << " parts" << Qt::endl;
+    }
+
+    // sorting keeps the selection, so select one part to include updating a persistent index
+    view.setCurrentIndex(model.index(model.rowCount(QModelIndex()) - 1, 0, QModelIndex()));
+    timer.restart();
+    model.sort(ModelPartList::NameColumn, Qt::DescendingOrder);
+    app.processEvents();
+    out << "sort:            " << timer.elapsed() << " ms" << Qt::endl;
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+/**     @file VRBackend.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Interface between VRRenderThread and the VR runtime, so the same
+  *     render loop can drive a SteamVR headset or a headless stand-in.
+  */
+
+#include "VRBackend.h"
+#include "MockVRBackend.h"
+#ifdef VRMV_WITH_OPENVR
+#include "OpenVRBackend.h"
+#endif
+
+#include <QDebug>
+
+QString VRBackend::selectedName() {
+    QString requested = qEnvironmentVariable("VRMV_VR_BACKEND").trimmed().toLower();
+
+#ifdef VRMV_WITH_OPENVR
+    if (requested.isEmpty() || requested == "openvr")
+        return "openvr";
+#else
+    if (requested == "openvr")
+        qDebug() << "Built without OpenVR, using the mock VR backend";
+#endif
+    return "mock";
+}
+
+std::unique_ptr<VRBackend> VRBackend::create() {
+#ifdef VRMV_WITH_OPENVR
+    if (selectedName() == "openvr")
+        return std::make_unique<OpenVRBackend>();
+#endif
+    return std::make_unique<MockVRBackend>();
+}
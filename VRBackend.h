@@ -0,0 +1,127 @@
+/**     @file VRBackend.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Interface between VRRenderThread and the VR runtime, so the same
+  *     render loop can drive a SteamVR headset or a headless stand-in.
+  */
+
+#ifndef VIEWER_VRBACKEND_H
+#define VIEWER_VRBACKEND_H
+
+#include <QString>
+
+#include <vtkRenderer.h>
+
+#include <memory>
+
+/**
+ * @brief Owns the VR window and talks to the VR runtime for VRRenderThread
+ * @note Every function except the factory is called on the VR thread. The backend is picked at
+ *       run time with the VRMV_VR_BACKEND environment variable ("openvr" or "mock"). Without it,
+ *       OpenVR is used if the program was built with it (VRMV_WITH_OPENVR) and the mock otherwise
+ */
+class VRBackend {
+public:
+    /** Frame counters kept by the compositor since the backend started */
+    struct CompositorStats {
+        qint64  droppedFrames = 0;      /**< Frames that missed their deadline */
+        qint64  reprojectedFrames = 0;  /**< Frames the compositor had to reproject */
+    };
+
+    virtual ~VRBackend() = default;
+
+    /**
+     * @brief Makes the backend picked by VRMV_VR_BACKEND, see the class note
+     * @return the backend, not yet initialised
+     */
+    static std::unique_ptr<VRBackend> create();
+
+    /**
+     * @brief Gets the name of the backend create() would make
+     * @return "openvr" or "mock"
+     */
+    static QString selectedName();
+
+    /**
+     * @brief Gets the name of this backend
+     * @return "openvr" or "mock"
+     */
+    virtual QString name() const = 0;
+
+    /**
+     * @brief Starts the runtime and creates the window, renderer and camera
+     * @return false if the runtime could not be started
+     */
+    virtual bool initialise() = 0;
+
+    /**
+     * @brief Closes the window, called when the VR thread is destroyed
+     */
+    virtual void finalise() = 0;
+
+    /**
+     * @brief Gets the renderer the scene is added to
+     * @return the renderer, null before initialise()
+     */
+    virtual vtkRenderer* renderer() const = 0;
+
+    /**
+     * @brief Gets the refresh rate of the display
+     * @return frames per second, 0 if unknown
+     */
+    virtual double displayHz() const = 0;
+
+    /**
+     * @brief Draws one frame for both eyes, waiting for the runtime if it paces frames
+     */
+    virtual void renderFrame() = 0;
+
+    /**
+     * @brief Checks if the user closed the session from the runtime's side
+     * @return true if the render loop should end
+     */
+    virtual bool done() const = 0;
+
+    /**
+     * @brief Gets the GPU time of the last frame
+     * @return milliseconds, 0 if not measured
+     */
+    virtual double gpuFrameMs() = 0;
+
+    /**
+     * @brief Gets how long each eye of the last frame took to draw
+     * @param ms set to the left and right eye times in milliseconds
+     * @return false if the backend does not time eyes separately
+     */
+    virtual bool eyeFrameMs(double ms[2]) const { (void)ms; return false; }
+
+    /**
+     * @brief Reads the compositor's frame counters
+     * @param stats set to the counters
+     * @return false if they are not available
+     */
+    virtual bool compositorStats(CompositorStats& stats) = 0;
+
+    /**
+     * @brief Stops or restarts showing frames while the session is paused
+     * @param suspended true to stop
+     */
+    virtual void setSuspended(bool suspended) { (void)suspended; }
+
+    /**
+     * @brief Draws at a fraction of the full eye resolution, see VRFrameGovernor
+     * @param scale fraction of the full size
+     */
+    virtual void setRenderScale(double scale) = 0;
+
+    /**
+     * @brief Takes the ray of a select press on a controller, if there was one since the last call
+     * @param origin set to the start of the ray, in world coordinates
+     * @param direction set to the direction of the ray, in world coordinates
+     * @return false if nothing was selected
+     */
+    virtual bool takeSelectRay(double origin[3], double direction[3]) { (void)origin; (void)direction; return false; }
+};
+
+#endif
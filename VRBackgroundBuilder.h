@@ -0,0 +1,166 @@
+/**     @file VRBackgroundBuilder.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Background thread turning part geometry into something the VR thread
+  *     needs (detail levels, pick hierarchies) without stalling a frame.
+  */
+
+#ifndef VIEWER_VRBACKGROUNDBUILDER_H
+#define VIEWER_VRBACKGROUNDBUILDER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <memory>
+
+/**
+ * @brief Low priority thread running one build function on the geometry of VR parts
+ * @note Only the newest request for an actor is worked on, a request replaced or cancelled while
+ *       it runs is thrown away when it finishes. Each request is given its own data object sharing
+ *       the part's arrays, both threads only read them
+ * @tparam Output what the build function makes, must be copyable
+ */
+template <typename Output>
+class VRBackgroundBuilder : public QThread {
+public:
+    /** Function making the output for one part's geometry, run on the builder thread */
+    typedef Output (*Build)(vtkPolyData* data);
+
+    /** Output made for one request */
+    struct Result {
+        vtkSmartPointer<vtkActor>   actor;              /**< Actor the output is for */
+        int                         generation = -1;    /**< Generation of the request */
+        Output                      output;             /**< What the build function made */
+    };
+
+    /**
+     * @brief Constructs the builder, the thread is started straight away
+     * @param build function run for each request
+     */
+    explicit VRBackgroundBuilder(Build build) : build(build) {
+        start(QThread::LowPriority);
+    }
+
+    /**
+     * @brief Stops the thread and waits for it to finish
+     */
+    ~VRBackgroundBuilder() {
+        {
+            QMutexLocker lock(&mutex);
+            quit = true;
+            wake.wakeAll();
+        }
+        wait();
+    }
+
+    /**
+     * @brief Requests an output for an actor, replacing any request for it that has not finished
+     * @param actor actor the output is for
+     * @param generation number identifying the request, returned with its result
+     * @param data geometry of the part, only read (through a shallow copy) by the builder
+     * @param share share of the filter cache entry holding data, kept until the request is done so
+     *        the arrays are not rewritten in place while they are read, see FilterPipeline::shareOutput()
+     */
+    void submit(vtkActor* actor, int generation, vtkPolyData* data, std::shared_ptr<int> share = std::shared_ptr<int>()) {
+        auto copy = vtkSmartPointer<vtkPolyData>::New();
+        copy->ShallowCopy(data);
+
+        QMutexLocker lock(&mutex);
+        latest[actor] = generation;
+        dropJobs(actor);
+
+        Job job;
+        job.actor = actor;
+        job.generation = generation;
+        job.data = copy;
+        job.share = std::move(share);
+        jobs.append(job);
+        wake.wakeAll();
+    }
+
+    /**
+     * @brief Drops any request for an actor
+     * @param actor actor of the part
+     */
+    void cancel(vtkActor* actor) {
+        QMutexLocker lock(&mutex);
+        latest.remove(actor);
+        dropJobs(actor);
+        results.erase(std::remove_if(results.begin(), results.end(), [actor](const Result& result) { return result.actor == actor; }), results.end());
+    }
+
+    /**
+     * @brief Takes the results finished since the last call
+     * @return the results, oldest first
+     */
+    QList<Result> takeResults() {
+        QMutexLocker lock(&mutex);
+        QList<Result> taken;
+        taken.swap(results);
+        return taken;
+    }
+
+protected:
+    /** This is a re-implementation of a QThread function
+      */
+    void run() override {
+        forever {
+            Job job;
+            {
+                QMutexLocker lock(&mutex);
+                while (!quit && jobs.isEmpty())
+                    wake.wait(&mutex);
+                if (quit)
+                    return;
+                job = jobs.takeFirst();
+            }
+
+            Output output = build(job.data);
+
+            // the part may have been removed or given new geometry while this was being made
+            QMutexLocker lock(&mutex);
+            if (latest.value(job.actor.GetPointer(), -1) != job.generation)
+                continue;
+
+            Result result;
+            result.actor = job.actor;
+            result.generation = job.generation;
+            result.output = output;
+            results.append(result);
+        }
+    }
+
+private:
+    /** A request waiting to be run */
+    struct Job {
+        vtkSmartPointer<vtkActor>       actor;
+        int                             generation = -1;
+        vtkSmartPointer<vtkPolyData>    data;
+        std::shared_ptr<int>            share;      /**< Keeps the filter output holding data from being rewritten */
+    };
+
+    /* Removes the waiting requests of an actor, the mutex must be held */
+    void dropJobs(vtkActor* actor) {
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [actor](const Job& job) { return job.actor == actor; }), jobs.end());
+    }
+
+    const Build             build;      /**< Run for each request */
+    QMutex                  mutex;      /**< Guards everything below */
+    QWaitCondition          wake;       /**< Wakes the thread when a job is submitted or it should quit */
+    QList<Job>              jobs;       /**< Requests not yet started, oldest first */
+    QList<Result>           results;    /**< Finished requests not yet taken */
+    QHash<vtkActor*, int>   latest;     /**< Newest generation requested for each actor */
+    bool                    quit = false;
+};
+
+#endif
@@ -0,0 +1,104 @@
+/**     @file VRBenchmark.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Runs the VR render thread headless with the mock backend and prints
+  *     its frame timing, so changes to the VR loop can be measured without
+  *     a headset. Built with -DVRMV_BUILD_BENCHMARKS=ON.
+  *
+  *     VRBenchmark [--parts N] [--triangles N] [--seconds N] [--lod-error PIXELS]
+  */
+
+#include "VRRenderThread.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include <vtkSmartPointer.h>
+#include <vtkSphereSource.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkActor.h>
+#include <vtkProperty.h>
+
+#include <algorithm>
+#include <cmath>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the VR render loop with the headless mock backend");
+    parser.addHelpOption();
+    parser.addOption({ "parts", "Number of parts in the scene.", "count", "200" });
+    parser.addOption({ "triangles", "Triangles per part.", "count", "20000" });
+    parser.addOption({ "seconds", "How long to run the loop for.", "seconds", "10" });
+    parser.addOption({ "lod-error", "Screen-space error threshold of the level of detail.", "pixels",
+                       QString::number(VRLevelOfDetail::DefaultErrorPixels) });
+    parser.process(app);
+
+    const int parts = std::max(1, parser.value("parts").toInt());
+    const int triangles = std::max(8, parser.value("triangles").toInt());
+    const int seconds = std::max(1, parser.value("seconds").toInt());
+
+    // the benchmark never uses a headset, whatever the environment says
+    qputenv("VRMV_VR_BACKEND", "mock");
+
+    // a sphere with resolution r in both directions has about 2r(r - 2) triangles
+    const int resolution = std::max(4, static_cast<int>(std::lround(1. + std::sqrt(1. + triangles / 2.))));
+    vtkSmartPointer<vtkSphereSource> sphere = vtkSmartPointer<vtkSphereSource>::New();
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->SetRadius(40.);
+    sphere->Update();
+
+    VRRenderThread thread;
+
+    // parts are laid out on a square grid, all sharing the sphere's geometry like copies of a loaded file
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(parts))));
+    for (int i = 0; i < parts; ++i) {
+        vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        mapper->SetInputData(sphere->GetOutput());
+
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->SetMapper(mapper);
+        actor->SetPosition(100. * (i % columns), 0., 100. * (i / columns));
+        actor->GetProperty()->SetColor((i % 3) / 2., ((i / 3) % 3) / 2., 1.);
+
+        thread.addActor(actor);
+    }
+
+    QTextStream out(stdout);
+    out << "VR benchmark: " << parts << " parts of " << sphere->GetOutput()->GetNumberOfPolys()
+        << " triangles for " << seconds << " s on the " << thread.backendName() << " backend" << Qt::endl;
+
+    VRCommand lodError = VRCommand::make(VRCommand::SetLodError);
+    lodError.values[0] = parser.value("lod-error").toDouble();
+    thread.pushCommand(lodError);
+
+    thread.issueCommand(VRRenderThread::ROTATE_Y, 20.);
+    thread.start();
+    QThread::sleep(seconds);
+    thread.issueCommand(VRRenderThread::END_RENDER, 0.);
+    thread.wait();
+
+    VRRenderThread::FrameStats stats = thread.frameStats();
+    out << "frames:          " << stats.frames << " at " << stats.displayHz << " Hz" << Qt::endl;
+    out << "frame time:      mean " << stats.meanFrameMs() << " ms, max " << stats.maxFrameMs << " ms" << Qt::endl;
+    out << "left eye:        mean " << stats.meanEyeMs(0) << " ms, max " << stats.maxEyeMs[0] << " ms" << Qt::endl;
+    out << "right eye:       mean " << stats.meanEyeMs(1) << " ms, max " << stats.maxEyeMs[1] << " ms" << Qt::endl;
+    out << "GPU:             mean " << stats.meanGpuMs() << " ms" << Qt::endl;
+    out << "missed frames:   " << stats.missedFrames << Qt::endl;
+    out << "governor:        " << thread.governorDecisions().size() << " changes, render scale "
+        << stats.renderScale << ", LOD bias " << stats.lodBias << Qt::endl;
+    out << "detail levels:   " << stats.lodSwitches << " changes" << Qt::endl;
+    out << "scene work:      mean " << stats.meanWorkMs() << " ms, max " << stats.maxWorkMs << " ms, "
+        << stats.deferredFrames << " frames deferred work" << Qt::endl;
+    out << "picking:         " << stats.picks << " picks, mean " << stats.meanPickMs() << " ms, max " << stats.maxPickMs << " ms" << Qt::endl;
+
+    VRRenderThread::CommandLatency latency = thread.commandLatency();
+    out << "command latency: mean " << latency.meanMs << " ms, max " << latency.maxMs << " ms" << Qt::endl;
+
+    return stats.frames > 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+/**     @file VRCommand.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Typed scene change sent from the GUI thread to the VR render thread.
+  */
+
+#ifndef VIEWER_VRCOMMAND_H
+#define VIEWER_VRCOMMAND_H
+
+#include <chrono>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkPolyData.h>
+
+/**
+ * @brief One change to the VR scene
+ * @note Commands are made on the GUI thread and applied by the VR thread at the start of a frame,
+ *       so VTK objects in the VR scene are only ever touched by the VR thread. Each command records
+ *       when it was made, which lets the VR thread measure the GUI to headset latency
+ */
+struct VRCommand {
+    /** Kind of change, decides which fields are used */
+    enum Type {
+        EndRender,      /**< Stop the VR loop */
+        SetRotation,    /**< values[0..2] = rotation speed of the scene around x, y and z in degrees per second */
+        SetColour,      /**< actor, values[0..2] = RGB colour (0->1) */
+        SetVisibility,  /**< actor, values[0] != 0 if visible */
+        AddActor,       /**< actor */
+        RemoveActor,    /**< actor */
+        SwapFilter,     /**< actor, data = polydata the actor's mapper should show */
+        SetLighting,    /**< values[0] = intensity, values[1..3] = position, values[4..6] = focal point */
+        Pause,          /**< Stop drawing but keep the session, window and uploaded geometry */
+        Resume,         /**< Start drawing again after Pause */
+        SetLodError     /**< values[0] = screen-space error threshold of the level of detail in pixels */
+    };
+
+    Type                                    type = EndRender;   /**< Kind of change */
+    vtkSmartPointer<vtkActor>               actor;              /**< VR actor the change applies to */
+    vtkSmartPointer<vtkPolyData>            data;               /**< New geometry for SwapFilter */
+    double                                  values[7] = {};     /**< Numeric arguments, see Type */
+    std::chrono::steady_clock::time_point   issued;             /**< When the command was made */
+
+    /**
+     * @brief Makes a command stamped with the current time
+     * @param type kind of change
+     * @param actor VR actor the change applies to, if any
+     * @return the command, the caller fills in the other fields
+     */
+    static VRCommand make(Type type, vtkActor* actor = nullptr) {
+        VRCommand command;
+        command.type = type;
+        command.actor = actor;
+        command.issued = std::chrono::steady_clock::now();
+        return command;
+    }
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**     @file VRFrameGovernor.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Lowers the VR render resolution and level of detail when frames take
+  *     too long on the GPU, and raises them again when there is headroom.
+  */
+
+#include "VRFrameGovernor.h"
+
+#include <QDebug>
+
+namespace {
+
+/* Quality steps, resolution is dropped a little before coarser models are used */
+struct Step {
+    double renderScale;
+    double lodBias;
+};
+
+const Step steps[] = {
+    { 1.0, 0. },
+    { 0.9, 0. },
+    { 0.9, 1. },
+    { 0.8, 1. },
+    { 0.8, 2. },
+    { 0.7, 2. },
+    { 0.7, 3. },
+    { 0.6, 3. }
+};
+
+const int stepCount = int(sizeof(steps) / sizeof(steps[0]));
+
+const double upperLimit = 0.9;      // fraction of the budget that counts as over
+const double lowerLimit = 0.7;      // fraction of the budget that counts as headroom
+const double smoothing = 0.2;       // weight of the newest frame in the average
+}
+
+VRFrameGovernor::VRFrameGovernor(double budgetMs)
+    : budget(budgetMs) {
+}
+
+void VRFrameGovernor::setBudget(double budgetMs) {
+    budget = budgetMs;
+}
+
+bool VRFrameGovernor::update(double gpuMs) {
+    if (gpuMs <= 0.)
+        return false;
+
+    frame++;
+    smoothedGpuMs = smoothedGpuMs > 0. ? smoothedGpuMs + smoothing * (gpuMs - smoothedGpuMs) : gpuMs;
+
+    if (cooldown > 0) {
+        cooldown--;
+        return false;
+    }
+
+    overCount = smoothedGpuMs > upperLimit * budget ? overCount + 1 : 0;
+    underCount = smoothedGpuMs < lowerLimit * budget ? underCount + 1 : 0;
+
+    if (overCount >= OverFrames && step + 1 < stepCount) {
+        setStep(step + 1, "over budget");
+        return true;
+    }
+    if (underCount >= UnderFrames && step > 0) {
+        setStep(step - 1, "headroom");
+        return true;
+    }
+    return false;
+}
+
+double VRFrameGovernor::renderScale() const {
+    return steps[step].renderScale;
+}
+
+double VRFrameGovernor::lodBias() const {
+    return steps[step].lodBias;
+}
+
+const QList<VRFrameGovernor::Decision>& VRFrameGovernor::decisions() const {
+    return history;
+}
+
+void VRFrameGovernor::setStep(int newStep, const QString& reason) {
+    step = newStep;
+    overCount = 0;
+    underCount = 0;
+    cooldown = CooldownFrames;
+
+    Decision decision;
+    decision.frame = frame;
+    decision.gpuMs = smoothedGpuMs;
+    decision.budgetMs = budget;
+    decision.renderScale = renderScale();
+    decision.lodBias = lodBias();
+    decision.reason = reason;
+
+    if (history.size() >= MaxDecisions)
+        history.removeFirst();
+    history.append(decision);
+
+    qDebug() << "VR governor, frame" << frame << reason << "(GPU" << smoothedGpuMs << "ms of" << budget
+             << "ms): render scale" << decision.renderScale << "LOD bias" << decision.lodBias;
+}
@@ -0,0 +1,93 @@
+/**     @file VRFrameGovernor.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Lowers the VR render resolution and level of detail when frames take
+  *     too long on the GPU, and raises them again when there is headroom.
+  */
+
+#ifndef VIEWER_VRFRAMEGOVERNOR_H
+#define VIEWER_VRFRAMEGOVERNOR_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * @brief Picks a render scale and LOD bias from the GPU time of recent frames
+ * @note The GPU time is smoothed, the quality is lowered one step once it has been over 90% of the
+ *       frame budget for OverFrames frames, and raised one step once it has been under 70% for
+ *       UnderFrames frames (about a second). After a change nothing else changes for CooldownFrames
+ *       frames so the new setting can be measured. The gap between the two limits and the longer wait
+ *       before raising keep it from flipping between two steps. Every change is recorded
+ */
+class VRFrameGovernor {
+public:
+    static const int OverFrames = 5;        /**< Frames over budget before quality is lowered */
+    static const int UnderFrames = 90;      /**< Frames with headroom before quality is raised */
+    static const int CooldownFrames = 30;   /**< Frames after a change before the next one */
+    static const int MaxDecisions = 1000;   /**< Oldest decisions are dropped after this many */
+
+    /** One change made by the governor */
+    struct Decision {
+        qint64  frame = 0;          /**< Frame the change was made on */
+        double  gpuMs = 0.;         /**< Smoothed GPU time that caused it */
+        double  budgetMs = 0.;      /**< Frame budget at the time */
+        double  renderScale = 1.;   /**< New render scale */
+        double  lodBias = 0.;       /**< New LOD bias */
+        QString reason;             /**< Why the change was made */
+    };
+
+    /**
+     * @brief Constructs the governor at full quality
+     * @param budgetMs time available for one frame
+     */
+    explicit VRFrameGovernor(double budgetMs = 11.);
+
+    /**
+     * @brief Sets the time available for one frame, e.g. from the headset's refresh rate
+     * @param budgetMs time available for one frame
+     */
+    void setBudget(double budgetMs);
+
+    /**
+     * @brief Adds the GPU time of one frame
+     * @param gpuMs GPU time of the frame, ignored if not positive (no timing available)
+     * @return true if the render scale or LOD bias changed
+     */
+    bool update(double gpuMs);
+
+    /**
+     * @brief Gets the fraction of the recommended render target size to draw at
+     * @return scale between 0.6 and 1
+     */
+    double renderScale() const;
+
+    /**
+     * @brief Gets how much coarser the level of detail should be than the distance alone suggests
+     * @return 0 at full quality, larger values pick coarser detail levels sooner
+     */
+    double lodBias() const;
+
+    /**
+     * @brief Gets the changes made so far
+     * @return the decisions, oldest first
+     */
+    const QList<Decision>& decisions() const;
+
+private:
+    /**
+     * @brief Moves to another quality step and records why
+     */
+    void setStep(int newStep, const QString& reason);
+
+    double          budget;             /**< Time available for one frame in ms */
+    double          smoothedGpuMs = 0.; /**< Exponential average of the GPU time */
+    qint64          frame = 0;          /**< Frames seen */
+    int             step = 0;           /**< Current quality step, 0 is full quality */
+    int             overCount = 0;      /**< Frames in a row over the upper limit */
+    int             underCount = 0;     /**< Frames in a row under the lower limit */
+    int             cooldown = 0;       /**< Frames left before another change is allowed */
+    QList<Decision> history;            /**< Changes made, see decisions() */
+};
+
+#endif
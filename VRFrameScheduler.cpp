@@ -0,0 +1,56 @@
+/**     @file VRFrameScheduler.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Runs queued scene work in the VR loop, only for as long as the frame
+  *     has time to spare, and reports how much ran each frame.
+  */
+
+#include "VRFrameScheduler.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+double VRFrameScheduler::budgetFor(double frameMs, double drawMs) {
+    return std::clamp(frameMs - drawMs - MarginMs, MinBudgetMs, MaxBudgetMs);
+}
+
+void VRFrameScheduler::post(const char* name, Task task) {
+    Item item;
+    item.name = name;
+    item.task = std::move(task);
+    tasks.append(std::move(item));
+}
+
+VRFrameScheduler::FrameReport VRFrameScheduler::run(double budgetMs) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point deadline =
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(budgetMs));
+
+    FrameReport report;
+    report.frame = frame++;
+    report.budgetMs = budgetMs;
+
+    // each task waiting at the start gets at most one turn, unfinished ones go to the back
+    for (int turns = static_cast<int>(tasks.size()); turns > 0 && std::chrono::steady_clock::now() < deadline; --turns) {
+        Item item = tasks.takeFirst();
+        report.ran++;
+
+        const std::chrono::steady_clock::time_point taskStart = std::chrono::steady_clock::now();
+        const bool done = item.task(deadline);
+        const double taskMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - taskStart).count();
+        if (taskMs > 2. * budgetMs)
+            qDebug() << "VR task" << item.name << "took" << taskMs << "ms, the frame had" << budgetMs << "ms to spare";
+
+        if (done)
+            report.finished++;
+        else
+            tasks.append(std::move(item));
+    }
+
+    report.usedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    report.waiting = static_cast<int>(tasks.size());
+
+    return report;
+}
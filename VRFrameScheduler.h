@@ -0,0 +1,88 @@
+/**     @file VRFrameScheduler.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Runs queued scene work in the VR loop, only for as long as the frame
+  *     has time to spare, and reports how much ran each frame.
+  */
+
+#ifndef VIEWER_VRFRAMESCHEDULER_H
+#define VIEWER_VRFRAMESCHEDULER_H
+
+#include <QList>
+
+#include <chrono>
+#include <functional>
+
+/**
+ * @brief Time-sliced queue of work for the VR thread
+ * @note Each frame run() is given a budget, the time the frame can spare after drawing (see budgetFor()).
+ *       Tasks are run in the order they were posted until the budget is used up, the rest wait for
+ *       the next frame in the same order. A task is given the deadline and returns false if it has more
+ *       to do, it is then moved behind the others so one long task (e.g. streaming a large part in
+ *       pieces) cannot hold up the short ones. A task that has started is never interrupted, so a slow
+ *       one can overrun, which shows in the report. Only used by the VR thread
+ */
+class VRFrameScheduler {
+public:
+    static constexpr double MarginMs = 2.;      /**< Time left free in every frame for the runtime and jitter */
+    static constexpr double MinBudgetMs = 0.5;  /**< Time given to work even when the frame is full, so it always finishes */
+    static constexpr double MaxBudgetMs = 4.;   /**< Most time given to work in one frame */
+
+    /**
+     * @brief Work for the VR thread
+     * @param deadline the task should return once this has passed
+     * @return true when the task is finished, false to run it again in a later frame
+     */
+    using Task = std::function<bool(std::chrono::steady_clock::time_point deadline)>;
+
+    /** What ran in one frame */
+    struct FrameReport {
+        qint64  frame = 0;      /**< Number of the frame */
+        double  budgetMs = 0.;  /**< Time the frame could spare */
+        double  usedMs = 0.;    /**< Time the tasks took, more than the budget if one overran */
+        int     ran = 0;        /**< Tasks run (or continued) */
+        int     finished = 0;   /**< Tasks that finished */
+        int     waiting = 0;    /**< Tasks left for later frames */
+    };
+
+    /**
+     * @brief Works out how long this frame can spend on tasks
+     * @param frameMs length of a frame
+     * @param drawMs time the last frame took to draw
+     * @return the budget, between MinBudgetMs and MaxBudgetMs
+     */
+    static double budgetFor(double frameMs, double drawMs);
+
+    /**
+     * @brief Adds a task behind the ones already waiting
+     * @param name what the task does, for the log
+     * @param task the work
+     */
+    void post(const char* name, Task task);
+
+    /**
+     * @brief Runs tasks until the budget is used up, call once per frame
+     * @param budgetMs time available
+     * @return what ran
+     */
+    FrameReport run(double budgetMs);
+
+    /**
+     * @brief Gets the number of tasks waiting
+     * @return tasks not finished yet
+     */
+    int pending() const { return static_cast<int>(tasks.size()); }
+
+private:
+    /** A task and what it is for */
+    struct Item {
+        const char* name = "";
+        Task        task;
+    };
+
+    QList<Item>     tasks;      /**< Tasks waiting, next to run first */
+    qint64          frame = 0;  /**< Frames run so far */
+};
+
+#endif
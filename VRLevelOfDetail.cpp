@@ -0,0 +1,162 @@
+/**     @file VRLevelOfDetail.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Picks a detail level for each part in the VR scene from how far it is
+  *     from the headset, using decimated copies made in the background.
+  */
+
+#include "VRLevelOfDetail.h"
+#include "MeshMetrics.h"
+
+#include <QDebug>
+
+#include <vtkCamera.h>
+#include <vtkCellArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkTriangleFilter.h>
+
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------- Level builder ----------------------------------
+
+QList<VRLodLevel> VRLodBuilder::build(vtkPolyData* data) {
+    QList<VRLodLevel> levels;
+    if (!data || data->GetNumberOfPolys() < 4 * MinCells)
+        return levels;
+
+    // quadric decimation only reads triangles
+    vtkSmartPointer<vtkPolyData> current = data;
+    if (data->GetNumberOfStrips() > 0 || data->GetPolys()->IsHomogeneous() != 3) {
+        auto triangleFilter = vtkSmartPointer<vtkTriangleFilter>::New();
+        triangleFilter->SetInputData(data);
+        triangleFilter->Update();
+        current = triangleFilter->GetOutput();
+    }
+
+    // each level is made from the one before, which is much quicker than starting from the full mesh
+    for (int k = 0; k < MaxLevels && current->GetNumberOfPolys() / 4 >= MinCells; ++k) {
+        auto decimate = vtkSmartPointer<vtkQuadricDecimation>::New();
+        decimate->SetInputData(current);
+        decimate->SetTargetReduction(0.75);
+        decimate->VolumePreservationOn();
+        decimate->Update();
+
+        vtkSmartPointer<vtkPolyData> output = decimate->GetOutput();
+        if (output->GetNumberOfPolys() == 0 || output->GetNumberOfPolys() >= current->GetNumberOfPolys())
+            break;
+
+        // an equilateral triangle with the mean area has this edge length
+        MeshMetrics metrics = MeshMetrics::compute(output);
+        if (metrics.valid && metrics.triangles > 0 && output->GetNumberOfPolys() <= VRUploadQueue::PieceCells) {
+            VRLodLevel level;
+            level.data = output;
+            level.error = std::sqrt(4. * metrics.area / (std::sqrt(3.) * metrics.triangles));
+            levels.append(level);
+        }
+        current = output;
+    }
+    return levels;
+}
+
+// ----------------------------- Level selection ----------------------------------
+
+void VRLevelOfDetail::add(vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share) {
+    // the upload queue drops an actor's levels when its geometry changes, so start again from the full geometry
+    Part& part = parts[actor];
+    part.generation = nextGeneration++;
+    part.errors = { 0. };
+    withLevels.removeAll(actor);
+
+    if (data && data->GetNumberOfPolys() >= 4 * VRLodBuilder::MinCells)
+        builder.submit(actor, part.generation, data, std::move(share));
+    else
+        builder.cancel(actor);
+}
+
+void VRLevelOfDetail::remove(vtkActor* actor) {
+    parts.remove(actor);
+    withLevels.removeAll(actor);
+    builder.cancel(actor);
+}
+
+void VRLevelOfDetail::setErrorPixels(double pixels) {
+    thresholdPixels = std::max(0.1, pixels);
+    qDebug() << "VR level of detail error threshold set to" << thresholdPixels << "pixels";
+}
+
+int VRLevelOfDetail::update(vtkRenderer* renderer, vtkMatrix4x4* scene, VRUploadQueue& uploads, double bias) {
+    for (const Builder::Result& result : builder.takeResults()) {
+        auto it = parts.find(result.actor.GetPointer());
+        if (it == parts.end() || it->generation != result.generation || result.output.isEmpty())
+            continue;
+
+        QList<vtkSmartPointer<vtkPolyData>> levels;
+        QList<double> errors = { 0. };
+        for (const VRLodLevel& level : result.output) {
+            levels.append(level.data);
+            errors.append(level.error);
+        }
+        if (!uploads.setLevels(renderer, result.actor, levels))
+            continue;   // left the scene while its levels were being made
+        it->errors = errors;
+        if (!withLevels.contains(result.actor.GetPointer()))
+            withLevels.append(result.actor.GetPointer());
+    }
+
+    if (withLevels.isEmpty() || !renderer || renderer->GetSize()[1] <= 0)
+        return 0;
+
+    // pixels covered by one model unit at a distance of one, from the vertical field of view of the
+    // projection (the headset's own projection for the OpenVR camera)
+    vtkCamera* camera = renderer->GetActiveCamera();
+    double eye[3];
+    camera->GetPosition(eye);
+    vtkMatrix4x4* projection = camera->GetProjectionTransformMatrix(renderer->GetTiledAspectRatio(), -1., 1.);
+    const double pixelsPerUnit = 0.5 * renderer->GetSize()[1] * projection->GetElement(1, 1);
+    const double limit = thresholdPixels * std::pow(2., bias);
+
+    int switches = 0;
+    const int count = std::min(PartsPerFrame, static_cast<int>(withLevels.size()));
+    for (int i = 0; i < count && switches < SwitchesPerFrame; ++i) {
+        if (cursor >= withLevels.size())
+            cursor = 0;
+        vtkActor* actor = withLevels[cursor++];
+        const QList<double>& errors = parts[actor].errors;
+        const int coarsest = static_cast<int>(errors.size()) - 1;
+
+        // bounding sphere in world space, the actor's bounds include its own matrix but not the scene's
+        const double* bounds = actor->GetBounds();
+        if (!bounds)
+            continue;
+        double centre[4] = { 0.5 * (bounds[0] + bounds[1]), 0.5 * (bounds[2] + bounds[3]), 0.5 * (bounds[4] + bounds[5]), 1. };
+        scene->MultiplyPoint(centre, centre);
+        const double radius = 0.5 * std::sqrt((bounds[1] - bounds[0]) * (bounds[1] - bounds[0])
+                                            + (bounds[3] - bounds[2]) * (bounds[3] - bounds[2])
+                                            + (bounds[5] - bounds[4]) * (bounds[5] - bounds[4]));
+        const double centreDistance = std::sqrt((centre[0] - eye[0]) * (centre[0] - eye[0])
+                                              + (centre[1] - eye[1]) * (centre[1] - eye[1])
+                                              + (centre[2] - eye[2]) * (centre[2] - eye[2]));
+        const double distance = centreDistance - radius;
+
+        const int current = uploads.level(actor);
+        int wanted = current;
+        if (distance <= 0.) {
+            wanted = 0;     // the headset is inside the part
+        } else if (radius * pixelsPerUnit / centreDistance < TinyPixels) {
+            wanted = coarsest;
+        } else {
+            // finer until the error is small enough, then coarser while there is room under the threshold
+            while (wanted > 0 && errors[wanted] * pixelsPerUnit / distance > limit)
+                wanted--;
+            while (wanted < coarsest && errors[wanted + 1] * pixelsPerUnit / distance <= limit * Hysteresis)
+                wanted++;
+        }
+
+        if (wanted != current && uploads.setLevel(renderer, actor, wanted))
+            switches++;
+    }
+    return switches;
+}
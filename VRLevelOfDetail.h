@@ -0,0 +1,126 @@
+/**     @file VRLevelOfDetail.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Picks a detail level for each part in the VR scene from how far it is
+  *     from the headset, using decimated copies made in the background.
+  */
+
+#ifndef VIEWER_VRLEVELOFDETAIL_H
+#define VIEWER_VRLEVELOFDETAIL_H
+
+#include "VRUploadQueue.h"
+#include "VRBackgroundBuilder.h"
+
+#include <QHash>
+#include <QList>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+
+#include <memory>
+
+/** One decimated copy of a part */
+struct VRLodLevel {
+    vtkSmartPointer<vtkPolyData>    data;           /**< Decimated geometry */
+    double                          error = 0.;     /**< Size of the smallest detail it still shows, in model units */
+};
+
+/**
+ * @brief Makes the decimated levels of parts for VRLevelOfDetail, run on its background builder
+ * @note Each level has a quarter of the triangles of the one before and is made from it with quadric
+ *       decimation, until a level would have fewer than MinCells triangles. The error of a level is
+ *       the typical edge length of its triangles (from the mean triangle area). Levels with more than
+ *       VRUploadQueue::PieceCells triangles are not kept, their first draw would stall the frame the
+ *       same way adding a large part does
+ */
+class VRLodBuilder {
+public:
+    static const int MaxLevels = 4;             /**< Most decimated levels made for one part */
+    static const vtkIdType MinCells = 500;      /**< No level is made with fewer triangles than this */
+
+    /**
+     * @brief Makes the decimated levels of a mesh
+     * @param data the full geometry
+     * @return the levels, finest first, empty if the mesh is too small to need any
+     */
+    static QList<VRLodLevel> build(vtkPolyData* data);
+};
+
+/**
+ * @brief Shows each part in the VR scene at the coarsest level whose error is too small to see
+ * @note A level's error is projected to the screen from the distance between the headset and the
+ *       nearest point of the part's bounding sphere. The coarsest level under the pixel threshold is
+ *       picked, scaled by 2^bias so the frame governor can trade detail for time. A part moves to a
+ *       coarser level only once it is under Hysteresis times the threshold, so parts at the edge of a
+ *       threshold do not flicker between levels. Parts smaller than TinyPixels on screen get the
+ *       coarsest level. Levels are separate actors with their own mappers, made once, so a switch is
+ *       a swap in the scene and never a pipeline update. Only used by the VR thread
+ */
+class VRLevelOfDetail {
+public:
+    static constexpr double DefaultErrorPixels = 1.;    /**< Default screen-space error threshold */
+    static constexpr double Hysteresis = 0.8;           /**< Fraction of the threshold needed to move to a coarser level */
+    static constexpr double TinyPixels = 3.;            /**< Parts with a smaller radius on screen get the coarsest level */
+    static const int PartsPerFrame = 256;               /**< Most parts checked in one frame, the rest wait for later frames */
+    static const int SwitchesPerFrame = 16;             /**< Most level changes in one frame, each may upload a level */
+
+    /**
+     * @brief Starts tracking a part, its levels are made in the background
+     * @note calling this again for the same actor (a new filter result) drops its old levels
+     * @param actor actor of the part, already added to the upload queue
+     * @param data full geometry of the part
+     * @param share share of the filter cache entry holding data, see VRBackgroundBuilder::submit()
+     */
+    void add(vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share = std::shared_ptr<int>());
+
+    /**
+     * @brief Stops tracking a part
+     * @param actor actor of the part
+     */
+    void remove(vtkActor* actor);
+
+    /**
+     * @brief Sets the screen-space error threshold
+     * @param pixels largest error allowed on screen, in pixels
+     */
+    void setErrorPixels(double pixels);
+
+    /**
+     * @brief Gets the screen-space error threshold
+     * @return the threshold in pixels
+     */
+    double errorPixels() const { return thresholdPixels; }
+
+    /**
+     * @brief Installs finished levels and picks the level of the next parts, call once per frame
+     * @param renderer renderer drawing the scene, gives the camera and viewport
+     * @param scene model transform of the whole VR scene, see vtkCamera::SetModelTransformMatrix()
+     * @param uploads upload queue showing the parts
+     * @param bias LOD bias from the frame governor
+     * @return number of parts that changed level
+     */
+    int update(vtkRenderer* renderer, vtkMatrix4x4* scene, VRUploadQueue& uploads, double bias);
+
+private:
+    /** Background thread making the levels */
+    typedef VRBackgroundBuilder<QList<VRLodLevel>> Builder;
+
+    /** What is known about one part */
+    struct Part {
+        int             generation = -1;    /**< Generation of the newest level request */
+        QList<double>   errors;             /**< Error of each level, index 0 is the full geometry */
+    };
+
+    Builder                     builder { &VRLodBuilder::build };   /**< Makes the levels */
+    QHash<vtkActor*, Part>      parts;              /**< Every tracked part */
+    QList<vtkActor*>            withLevels;         /**< Parts that have levels, checked in turn */
+    int                         cursor = 0;         /**< Next part in withLevels to check */
+    int                         nextGeneration = 0; /**< Generation of the next request */
+    double                      thresholdPixels = DefaultErrorPixels;
+};
+
+#endif
@@ -0,0 +1,284 @@
+/**     @file VRPicker.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Finds the part a VR controller points at, using bounding volume
+  *     hierarchies over the parts and over each part's triangles.
+  */
+
+#include "VRPicker.h"
+
+#include <vtkCellArray.h>
+#include <vtkIdList.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+/* Largest float not above a double, box minimums are rounded down so a box never misses what it holds */
+float floatBelow(double value) {
+    const float rounded = static_cast<float>(value);
+    return rounded > value ? std::nextafter(rounded, -std::numeric_limits<float>::infinity()) : rounded;
+}
+
+/* Smallest float not below a double, for box maximums */
+float floatAbove(double value) {
+    const float rounded = static_cast<float>(value);
+    return rounded < value ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+}
+}
+
+// ----------------------------- Hierarchy ----------------------------------
+
+bool VRBvh::hitBox(const Box& box, const double origin[3], const double inverse[3], double tMax, double& tEnter) {
+    double tNear = 0., tFar = tMax;
+    for (int k = 0; k < 3; ++k) {
+        double t0 = (box.min[k] - origin[k]) * inverse[k];
+        double t1 = (box.max[k] - origin[k]) * inverse[k];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tNear = std::max(tNear, t0);
+        tFar = std::min(tFar, t1);
+        if (tNear > tFar)
+            return false;
+    }
+    tEnter = tNear;
+    return true;
+}
+
+void VRBvh::build(const std::vector<Box>& boxes) {
+    nodes.clear();
+    items.resize(boxes.size());
+    std::iota(items.begin(), items.end(), 0);
+    if (boxes.empty())
+        return;
+
+    std::vector<float> centres(3 * boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i)
+        for (int k = 0; k < 3; ++k)
+            centres[3 * i + k] = 0.5f * (boxes[i].min[k] + boxes[i].max[k]);
+
+    // nodes still to split, as (node, first item, item count)
+    struct Range { int node, first, count; };
+    std::vector<Range> pending;
+    nodes.reserve(2 * boxes.size() / LeafSize + 1);
+    nodes.emplace_back();
+    pending.push_back({ 0, 0, static_cast<int>(boxes.size()) });
+
+    while (!pending.empty()) {
+        const Range range = pending.back();
+        pending.pop_back();
+
+        Box box = boxes[items[range.first]];
+        float low[3], high[3];
+        for (int k = 0; k < 3; ++k)
+            low[k] = high[k] = centres[3 * items[range.first] + k];
+        for (int i = range.first + 1; i < range.first + range.count; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                box.min[k] = std::min(box.min[k], boxes[items[i]].min[k]);
+                box.max[k] = std::max(box.max[k], boxes[items[i]].max[k]);
+                low[k] = std::min(low[k], centres[3 * items[i] + k]);
+                high[k] = std::max(high[k], centres[3 * items[i] + k]);
+            }
+        }
+        nodes[range.node].box = box;
+
+        const int axis = (high[0] - low[0] >= high[1] - low[1] && high[0] - low[0] >= high[2] - low[2]) ? 0
+                       : (high[1] - low[1] >= high[2] - low[2] ? 1 : 2);
+        if (range.count <= LeafSize || high[axis] <= low[axis]) {
+            nodes[range.node].first = range.first;
+            nodes[range.node].count = range.count;
+            continue;
+        }
+
+        // split at the median box centre along the longest axis
+        const int middle = range.first + range.count / 2;
+        std::nth_element(items.begin() + range.first, items.begin() + middle, items.begin() + range.first + range.count,
+                         [&centres, axis](int a, int b) { return centres[3 * a + axis] < centres[3 * b + axis]; });
+
+        const int child = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[range.node].first = child;
+        nodes[range.node].count = 0;
+        pending.push_back({ child, range.first, middle - range.first });
+        pending.push_back({ child + 1, middle, range.first + range.count - middle });
+    }
+}
+
+// ----------------------------- Picking ----------------------------------
+
+VRPicker::VRPicker() : builder(&VRPicker::buildMesh) {}
+
+VRPicker::~VRPicker() = default;
+
+void VRPicker::add(vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share) {
+    Part& part = parts[actor];
+    part.generation = nextGeneration++;
+    part.mesh = nullptr;        // the old triangles are wrong now, the box is used until the new ones are ready
+    partsDirty = true;
+
+    if (data && data->GetNumberOfPolys() > 0)
+        builder.submit(actor, part.generation, data, std::move(share));
+    else
+        builder.cancel(actor);
+}
+
+void VRPicker::remove(vtkActor* actor) {
+    parts.remove(actor);
+    builder.cancel(actor);
+    partsDirty = true;
+}
+
+std::shared_ptr<VRPicker::Mesh> VRPicker::buildMesh(vtkPolyData* data) {
+    auto mesh = std::make_shared<Mesh>();
+    mesh->data = data;
+    mesh->triangles.reserve(3 * data->GetNumberOfPolys());
+
+    // polygons with more than three points are split into fans, like the renderer does
+    vtkNew<vtkIdList> ids;
+    vtkCellArray* polys = data->GetPolys();
+    for (vtkIdType cell = 0; cell < polys->GetNumberOfCells(); ++cell) {
+        polys->GetCellAtId(cell, ids);
+        for (vtkIdType k = 2; k < ids->GetNumberOfIds(); ++k) {
+            mesh->triangles.push_back(ids->GetId(0));
+            mesh->triangles.push_back(ids->GetId(k - 1));
+            mesh->triangles.push_back(ids->GetId(k));
+        }
+    }
+
+    const size_t count = mesh->triangles.size() / 3;
+    std::vector<VRBvh::Box> boxes(count);
+    double p[3];
+    for (size_t i = 0; i < count; ++i) {
+        VRBvh::Box& box = boxes[i];
+        for (int v = 0; v < 3; ++v) {
+            data->GetPoint(mesh->triangles[3 * i + v], p);
+            for (int k = 0; k < 3; ++k) {
+                box.min[k] = v == 0 ? floatBelow(p[k]) : std::min(box.min[k], floatBelow(p[k]));
+                box.max[k] = v == 0 ? floatAbove(p[k]) : std::max(box.max[k], floatAbove(p[k]));
+            }
+        }
+    }
+    mesh->bvh.build(boxes);
+    return mesh;
+}
+
+void VRPicker::rebuildParts() {
+    partOrder.clear();
+    partBoxes.clear();
+
+    // the actors' bounds include their own matrix but not the scene's, which is what the boxes are in
+    for (auto it = parts.constBegin(); it != parts.constEnd(); ++it) {
+        const double* bounds = it.key()->GetBounds();
+        if (!bounds || !vtkMath::AreBoundsInitialized(bounds))
+            continue;
+
+        VRBvh::Box box;
+        for (int k = 0; k < 3; ++k) {
+            box.min[k] = floatBelow(bounds[2 * k]);
+            box.max[k] = floatAbove(bounds[2 * k + 1]);
+        }
+        partOrder.push_back(it.key());
+        partBoxes.push_back(box);
+    }
+    partBvh.build(partBoxes);
+    partsDirty = false;
+}
+
+VRPicker::Hit VRPicker::pick(vtkMatrix4x4* scene, const double origin[3], const double direction[3]) {
+    for (const Builder::Result& result : builder.takeResults()) {
+        auto it = parts.find(result.actor.GetPointer());
+        if (it != parts.end() && it->generation == result.generation)
+            it->mesh = result.output;
+    }
+    if (partsDirty)
+        rebuildParts();
+
+    Hit hit;
+    if (partBvh.empty())
+        return hit;
+
+    // the ray in the scene's model coordinates, where the part boxes are
+    vtkNew<vtkMatrix4x4> toScene;
+    vtkMatrix4x4::Invert(scene, toScene);
+    double sceneOrigin[4] = { origin[0], origin[1], origin[2], 1. };
+    double sceneDirection[4] = { direction[0], direction[1], direction[2], 0. };
+    toScene->MultiplyPoint(sceneOrigin, sceneOrigin);
+    toScene->MultiplyPoint(sceneDirection, sceneDirection);
+    double inverse[3];
+    for (int k = 0; k < 3; ++k)
+        inverse[k] = sceneDirection[k] != 0. ? 1. / sceneDirection[k] : std::numeric_limits<double>::infinity();
+
+    vtkNew<vtkMatrix4x4> toModel;
+    double nearest = std::numeric_limits<double>::infinity();
+
+    partBvh.traverse(sceneOrigin, sceneDirection, nearest, [&](int item, double tMax) {
+        vtkActor* actor = partOrder[item];
+        double tBox;
+        if (!actor->GetVisibility() || !VRBvh::hitBox(partBoxes[item], sceneOrigin, inverse, tMax, tBox))
+            return tMax;
+
+        const std::shared_ptr<Mesh> mesh = parts.value(actor).mesh;
+        if (!mesh) {
+            hit.actor = actor;
+            hit.exact = false;
+            nearest = tBox;
+            return tBox;
+        }
+
+        // the ray in the part's model coordinates, where its triangles are
+        vtkMatrix4x4::Invert(actor->GetMatrix(), toModel);
+        double modelOrigin[4] = { sceneOrigin[0], sceneOrigin[1], sceneOrigin[2], 1. };
+        double modelDirection[4] = { sceneDirection[0], sceneDirection[1], sceneDirection[2], 0. };
+        toModel->MultiplyPoint(modelOrigin, modelOrigin);
+        toModel->MultiplyPoint(modelDirection, modelDirection);
+
+        mesh->bvh.traverse(modelOrigin, modelDirection, tMax, [&](int triangle, double tTriangle) {
+            // Moller-Trumbore ray/triangle intersection
+            double a[3], b[3], c[3];
+            mesh->data->GetPoint(mesh->triangles[3 * triangle], a);
+            mesh->data->GetPoint(mesh->triangles[3 * triangle + 1], b);
+            mesh->data->GetPoint(mesh->triangles[3 * triangle + 2], c);
+
+            double edge1[3], edge2[3], p[3], q[3], s[3];
+            vtkMath::Subtract(b, a, edge1);
+            vtkMath::Subtract(c, a, edge2);
+            vtkMath::Cross(modelDirection, edge2, p);
+            const double determinant = vtkMath::Dot(edge1, p);
+            if (std::abs(determinant) < 1e-12)
+                return tTriangle;
+
+            vtkMath::Subtract(modelOrigin, a, s);
+            const double u = vtkMath::Dot(s, p) / determinant;
+            if (u < 0. || u > 1.)
+                return tTriangle;
+            vtkMath::Cross(s, edge1, q);
+            const double v = vtkMath::Dot(modelDirection, q) / determinant;
+            if (v < 0. || u + v > 1.)
+                return tTriangle;
+
+            const double t = vtkMath::Dot(edge2, q) / determinant;
+            if (t <= 0. || t >= tTriangle)
+                return tTriangle;
+
+            hit.actor = actor;
+            hit.exact = true;
+            nearest = t;
+            return t;
+        });
+        return std::min(tMax, nearest);
+    });
+
+    if (hit.actor) {
+        for (int k = 0; k < 3; ++k)
+            hit.point[k] = origin[k] + nearest * direction[k];
+    }
+    return hit;
+}
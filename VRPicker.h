@@ -0,0 +1,228 @@
+/**     @file VRPicker.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Finds the part a VR controller points at, using bounding volume
+  *     hierarchies over the parts and over each part's triangles.
+  */
+
+#ifndef VIEWER_VRPICKER_H
+#define VIEWER_VRPICKER_H
+
+#include "VRBackgroundBuilder.h"
+
+#include <QHash>
+#include <QList>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkMatrix4x4.h>
+#include <vtkPolyData.h>
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Bounding volume hierarchy over boxes, used for both the parts and their triangles
+ * @note Nodes are split at the median of the longest axis of their box centres until a node holds
+ *       LeafSize boxes or fewer. Nodes are kept in one array, a node's children are next to each other
+ */
+class VRBvh {
+public:
+    static const int LeafSize = 4;  /**< Most boxes in a leaf */
+
+    /** Axis aligned box of one item */
+    struct Box {
+        float   min[3];
+        float   max[3];
+    };
+
+    /**
+     * @brief Builds the hierarchy, replacing any old one
+     * @param boxes box of each item, items are numbered by their place in this list
+     */
+    void build(const std::vector<Box>& boxes);
+
+    /**
+     * @brief Finds the items in the leaves a ray passes through, nearest leaves first
+     * @param origin start of the ray
+     * @param direction direction of the ray, need not be normalised
+     * @param tMax ray parameter beyond which nothing is looked for
+     * @param visit called as visit(item, tMax) for each item of each leaf hit, returns the new tMax
+     *        (e.g. the nearest hit found so far) so further leaves are skipped
+     */
+    template <typename Visit>
+    void traverse(const double origin[3], const double direction[3], double tMax, Visit visit) const;
+
+    /**
+     * @brief Finds where a ray enters a box
+     * @param box the box
+     * @param origin start of the ray
+     * @param inverse 1 / direction of the ray, for each axis
+     * @param tMax ray parameter beyond which the box is not hit
+     * @param tEnter set to the ray parameter where the ray enters the box (0 if it starts inside)
+     * @return false if the ray misses the box or the box is beyond tMax
+     */
+    static bool hitBox(const Box& box, const double origin[3], const double inverse[3], double tMax, double& tEnter);
+
+    /**
+     * @brief Checks if the hierarchy is empty
+     * @return true if there are no items
+     */
+    bool empty() const { return nodes.empty(); }
+
+private:
+    struct Node {
+        Box     box;            /**< Box around everything in the node */
+        int     first = 0;      /**< First item in items for a leaf, first child for an inner node */
+        int     count = 0;      /**< Items in a leaf, 0 for an inner node */
+    };
+
+    std::vector<Node>   nodes;  /**< Root first */
+    std::vector<int>    items;  /**< Items of the leaves, in leaf order */
+};
+
+template <typename Visit>
+void VRBvh::traverse(const double origin[3], const double direction[3], double tMax, Visit visit) const {
+    if (nodes.empty())
+        return;
+
+    double inverse[3];
+    for (int k = 0; k < 3; ++k)
+        inverse[k] = direction[k] != 0. ? 1. / direction[k] : std::numeric_limits<double>::infinity();
+
+    // the nearer child is visited first, the stack holds nodes still to visit with where the ray enters them
+    int stack[64];
+    double enter[64];
+    int size = 0;
+    double t;
+    if (!hitBox(nodes[0].box, origin, inverse, tMax, t))
+        return;
+    stack[size] = 0;
+    enter[size++] = t;
+
+    while (size > 0) {
+        --size;
+        if (enter[size] > tMax)
+            continue;   // a nearer hit was found since the node was put on the stack
+
+        const Node& node = nodes[stack[size]];
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; ++i)
+                tMax = visit(items[node.first + i], tMax);
+            continue;
+        }
+
+        double tLeft, tRight;
+        const bool left = hitBox(nodes[node.first].box, origin, inverse, tMax, tLeft);
+        const bool right = hitBox(nodes[node.first + 1].box, origin, inverse, tMax, tRight);
+        if (left && right) {
+            const bool leftFirst = tLeft <= tRight;
+            stack[size] = leftFirst ? node.first + 1 : node.first;
+            enter[size++] = leftFirst ? tRight : tLeft;
+            stack[size] = leftFirst ? node.first : node.first + 1;
+            enter[size++] = leftFirst ? tLeft : tRight;
+        } else if (left || right) {
+            stack[size] = left ? node.first : node.first + 1;
+            enter[size++] = left ? tLeft : tRight;
+        }
+    }
+}
+
+/**
+ * @brief Picks the part a ray hits first, for selecting parts with a VR controller
+ * @note There are two levels. The parts' bounding boxes (in the scene's model coordinates, so turning
+ *       the scene does not change them) are in one hierarchy, rebuilt on the next pick after a part is
+ *       added, removed or moved. Each part's triangles are in their own hierarchy in the part's model
+ *       coordinates, built on a background thread when the part is added or given new geometry. The ray
+ *       is moved into each space instead of moving the boxes, and is not normalised, so the ray
+ *       parameter means the same in every space. Until a part's triangles are ready a hit on its box
+ *       counts as a hit. Hidden parts are skipped. Only used by the VR thread
+ */
+class VRPicker {
+public:
+    /** Result of a pick */
+    struct Hit {
+        vtkActor*   actor = nullptr;        /**< Part hit, null if nothing was hit */
+        double      point[3] = { 0., 0., 0. };  /**< Where the ray hit, in world coordinates */
+        bool        exact = false;          /**< False if only the part's box was hit, its triangles are not ready */
+    };
+
+    /**
+     * @brief Constructs the picker, its builder thread is started straight away
+     */
+    VRPicker();
+
+    /**
+     * @brief Stops the builder thread
+     */
+    ~VRPicker();
+
+    /**
+     * @brief Adds a part, or gives it new geometry
+     * @param actor actor of the part
+     * @param data full geometry of the part, only read (through a shallow copy) by the builder
+     * @param share share of the filter cache entry holding data, see VRBackgroundBuilder::submit()
+     */
+    void add(vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share = std::shared_ptr<int>());
+
+    /**
+     * @brief Removes a part
+     * @param actor actor of the part
+     */
+    void remove(vtkActor* actor);
+
+    /**
+     * @brief Notes that a part moved, its box is updated on the next pick
+     */
+    void moved() { partsDirty = true; }
+
+    /**
+     * @brief Finds the first visible part along a ray
+     * @param scene model transform of the whole VR scene, see vtkCamera::SetModelTransformMatrix()
+     * @param origin start of the ray, in world coordinates
+     * @param direction direction of the ray, in world coordinates
+     * @return the hit, actor is null if the ray hit nothing
+     */
+    Hit pick(vtkMatrix4x4* scene, const double origin[3], const double direction[3]);
+
+private:
+    /** Triangles of one part and their hierarchy */
+    struct Mesh {
+        vtkSmartPointer<vtkPolyData>    data;       /**< Geometry the points are read from */
+        std::vector<vtkIdType>          triangles;  /**< Three point ids per triangle, polygons are split into fans */
+        VRBvh                           bvh;        /**< Hierarchy over the triangles */
+    };
+
+    /**
+     * @brief Makes the triangle hierarchy of a mesh
+     * @param data the geometry
+     * @return the mesh
+     */
+    static std::shared_ptr<Mesh> buildMesh(vtkPolyData* data);
+
+    /**
+     * @brief Rebuilds the hierarchy over the parts' boxes
+     */
+    void rebuildParts();
+
+    /** Background thread making the triangle hierarchies */
+    typedef VRBackgroundBuilder<std::shared_ptr<Mesh>> Builder;
+
+    /** What is known about one part */
+    struct Part {
+        int                     generation = -1;    /**< Generation of the newest mesh request */
+        std::shared_ptr<Mesh>   mesh;               /**< Triangle hierarchy, null until built */
+    };
+
+    Builder                     builder;            /**< Makes the meshes */
+    QHash<vtkActor*, Part>      parts;              /**< Every part that can be picked */
+    std::vector<vtkActor*>      partOrder;          /**< Part of each item in partBvh */
+    std::vector<VRBvh::Box>     partBoxes;          /**< Box of each item in partBvh, in the scene's model coordinates */
+    VRBvh                       partBvh;            /**< Hierarchy over the parts' boxes */
+    bool                        partsDirty = true;  /**< True if partBvh is out of date */
+    int                         nextGeneration = 0; /**< Generation of the next mesh request */
+};
+
+#endif
@@ -12,10 +12,7 @@
 
 /* Vtk headers */
 #include <vtkActor.h>
-#include <vtkOpenVRRenderWindow.h>				
-#include <vtkOpenVRRenderWindowInteractor.h>	
-#include <vtkOpenVRRenderer.h>					
-#include <vtkOpenVRCamera.h>	
+#include <vtkCamera.h>
 
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
@@ -24,8 +21,12 @@
 #include <vtkPolyDataMapper.h>
 #include <vtkProperty.h>
 #include <vtkSTLReader.h>
-#include <vtkDataSetmapper.h>
 #include <vtkCallbackCommand.h>
+#include <vtkMatrix4x4.h>
+
+#include <QDebug>
+
+#include <algorithm>
 
 
 /* The class constructor is called by MainWindow and runs in the primary program thread, this thread
@@ -41,6 +42,20 @@ VRRenderThread::VRRenderThread( QObject* parent ) {
 	rotateX = 0.;
 	rotateY = 0.;
 	rotateZ = 0.;
+
+	/* Turn of the whole VR scene, the animation rotates it rather than every actor */
+	sceneTransform = vtkSmartPointer<vtkTransform>::New();
+
+	/* Scene light, made here so lighting commands issued before VR starts are kept */
+	sceneLight = vtkSmartPointer<vtkLight>::New();
+	sceneLight->SetLightTypeToSceneLight();
+	sceneLight->SetIntensity(1.0);
+
+	/* OpenVR, or the headless mock if VRMV_VR_BACKEND=mock, see VRBackend */
+	backend = VRBackend::create();
+
+	/* Picked parts are sent to the GUI thread as actor pointers */
+	qRegisterMetaType<vtkActor*>();
 }
 
 
@@ -50,14 +65,9 @@ VRRenderThread::VRRenderThread( QObject* parent ) {
  * usage will increase for each start/stop thread cycle.
  */
 VRRenderThread::~VRRenderThread() {
-	// window and renderer are vtk objects, so they need to be deleted
-	if (window) {
-		window->Finalize();             // clean up the OpenVR render window
-	  }
-	  if (renderer){
-		renderer->Delete();
-		renderer = nullptr;
-	  }
+	// the backend's vtk objects are smart pointers, the window just needs closing
+	backend->finalise();
+	renderer = nullptr;
 }
 
 
@@ -65,43 +75,305 @@ void VRRenderThread::addActorOffline( vtkActor* actor ) {
 
 	/* Check to see if render thread is running */
 	if (!this->isRunning()) {
-		double* ac = actor->GetOrigin();
-	
-		/* I have found that these initial transforms will position the FS
-		 * car model in a sensible position but you can experiment
-		 */
-		actor->RotateX(-90);
-		actor->AddPosition(-ac[0]+0, -ac[1]-100, -ac[2]-200);
-
-		actors->AddItem(actor);
+		addActor(actor);
 	}
 }
 
 
+void VRRenderThread::addActor( vtkActor* actor ) {
+
+	/* The actor is not in the VR scene yet, so it is still safe to move it from this thread */
+	double* ac = actor->GetOrigin();
+
+	/* I have found that these initial transforms will position the FS
+	 * car model in a sensible position but you can experiment
+	 */
+	actor->RotateX(-90);
+	actor->AddPosition(-ac[0]+0, -ac[1]-100, -ac[2]-200);
+
+	pushCommand(VRCommand::make(VRCommand::AddActor, actor));
+}
+
+
+void VRRenderThread::removeActor( vtkActor* actor ) {
+	sceneBuffer.remove(actor);
+	pushCommand(VRCommand::make(VRCommand::RemoveActor, actor));
+}
+
+
 
 void VRRenderThread::issueCommand( int cmd, double value ) {
 
-	/* Update class variables according to command */
+	/* Convert the old style command to a typed command */
 	switch (cmd) {
-		/* These are just a few basic examples */
 		case END_RENDER:
+			pushCommand(VRCommand::make(VRCommand::EndRender));
+			return;
+
+		case ROTATE_X:
+		case ROTATE_Y:
+		case ROTATE_Z: {
+			/* The rotation command carries all three axes, so remember the other two */
+			requestedRotation[cmd - ROTATE_X] = value;
+			VRCommand command = VRCommand::make(VRCommand::SetRotation);
+			for (int i = 0; i < 3; i++)
+				command.values[i] = requestedRotation[i];
+			pushCommand(std::move(command));
+			return;
+		}
+	}
+}
+
+
+void VRRenderThread::pushCommand( VRCommand command ) {
+
+	/* Nothing else is using the VR objects before the thread starts, so apply the change now */
+	if (!this->isRunning()) {
+		applyCommand(command);
+		return;
+	}
+
+	/* The VR thread empties the queue every frame, so a full queue only waits for one frame */
+	while (!commands.tryPush(std::move(command))) {
+		if (!this->isRunning())
+			return;
+		QThread::yieldCurrentThread();
+	}
+
+	/* A paused thread sleeps until there is something to do */
+	if (paused) {
+		QMutexLocker locker(&mutex);
+		condition.wakeAll();
+	}
+}
+
+
+VRRenderThread::FrameStats VRRenderThread::frameStats() const {
+	QMutexLocker locker(&mutex);
+	return frames;
+}
+
+
+QList<VRFrameScheduler::FrameReport> VRRenderThread::recentWork() const {
+	QMutexLocker locker(&mutex);
+	return workReports;
+}
+
+
+QList<VRFrameGovernor::Decision> VRRenderThread::governorDecisions() const {
+	QMutexLocker locker(&mutex);
+	return governor.decisions();
+}
+
+
+VRRenderThread::CommandLatency VRRenderThread::commandLatency() const {
+	QMutexLocker locker(&mutex);
+
+	CommandLatency latency;
+	latency.count = latencyCount;
+	latency.meanMs = latencyCount > 0 ? latencyTotalMs / latencyCount : 0.;
+	latency.maxMs = latencyMaxMs;
+	return latency;
+}
+
+
+void VRRenderThread::drainCommands() {
+	VRCommand command;
+	qint64 count = 0;
+	double totalMs = 0., maxMs = 0.;
+
+	while (commands.tryPop(command)) {
+		applyCommand(command);
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - command.issued).count();
+		totalMs += ms;
+		maxMs = std::max(maxMs, ms);
+		count++;
+	}
+
+	/* Only take the lock on frames that actually changed something */
+	if (count > 0) {
+		QMutexLocker locker(&mutex);
+		latencyCount += count;
+		latencyTotalMs += totalMs;
+		latencyMaxMs = std::max(latencyMaxMs, maxMs);
+	}
+}
+
+
+void VRRenderThread::applyCommand( const VRCommand& command ) {
+	vtkActor* actor = command.actor;
+
+	switch (command.type) {
+		case VRCommand::EndRender:
 			this->endRender = true;
 			break;
 
-		case ROTATE_X:
-			this->rotateX = value;
+		case VRCommand::SetRotation:
+			rotateX = command.values[0];
+			rotateY = command.values[1];
+			rotateZ = command.values[2];
 			break;
 
-		case ROTATE_Y:
-			this->rotateY = value;
+		case VRCommand::SetColour:
+			if (actor)
+				actor->GetProperty()->SetColor(command.values[0], command.values[1], command.values[2]);
+			break;
+
+		case VRCommand::SetVisibility:
+			if (actor) {
+				actor->SetVisibility(command.values[0] != 0.);
+				uploads.updatePose(actor);
+				picker.moved();
+			}
+			break;
+
+		case VRCommand::AddActor:
+			if (!actor)
+				break;
+			if (renderer && this->isRunning()) {
+				vtkSmartPointer<vtkActor> added = actor;
+				scheduler.post("add part", [this, added](std::chrono::steady_clock::time_point) {
+					uploads.add(renderer, added);
+					if (vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(added->GetMapper())) {
+						lod.add(added, mapper->GetInput());
+						picker.add(added, mapper->GetInput());
+					}
+					scheduleStreaming();
+					return true;
+				});
+			}
+			else
+				actors->AddItem(actor);
+			break;
+
+		case VRCommand::RemoveActor:
+			if (!actor)
+				break;
+			if (renderer && this->isRunning()) {
+				/* Queued behind any add of the same part that is still waiting */
+				vtkSmartPointer<vtkActor> removed = actor;
+				std::shared_ptr<int> share = appliedParts.value(actor).geometryShare;   // still shown until then
+				scheduler.post("remove part", [this, removed, share](std::chrono::steady_clock::time_point) {
+					uploads.remove(renderer, removed);
+					lod.remove(removed);
+					picker.remove(removed);
+					return true;
+				});
+			}
+			actors->RemoveItem(actor);
+			appliedParts.remove(actor);
+			break;
+
+		case VRCommand::SwapFilter:
+			if (actor && command.data)
+				setGeometry(actor, command.data);
+			break;
+
+		case VRCommand::Pause:
+			if (!this->isRunning() || paused)
+				break;
+			paused = true;
+			backend->setSuspended(true);
+			qDebug() << "VR paused";
 			break;
 
-		case ROTATE_Z:
-			this->rotateZ = value;
+		case VRCommand::Resume:
+			if (!paused)
+				break;
+			paused = false;
+			backend->setSuspended(false);
+			t_last = std::chrono::steady_clock::now();     // no animation jump for the time spent paused
+			qDebug() << "VR resumed";
+			break;
+
+		case VRCommand::SetLighting:
+			sceneLight->SetIntensity(command.values[0]);
+			sceneLight->SetPosition(command.values[1], command.values[2], command.values[3]);
+			sceneLight->SetFocalPoint(command.values[4], command.values[5], command.values[6]);
+			break;
+
+		case VRCommand::SetLodError:
+			lod.setErrorPixels(command.values[0]);
 			break;
 	}
 }
 
+void VRRenderThread::applyScene() {
+	const VRSceneSnapshot& snapshot = sceneBuffer.current();
+
+	/* Forget parts that have left the scene, this also lets go of their actors and geometry */
+	for (vtkActor* actor : snapshot.removed)
+		appliedParts.remove(actor);
+
+	/* The snapshot only holds parts edited since the last one taken, a big edit on the GUI side
+	 * arrives as one snapshot however many parts it changed
+	 */
+	for (auto it = snapshot.parts.constBegin(); it != snapshot.parts.constEnd(); ++it) {
+		const VRPartState& state = it.value();
+		auto previous = appliedParts.constFind(it.key());
+		if (previous != appliedParts.constEnd() && previous->version == state.version)
+			continue;
+
+		vtkActor* actor = state.actor;
+		actor->GetProperty()->SetColor(state.colour[0], state.colour[1], state.colour[2]);
+
+		if (actor->GetVisibility() != (state.visible ? 1 : 0)) {
+			actor->SetVisibility(state.visible);
+			uploads.updatePose(actor);
+			picker.moved();
+		}
+
+		if (state.geometry)
+			setGeometry(actor, state.geometry, state.geometryShare);
+
+		appliedParts.insert(it.key(), state);
+	}
+
+	/* The parts hold their shares from here on, a share left in the snapshot would stop the GUI
+	 * rewriting the output in place long after it is shown */
+	sceneBuffer.releaseShares();
+}
+
+
+void VRRenderThread::setGeometry( vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share ) {
+	vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(actor->GetMapper());
+
+	/* Already showing it, e.g. a snapshot that only changed the colour */
+	if (mapper && mapper->GetInput() == data)
+		return;
+
+	if (renderer && this->isRunning()) {
+		/* The old geometry is rendered until the swap, so its share is let go with the task */
+		vtkSmartPointer<vtkActor> changed = actor;
+		vtkSmartPointer<vtkPolyData> geometry = data;
+		std::shared_ptr<int> previous = appliedParts.value(actor).geometryShare;
+		scheduler.post("swap geometry", [this, changed, geometry, share, previous](std::chrono::steady_clock::time_point) {
+			uploads.setData(renderer, changed, geometry);
+			lod.add(changed, geometry, share);
+			picker.add(changed, geometry, share);
+			scheduleStreaming();
+			return true;
+		});
+	}
+	else if (mapper)
+		mapper->SetInputData(data);
+}
+
+
+void VRRenderThread::scheduleStreaming() {
+	if (streaming || !uploads.busy())
+		return;
+
+	/* One task streams every part, a few pieces per frame, until none are left */
+	streaming = true;
+	scheduler.post("stream pieces", [this](std::chrono::steady_clock::time_point deadline) {
+		uploads.process(deadline);
+		streaming = uploads.busy();
+		return !streaming;
+	});
+}
+
 /* This function runs in a separate thread. This means that the program 
  * can fork into two separate execution paths. This thread is triggered by
  * calling VRRenderThread::start()
@@ -121,102 +393,216 @@ void VRRenderThread::run() {
 	std::array<unsigned char, 4> bkg{ {26, 51, 102, 255} };
 	colors->SetColor("BkgColor", bkg.data());
 	
+	/* The backend makes the window, renderer and camera, see OpenVRBackend and MockVRBackend */
+	if (!backend->initialise()) {
+		qDebug() << "VR backend" << backend->name() << "could not start";
+		return;
+	}
+
 	// The renderer generates the image
 	// which is then displayed on the render window.
 	// It can be thought of as a scene to which the actor is added
-	renderer = vtkOpenVRRenderer::New();
-	
-	renderer->SetBackground(colors->GetColor3d("BkgColor").GetData());
-	
-	
-
-	/* The render window is the actual GUI window
-	 * that appears on the computer screen
+	/* Part state published before the thread started, applied while there is no renderer yet so new
+	 * geometry just goes into the mappers, before the parts are uploaded
 	 */
-	window = vtkOpenVRRenderWindow::New();
-
-	window->Initialize();
-	window->AddRenderer(renderer);
+	if (sceneBuffer.acquire())
+		applyScene();
 
-	window->SetUseOffScreenBuffers(true);  // Use dedicated offscreen buffers
-	window->SetSharedRenderWindow(nullptr); // Don't share context with main window
-	window->SetMultiSamples(0);            // Disable multisampling for the context
-	 
+	renderer = backend->renderer();
 	
-	/* Create Open VR Camera */
-	camera = vtkOpenVRCamera::New();				
-	renderer->SetActiveCamera(camera);			
-
-	/* The render window interactor captures mouse events
-	 * and will perform appropriate camera or actor manipulation
-	 * depending on the nature of the events.
-	 */
-	interactor = vtkOpenVRRenderWindowInteractor::New();									
-	interactor->SetRenderWindow(window);													
-	interactor->Initialize();
-	window->Render();
+	renderer->SetBackground(colors->GetColor3d("BkgColor").GetData());
+	renderer->AddLight(sceneLight);
+	renderer->GetActiveCamera()->SetModelTransformMatrix(sceneTransform->GetMatrix());
 
 	/* Loop through list of actors provided and add to scene */
 	vtkActor* a;
 	actors->InitTraversal();
 	while( (a = (vtkActor*)actors->GetNextActor() ) ) {
-		renderer->AddActor(a);
+		uploads.add(renderer, a);
+		if (vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(a->GetMapper())) {
+			lod.add(a, mapper->GetInput());
+			picker.add(a, mapper->GetInput());
+		}
 	}
+	scheduleStreaming();
 
 	
 
+	/* The compositor paces the loop, window->Render() waits in WaitGetPoses() until the headset
+	 * wants the next frame. Its refresh rate decides how long a frame is, FRAME_TIME is only used if
+	 * the headset does not report one
+	 */
+	double displayHz = backend->displayHz();
+	if (displayHz <= 0.)
+		displayHz = 1000. / FRAME_TIME;
+	const std::chrono::duration<double> framePeriod(1. / displayHz);
+
+	VRBackend::CompositorStats startStats;
+	backend->compositorStats(startStats);
+
+	{
+		QMutexLocker locker(&mutex);
+		frames = FrameStats();
+		frames.displayHz = displayHz;
+		workReports.clear();
+		governor = VRFrameGovernor(1000. / displayHz);
+	}
+
 	/* Now start the VR - we will implement the command loop manually
 	 * so it can be interrupted to make modifications to the actors
 	 * (i.e. to implement animation)
 	 */
 	endRender = false;
+	paused = false;
 	t_last = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point t_report = t_last;
+	qint64 reportedMissed = 0;
+
+	while( !backend->done() && !this->endRender ) {
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+		/* Apply any changes made in the GUI since the last frame */
+		drainCommands();
+		if (this->endRender)
+			break;
+
+		/* While paused the window, renderer and uploaded geometry stay alive, only commands are applied */
+		if (paused) {
+			QMutexLocker locker(&mutex);
+			condition.wait(&mutex, 50);
+			continue;
+		}
+
+		/* Pick up the newest part state the GUI published, this never waits for the GUI thread */
+		if (sceneBuffer.acquire())
+			applyScene();
 
-	while( !interactor->GetDone() && !this->endRender ) {
-		interactor->DoOneEvent( window, renderer );
-
-		/* Check to see if enough time has elapsed since last update 
-		 * This looks overcomplicated (and it is, C++ loves to make things unecessarily complicated!) but
-		 * is really just checking if more than 20ms have elaspsed since the last animation step. The 
-		 * complications comes from the fact that numbers representing time on computers don't usually have
-		 * standard second/millisecond units. Because everything is a class in C++, the converion from
-		 * computer units to seconds/milliseconds ends up looking like what you see below.
-		 * 
-		 * My choice of 20ms is arbitrary, if this value is too small the animation calculations could begin to
-		 * interfere with the interator processes and make the simulation unresponsive. If it is too large
-		 * the animations will be jerky. Play with the value to see what works best.
+		/* Scene work (adding parts, swapping geometry, splitting large parts into pieces) only gets
+		 * the time the last frame left over, anything else waits for the next frame
 		 */
-		if (std::chrono::duration_cast <std::chrono::milliseconds> (std::chrono::steady_clock::now() - t_last).count() > FRAME_TIME) {
+		VRFrameScheduler::FrameReport work = scheduler.run(VRFrameScheduler::budgetFor(1000. / displayHz, lastDrawMs));
+
+		/* Coarser levels for parts far from the headset, sooner when the governor is short of time */
+		int lodSwitches = lod.update(renderer, sceneTransform->GetMatrix(), uploads, governor.lodBias());
+
+		/* Draws the frame, waiting for the compositor */
+		backend->renderFrame();
+
+		/* A select press on a controller (handled while drawing) picks the part it points at */
+		double rayOrigin[3], rayDirection[3];
+		bool picked = backend->takeSelectRay(rayOrigin, rayDirection);
+		double pickMs = 0.;
+		if (picked) {
+			std::chrono::steady_clock::time_point pickStart = std::chrono::steady_clock::now();
+			VRPicker::Hit hit = picker.pick(sceneTransform->GetMatrix(), rayOrigin, rayDirection);
+			pickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pickStart).count();
+			if (hit.actor)
+				emit partPicked(hit.actor);
+		}
 
-			/* Do things that might need doing ... */
-			vtkActorCollection* actorList = renderer->GetActors();
-			vtkActor* a;
+		/* If the compositor did not make us wait (headset asleep, dashboard open) sleep for the
+		 * rest of the frame instead of spinning
+		 */
+		std::chrono::duration<double> busy = std::chrono::steady_clock::now() - frameStart;
+		if (busy < framePeriod / 2)
+			QThread::usleep(static_cast<unsigned long>(std::chrono::duration<double, std::micro>(framePeriod - busy).count()));
 
-			/* X Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateX(rotateX);
-			}
+		/* Animation is time based, the rotation speeds are in degrees per second. A long stall
+		 * is capped so the scene does not jump
+		 */
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double dt = std::chrono::duration<double>(now - t_last).count();
+		t_last = now;
+		double step = std::min(dt, 0.1);
+
+		if (rotateX != 0. || rotateY != 0. || rotateZ != 0.) {
+			/* Only the camera's model transform changes, each part keeps its own cached matrix and
+			 * is still culled against the (turned) view on its own
+			 */
+			sceneTransform->RotateX(rotateX * step);
+			sceneTransform->RotateY(rotateY * step);
+			sceneTransform->RotateZ(rotateZ * step);
+
+			renderer->GetActiveCamera()->SetModelTransformMatrix(sceneTransform->GetMatrix());
+		}
 
-			/* Y Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateY(rotateY);
+		/* Time the GPU spent on our frame, as measured by the compositor */
+		double gpuMs = backend->gpuFrameMs();
+		lastDrawMs = gpuMs;
+		double eyeMs[2];
+		bool timedEyes = backend->eyeFrameMs(eyeMs);
+
+		/* Dropped and reprojected frames are counted by the compositor, read them once a second */
+		VRBackend::CompositorStats stats;
+		bool readStats = now - t_report > std::chrono::seconds(1) && backend->compositorStats(stats);
+		if (readStats)
+			t_report = now;
+
+		bool governorChanged;
+		{
+			QMutexLocker locker(&mutex);
+			governorChanged = governor.update(gpuMs);
+			frames.renderScale = governor.renderScale();
+			frames.lodBias = governor.lodBias();
+
+			frames.frames++;
+			frames.totalFrameMs += dt * 1000.;
+			frames.maxFrameMs = std::max(frames.maxFrameMs, dt * 1000.);
+			frames.totalGpuMs += gpuMs;
+			frames.lastGpuMs = gpuMs;
+			frames.lodSwitches += lodSwitches;
+			frames.totalWorkMs += work.usedMs;
+			frames.maxWorkMs = std::max(frames.maxWorkMs, work.usedMs);
+			frames.totalWorkBudgetMs += work.budgetMs;
+			if (work.waiting > 0)
+				frames.deferredFrames++;
+			if (picked) {
+				frames.picks++;
+				frames.totalPickMs += pickMs;
+				frames.maxPickMs = std::max(frames.maxPickMs, pickMs);
 			}
-
-			/* Z Rotation */
-			actorList->InitTraversal();
-			while ((a = (vtkActor*)actorList->GetNextActor())) {
-				a->RotateZ(rotateZ);
+			workReports.append(work);
+			if (workReports.size() > MaxWorkReports)
+				workReports.removeFirst();
+			if (timedEyes) {
+				frames.eyeFrames++;
+				for (int eye = 0; eye < 2; eye++) {
+					frames.totalEyeMs[eye] += eyeMs[eye];
+					frames.maxEyeMs[eye] = std::max(frames.maxEyeMs[eye], eyeMs[eye]);
+				}
 			}
+			if (readStats) {
+				frames.missedFrames = stats.droppedFrames - startStats.droppedFrames;
+				frames.reprojectedFrames = stats.reprojectedFrames - startStats.reprojectedFrames;
+			}
+		}
 
-			camera->Modified();
-			
-			/* Remember time now */
-			t_last = std::chrono::steady_clock::now();
+		/* Draw the next frames at the resolution the governor picked */
+		if (governorChanged)
+			backend->setRenderScale(frames.renderScale);
+
+		if (readStats && frames.missedFrames > reportedMissed) {
+			qDebug() << "VR missed" << frames.missedFrames - reportedMissed << "frames in the last second, the scene may be too heavy";
+			reportedMissed = frames.missedFrames;
 		}
 	}
-}
 
+	FrameStats stats = frameStats();
+	qDebug() << "VR frames (" << backend->name() << "):" << stats.frames << "at" << stats.displayHz << "Hz, mean" << stats.meanFrameMs() << "ms, max"
+	         << stats.maxFrameMs << "ms, GPU" << stats.meanGpuMs() << "ms, missed" << stats.missedFrames
+	         << "reprojected" << stats.reprojectedFrames;
+	if (stats.eyeFrames > 0)
+		qDebug() << "VR eyes: left mean" << stats.meanEyeMs(0) << "ms, max" << stats.maxEyeMs[0] << "ms, right mean"
+		         << stats.meanEyeMs(1) << "ms, max" << stats.maxEyeMs[1] << "ms";
+	qDebug() << "VR governor made" << governorDecisions().size() << "changes, ended at render scale" << stats.renderScale
+	         << "LOD bias" << stats.lodBias << "," << stats.lodSwitches << "detail level changes";
 
+	qDebug() << "VR scene work: mean" << stats.meanWorkMs() << "ms of a mean" << (stats.frames > 0 ? stats.totalWorkBudgetMs / stats.frames : 0.)
+	         << "ms budget, max" << stats.maxWorkMs << "ms," << stats.deferredFrames << "frames left work for later";
 
+	if (stats.picks > 0)
+		qDebug() << "VR picking:" << stats.picks << "picks, mean" << stats.meanPickMs() << "ms, max" << stats.maxPickMs << "ms";
+
+	CommandLatency latency = commandLatency();
+	qDebug() << "VR command latency:" << latency.count << "commands, mean" << latency.meanMs << "ms, max" << latency.maxMs << "ms";
+}
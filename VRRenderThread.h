@@ -12,6 +12,15 @@
 
 
 /* Project headers */
+#include "SpscQueue.h"
+#include "VRCommand.h"
+#include "VRUploadQueue.h"
+#include "VRFrameGovernor.h"
+#include "VRLevelOfDetail.h"
+#include "VRSceneSnapshot.h"
+#include "VRFrameScheduler.h"
+#include "VRPicker.h"
+#include "VRBackend.h"
 
 /* Qt headers */
 #include <QThread>
@@ -20,15 +29,18 @@
 
 /* Vtk headers */
 #include <vtkActor.h>
-#include <vtkOpenVRRenderWindow.h>				
-#include <vtkOpenVRRenderWindowInteractor.h>	
-#include <vtkOpenVRRenderer.h>					
-#include <vtkOpenVRCamera.h>	
+#include <vtkRenderer.h>
 #include <vtkActorCollection.h>
 #include <vtkCommand.h>
+#include <vtkLight.h>
+#include <vtkTransform.h>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
 
-#define FRAME_TIME 11 // 11ms ≈ 90 FPS
+
+#define FRAME_TIME 11 // 11ms ≈ 90 FPS, only used if the headset does not report its refresh rate
 
 /* Note that this class inherits from the Qt class QThread which allows it to be a parallel thread
  * to the main() thread, and also from vtkCommand which allows it to act as a "callback" for the 
@@ -40,7 +52,7 @@ class VRRenderThread : public QThread {
     Q_OBJECT
 
 public:
-    /** List of command names */
+    /** List of command names, kept for issueCommand(), see VRCommand for the full set */
     enum {
         END_RENDER,
         ROTATE_X,
@@ -62,19 +74,119 @@ public:
      */
     void addActorOffline(vtkActor* actor);
 
+    /** Adds a part's actor to the VR scene, whether or not VR is running. Large parts are
+      * streamed in over several frames, see VRUploadQueue. Must only be called from the GUI thread
+      * @param actor the part's VR actor, it is given the same initial placement as addActorOffline()
+      */
+    void addActor(vtkActor* actor);
+
+    /** Removes a part's actor from the VR scene, whether or not VR is running. Must only be
+      * called from the GUI thread. The part also leaves the working scene(), it is dropped from the
+      * published snapshots the next time the scene is published
+      * @param actor the part's VR actor
+      */
+    void removeActor(vtkActor* actor);
+
+    /** Gets the scene description the GUI thread edits and publishes, the VR thread picks up the
+      * newest published version at the start of each frame. Colour, visibility and geometry
+      * changes go through this, adding and removing parts and everything else through pushCommand().
+      * Must only be used from the GUI thread
+      * @return the scene buffer
+      */
+    VRSceneBuffer& scene() { return sceneBuffer; }
+
 
     /** This allows commands to be issued to the VR thread in a thread safe way. 
-      * Function will set variables within the class to indicate the type of
-      * action / animation / etc to perform. The rendering thread will then impelement this.
+      * The command is converted to a VRCommand and queued, see pushCommand()
       */
     void issueCommand( int cmd, double value );
 
-    /** This function will return the interactor object, which can be used to control the VR headset
-      * and other VR devices.
+    /** Queues a change to the VR scene, the VR thread applies it at the start of its next frame.
+      * Must only be called from the GUI thread (the queue has a single producer). If the thread is
+      * not running the change is applied straight away. If the queue is full this waits for the
+      * VR thread to make room, which takes at most one frame
+      * @param command the change to make
+      */
+    void pushCommand( VRCommand command );
+
+    /** Time from a command being issued to it being applied in the VR scene */
+    struct CommandLatency {
+        qint64  count = 0;      /**< Commands applied */
+        double  meanMs = 0.;    /**< Average latency in milliseconds */
+        double  maxMs = 0.;     /**< Longest latency in milliseconds */
+    };
+
+    /** Gets the command latency measured since the thread started, safe to call from any thread
+      * @return the latency statistics
+      */
+    CommandLatency commandLatency() const;
+
+    /** Frame timing of the current (or last) VR session */
+    struct FrameStats {
+        qint64  frames = 0;             /**< Frames drawn */
+        double  displayHz = 0.;         /**< Refresh rate of the headset */
+        double  totalFrameMs = 0.;      /**< Sum of the time between frames */
+        double  maxFrameMs = 0.;        /**< Longest time between frames */
+        double  totalGpuMs = 0.;        /**< Sum of the GPU time of our frames, reported by the compositor */
+        double  lastGpuMs = 0.;         /**< GPU time of the last frame */
+        qint64  missedFrames = 0;       /**< Frames the compositor dropped because ours was late */
+        qint64  reprojectedFrames = 0;  /**< Frames the compositor had to reproject */
+        double  renderScale = 1.;       /**< Render target scale picked by the governor */
+        double  lodBias = 0.;           /**< LOD bias picked by the governor */
+        qint64  eyeFrames = 0;          /**< Frames with eye times, only backends that time eyes separately */
+        double  totalEyeMs[2] = { 0., 0. };     /**< Sum of the left and right eye draw times */
+        double  maxEyeMs[2] = { 0., 0. };       /**< Longest left and right eye draw times */
+        qint64  lodSwitches = 0;        /**< Times a part changed detail level */
+        double  totalWorkMs = 0.;       /**< Sum of the time spent on scene work, see VRFrameScheduler */
+        double  maxWorkMs = 0.;         /**< Longest time spent on scene work in one frame */
+        double  totalWorkBudgetMs = 0.; /**< Sum of the time frames could spare for scene work */
+        qint64  deferredFrames = 0;     /**< Frames that left scene work for later */
+        qint64  picks = 0;              /**< Controller select presses, see VRPicker */
+        double  totalPickMs = 0.;       /**< Sum of the time taken to pick */
+        double  maxPickMs = 0.;         /**< Longest time taken to pick */
+
+        double meanFrameMs() const { return frames > 0 ? totalFrameMs / frames : 0.; }    /**< Average time between frames */
+        double meanGpuMs() const { return frames > 0 ? totalGpuMs / frames : 0.; }        /**< Average GPU time per frame */
+        double meanWorkMs() const { return frames > 0 ? totalWorkMs / frames : 0.; }      /**< Average scene work per frame */
+        double meanPickMs() const { return picks > 0 ? totalPickMs / picks : 0.; }        /**< Average time taken to pick */
+        double meanEyeMs(int eye) const { return eyeFrames > 0 ? totalEyeMs[eye] / eyeFrames : 0.; }  /**< Average draw time of one eye */
+    };
+
+    /** Gets the frame timing, safe to call from any thread. Missed and reprojected frames are
+      * updated once a second
+      * @return the frame statistics
+      */
+    FrameStats frameStats() const;
+
+    /** Gets the changes the frame governor made to the render scale and LOD bias in the current
+      * (or last) VR session, safe to call from any thread
+      * @return the decisions, oldest first
+      */
+    QList<VRFrameGovernor::Decision> governorDecisions() const;
+
+    /** Gets what scene work ran in each of the last frames, safe to call from any thread
+      * @return up to MaxWorkReports reports, oldest first
       */
-    vtkOpenVRRenderWindowInteractor* getInteractor() { return interactor; }
-    void updateRender();  // Update the render window
+    QList<VRFrameScheduler::FrameReport> recentWork() const;
 
+    static const int MaxWorkReports = 256;      /**< Frames of scene work reports kept */
+
+    /** Checks if the session is paused, see VRCommand::Pause
+      * @return true while paused
+      */
+    bool isPaused() const { return paused.load(); }
+
+    /** Gets the name of the VR backend this thread draws with, see VRBackend
+      * @return "openvr" or "mock"
+      */
+    QString backendName() const { return backend->name(); }
+
+signals:
+    /** Emitted by the VR thread when a controller selects a part
+      * @param actor the part's VR actor, only to be compared with the parts' actors as the part may
+      *        have been removed by the time the signal arrives
+      */
+    void partPicked(vtkActor* actor);
 
 protected:
     /** This is a re-implementation of a QThread function 
@@ -82,35 +194,104 @@ protected:
     void run() override;
 
 private:
-    /* Standard VTK VR Classes */
-    vtkSmartPointer<vtkOpenVRRenderWindow>              window;
-    vtkSmartPointer<vtkOpenVRRenderWindowInteractor>    interactor;
-    vtkSmartPointer<vtkOpenVRRenderer>                  renderer;
-    vtkSmartPointer<vtkOpenVRCamera>                    camera;
+    /** Applies every queued command, called by the VR thread at the start of each frame */
+    void drainCommands();
+
+    /** Applies one command to the VR scene (or to the offline actor list if the thread is not running)
+      * @param command the change to make
+      */
+    void applyCommand( const VRCommand& command );
+
+    /** Applies the parts of the newest scene snapshot that changed since the last one applied */
+    void applyScene();
+
+    /** Changes the geometry a part's actor shows, streaming it in if VR is running
+      * @note the share of the geometry shown until now is kept until the new one has replaced it
+      * @param actor the part's VR actor
+      * @param data the new geometry
+      * @param share share of the filter cache entry holding data, see VRPartState::geometryShare
+      */
+    void setGeometry( vtkActor* actor, vtkPolyData* data, std::shared_ptr<int> share = std::shared_ptr<int>() );
+
+    /** Queues a task that streams in the pieces of large parts, if there are any and it is not queued yet */
+    void scheduleStreaming();
+
+    /* VR runtime and window, OpenVR or the headless mock */
+    std::unique_ptr<VRBackend>                          backend;
+    vtkRenderer*                                        renderer = nullptr;     /**< Backend's renderer, null until run() starts */
 
     /* Use to synchronise passing of data to VR thread */
-    QMutex                                              mutex;      
-    QWaitCondition                                      condition;
+    mutable QMutex                                      mutex;      /**< Guards the latency and frame statistics */
+    QWaitCondition                                      condition;  /**< Wakes the thread while paused when a command is queued */
+
+    /** Set by the Pause command, the session stays open but nothing is drawn */
+    std::atomic<bool>                                   paused{ false };
+
+    /** Scene changes from the GUI thread, drained by the VR thread every frame */
+    SpscQueue<VRCommand, 1024>                          commands;
+
+    /** Part state published by the GUI thread, read by the VR thread without waiting */
+    VRSceneBuffer                                       sceneBuffer;
+
+    /** Part state last applied from a snapshot, only used by the VR thread */
+    QHash<vtkActor*, VRPartState>                       appliedParts;
+
+    /** Latency statistics, written by the VR thread under the mutex */
+    qint64                                              latencyCount = 0;
+    double                                              latencyTotalMs = 0.;
+    double                                              latencyMaxMs = 0.;
+
+    /** Frame statistics, written by the VR thread under the mutex */
+    FrameStats                                          frames;
+
+    /** Keeps the GPU time within the frame budget, written by the VR thread under the mutex */
+    VRFrameGovernor                                     governor;
+
+    /** Light controlled by the SetLighting command, matches the desktop lighting panel */
+    vtkSmartPointer<vtkLight>                           sceneLight;
+
+    /** Rotation last requested through issueCommand(), only used by the GUI thread */
+    double                                              requestedRotation[3] = { 0., 0., 0. };
+
+    /** Turn of the whole VR scene, given to the camera as its model transform so the parts stay top level
+     *  props (culled one by one) and turning the scene changes no part's matrix */
+    vtkSmartPointer<vtkTransform>                       sceneTransform;
+
+    /** Actors in the running scene, large ones are streamed in a few pieces per frame */
+    VRUploadQueue                                       uploads;
+
+    /** Picks the detail level of each part from its distance to the headset */
+    VRLevelOfDetail                                     lod;
+
+    /** Finds the part a controller points at */
+    VRPicker                                            picker;
+
+    /** Scene work waiting for a frame with time to spare, only used by the VR thread */
+    VRFrameScheduler                                    scheduler;
+    bool                                                streaming = false;  /**< True while a "stream pieces" task is queued */
+    double                                              lastDrawMs = 0.;    /**< GPU time of the last frame, sets the next frame's work budget */
+
+    /** Scene work of the last frames, written by the VR thread under the mutex */
+    QList<VRFrameScheduler::FrameReport>                workReports;
 
     /** List of actors that will need to be added to the VR scene */
     vtkSmartPointer<vtkActorCollection>                 actors;
 
-    /** A timer to help implement animations and visual effects */
+    /** Time of the last frame, animation steps are scaled by the time since */
     std::chrono::time_point<std::chrono::steady_clock>  t_last;
 
-    /** This will be set to false by the constructor, if it is set to true
-      * by the GUI then the rendering will end 
+    /** Set by the EndRender command, the rendering then ends. Only used by the VR thread
       */
-    bool                                                endRender;
+    bool                                                endRender = false;
 
-    /* Some variables to indicate animation actions to apply.
+    /* Some variables to indicate animation actions to apply, set by the SetRotation command.
      *
      */
-    double rotateX;         /*< Degrees to rotate around X axis (per time-step) */
-    double rotateY;         /*< Degrees to rotate around Y axis (per time-step) */
-    double rotateZ;         /*< Degrees to rotate around Z axis (per time-step) */
+    double rotateX;         /*< Degrees per second to rotate around X axis */
+    double rotateY;         /*< Degrees per second to rotate around Y axis */
+    double rotateZ;         /*< Degrees per second to rotate around Z axis */
 };
 
-
+Q_DECLARE_METATYPE(vtkActor*)
 
 #endif
@@ -0,0 +1,85 @@
+/**     @file VRRuntimeProbe.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Background check for SteamVR and a headset, so starting VR does not
+  *     have to initialise OpenVR just to find out if it can.
+  */
+
+#include "VRRuntimeProbe.h"
+#include "VRBackend.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#ifdef VRMV_WITH_OPENVR
+#include <openvr.h>
+#endif
+
+VRRuntimeProbe::VRRuntimeProbe(QObject* parent) : QThread(parent) {
+    start(QThread::LowPriority);
+}
+
+VRRuntimeProbe::~VRRuntimeProbe() {
+    {
+        QMutexLocker lock(&mutex);
+        quit = true;
+        wake.wakeAll();
+    }
+    wait();
+}
+
+bool VRRuntimeProbe::check() {
+    // The headless backend is always there
+    if (VRBackend::selectedName() == "mock")
+        return true;
+
+#ifdef VRMV_WITH_OPENVR
+    // Quick check: is the runtime installed on this machine?
+    if (!vr::VR_IsRuntimeInstalled())
+        return false;
+
+    // Is an HMD actually plugged in?
+    if (!vr::VR_IsHmdPresent())
+        return false;
+
+    // A background application only connects if SteamVR is already running, it never starts it
+    QMutexLocker lock(&runtimeMutex());
+    vr::EVRInitError initError = vr::VRInitError_None;
+    vr::VR_Init(&initError, vr::VRApplication_Background);
+    vr::VR_Shutdown();
+    return initError == vr::VRInitError_None;
+#else
+    return false;
+#endif
+}
+
+QMutex& VRRuntimeProbe::runtimeMutex() {
+    static QMutex runtime;
+    return runtime;
+}
+
+void VRRuntimeProbe::setSessionActive(bool active) {
+    sessionActive = active;
+    if (active && !isAvailable.exchange(true))
+        emit availabilityChanged(true);
+}
+
+void VRRuntimeProbe::run() {
+    forever {
+        if (!sessionActive) {
+            bool result = check();
+            checked = true;
+            if (isAvailable.exchange(result) != result) {
+                qDebug() << "VR runtime" << (result ? "available" : "not available");
+                emit availabilityChanged(result);
+            }
+        }
+
+        QMutexLocker lock(&mutex);
+        if (!quit)
+            wake.wait(&mutex, IntervalMs);
+        if (quit)
+            return;
+    }
+}
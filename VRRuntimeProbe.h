@@ -0,0 +1,94 @@
+/**     @file VRRuntimeProbe.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Background check for SteamVR and a headset, so starting VR does not
+  *     have to initialise OpenVR just to find out if it can.
+  */
+
+#ifndef VIEWER_VRRUNTIMEPROBE_H
+#define VIEWER_VRRUNTIMEPROBE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+
+/**
+ * @brief Checks every few seconds whether SteamVR is running with a headset connected
+ * @note The check connects to SteamVR as a background application, which fails straight away if
+ *       SteamVR is not running instead of starting it. OpenVR must only be initialised by one thread
+ *       at a time, so the check is skipped while a VR session is active (see setSessionActive())
+ *       and runtimeMutex() must be held by anything else that initialises OpenVR
+ */
+class VRRuntimeProbe : public QThread {
+    Q_OBJECT
+
+public:
+    static const int IntervalMs = 2000;     /**< Time between checks */
+
+    /**
+     * @brief Constructs the probe, the thread is started straight away
+     * @param parent Optional parent object
+     */
+    explicit VRRuntimeProbe(QObject* parent = nullptr);
+
+    /**
+     * @brief Stops the thread and waits for it to finish
+     */
+    ~VRRuntimeProbe();
+
+    /**
+     * @brief Checks for SteamVR and a headset now, on the calling thread
+     * @return true if SteamVR is installed and running and a headset is connected
+     */
+    static bool check();
+
+    /**
+     * @brief Lock held while OpenVR is initialised by the probe or the VR thread
+     * @return the lock
+     */
+    static QMutex& runtimeMutex();
+
+    /**
+     * @brief Checks if at least one check has finished
+     * @return true if available() can be used
+     */
+    bool hasResult() const { return checked.load(); }
+
+    /**
+     * @brief Gets the result of the latest check
+     * @return true if VR was available
+     */
+    bool available() const { return isAvailable.load(); }
+
+    /**
+     * @brief Stops checking while a VR session is active, the session itself shows VR is available
+     * @param active true while a VR session exists
+     */
+    void setSessionActive(bool active);
+
+signals:
+    /**
+     * @brief Emitted when VR becomes available or stops being available
+     * @param available result of the latest check
+     */
+    void availabilityChanged(bool available);
+
+protected:
+    /**
+     * @brief Runs a check every IntervalMs until the probe is destroyed
+     */
+    void run() override;
+
+private:
+    QMutex              mutex;                  /**< Guards quit */
+    QWaitCondition      wake;                   /**< Waited on between checks, woken to stop the thread */
+    bool                quit = false;           /**< Set by the destructor to end the thread */
+    std::atomic<bool>   checked{ false };       /**< True once a check has finished */
+    std::atomic<bool>   isAvailable{ false };   /**< Result of the latest check */
+    std::atomic<bool>   sessionActive{ false }; /**< True while a VR session exists */
+};
+
+#endif
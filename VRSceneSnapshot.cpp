@@ -0,0 +1,79 @@
+/**     @file VRSceneSnapshot.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Copy-on-write description of the VR scene, edited by the GUI thread and
+  *     read by the VR thread without either of them ever waiting for the other.
+  */
+
+#include "VRSceneSnapshot.h"
+
+VRPartState& VRSceneBuffer::edit(vtkActor* actor) {
+    VRPartState& state = working[actor];
+    state.actor = actor;
+    state.version = ++edits;
+    edited.insert(actor);
+    return state;
+}
+
+void VRSceneBuffer::remove(vtkActor* actor) {
+    working.remove(actor);
+    edited.remove(actor);
+    removed.insert(actor);
+}
+
+void VRSceneBuffer::publish() {
+    if (edited.isEmpty() && removed.isEmpty())
+        return;
+
+    // the back slot was emptied by the last publish
+    VRSceneSnapshot& snapshot = slots[back];
+
+    /* Only this thread sets Fresh, so a snapshot seen as fresh here is either still waiting or
+     * taken just now, carrying it over is right in both cases
+     */
+    const int waiting = middle.load(std::memory_order_acquire);
+    if (waiting & Fresh) {
+        snapshot.parts = slots[waiting & ~Fresh].parts;
+        snapshot.removed = slots[waiting & ~Fresh].removed;
+    }
+
+    for (vtkActor* actor : removed) {
+        snapshot.parts.remove(actor);
+        snapshot.removed.append(actor);
+    }
+    for (vtkActor* actor : edited)
+        snapshot.parts.insert(actor, working.value(actor));
+    snapshot.version = ++published;
+    edited.clear();
+    removed.clear();
+
+    // release makes the snapshot visible to the VR thread before it can see the slot as fresh
+    back = middle.exchange(back | Fresh, std::memory_order_acq_rel) & ~Fresh;
+
+    /* The slot handed back is either a snapshot folded into this one or one the VR thread has
+     * finished with, its contents (and geometry shares) are released now, on the GUI thread */
+    slots[back].parts.clear();
+    slots[back].removed.clear();
+}
+
+void VRSceneBuffer::releaseShares() {
+    // the front slot is only used by this thread, it is only written (and so detached) if it holds a share
+    VRSceneSnapshot& snapshot = slots[front];
+    bool shared = false;
+    for (auto it = snapshot.parts.cbegin(); it != snapshot.parts.cend() && !shared; ++it)
+        shared = it->geometryShare != nullptr;
+    if (!shared)
+        return;
+
+    for (auto it = snapshot.parts.begin(); it != snapshot.parts.end(); ++it)
+        it->geometryShare.reset();
+}
+
+bool VRSceneBuffer::acquire() {
+    if (!(middle.load(std::memory_order_acquire) & Fresh))
+        return false;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~Fresh;
+    return true;
+}
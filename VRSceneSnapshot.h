@@ -0,0 +1,105 @@
+/**     @file VRSceneSnapshot.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Copy-on-write description of the VR scene, edited by the GUI thread and
+  *     read by the VR thread without either of them ever waiting for the other.
+  */
+
+#ifndef VIEWER_VRSCENESNAPSHOT_H
+#define VIEWER_VRSCENESNAPSHOT_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkPolyData.h>
+
+#include <atomic>
+#include <memory>
+
+/** How one part should look in VR */
+struct VRPartState {
+    vtkSmartPointer<vtkActor>       actor;                  /**< VR actor of the part, kept alive while any snapshot has it */
+    double                          colour[3] = { 1., 1., 1. };     /**< RGB colour (0->1) */
+    bool                            visible = true;         /**< False to hide the part */
+    vtkSmartPointer<vtkPolyData>    geometry;               /**< Data the actor shows, null to leave it as it is. Never changed once published */
+    std::shared_ptr<int>            geometryShare;          /**< Share of the filter cache entry holding geometry, keeps it from being rewritten in place. Dropped from a snapshot once it is applied, see VRSceneBuffer::releaseShares() */
+    quint64                         version = 0;            /**< Changes every time the part is edited */
+};
+
+/** Changes to the scene made by one or more publishes, never changed once published */
+struct VRSceneSnapshot {
+    quint64                         version = 0;    /**< Number of the publish that made it */
+    QHash<vtkActor*, VRPartState>   parts;          /**< Whole state of each part edited since the last snapshot the VR thread took, by VR actor */
+    QList<vtkActor*>                removed;        /**< Parts taken out of the scene since then, applied before parts */
+};
+
+/**
+ * @brief Passes the part changes made on the GUI thread to the VR thread
+ * @note The GUI thread keeps the state of every part to itself and only publishes the parts edited
+ *       or removed since the last publish, so publishing and applying cost nothing for the parts
+ *       that did not change. Published snapshots go through a triple buffer: publish() swaps the back
+ *       slot for the middle one and acquire() swaps the middle slot for the front one, each with one
+ *       atomic exchange, so neither side ever waits. A snapshot the VR thread has not picked up yet
+ *       is folded into the next one instead of being lost. Parts carry their whole state with a
+ *       version, so applying a part twice (if the VR thread takes the folded snapshot just before it
+ *       is replaced) is skipped
+ */
+class VRSceneBuffer {
+public:
+    /**
+     * @brief Gets a part of the working snapshot to edit, only call from the GUI thread
+     * @note the part's version is changed, so the VR thread applies it again
+     * @param actor VR actor of the part
+     * @return the part's state, added if it was not in the scene
+     */
+    VRPartState& edit(vtkActor* actor);
+
+    /**
+     * @brief Removes a part from the working snapshot, only call from the GUI thread
+     * @param actor VR actor of the part
+     */
+    void remove(vtkActor* actor);
+
+    /**
+     * @brief Publishes the parts edited or removed since the last publish, only call from the GUI thread
+     */
+    void publish();
+
+    /**
+     * @brief Takes the newest published snapshot if there is one, only call from the VR thread
+     * @return true if current() changed
+     */
+    bool acquire();
+
+    /**
+     * @brief Drops the geometry shares of the snapshot last taken by acquire(), only call from the VR thread
+     * @note call once the parts have been applied and hold their own shares, so a snapshot waiting to be
+     *       reused does not keep the GUI from rewriting a filter output in place
+     */
+    void releaseShares();
+
+    /**
+     * @brief Gets the changes last taken by acquire(), only call from the VR thread
+     * @return the snapshot, empty before the first acquire()
+     */
+    const VRSceneSnapshot& current() const { return slots[front]; }
+
+private:
+    static const int Fresh = 4;         /**< Set in middle when it holds a snapshot not yet acquired */
+
+    QHash<vtkActor*, VRPartState>   working;    /**< State of every part, only used by the GUI thread */
+    QSet<vtkActor*>     edited;         /**< Parts edited since the last publish */
+    QSet<vtkActor*>     removed;        /**< Parts removed since the last publish */
+    VRSceneSnapshot     slots[3];       /**< Published snapshots, each owned by one side or in the middle */
+    int                 back = 0;       /**< Slot the GUI thread publishes into next */
+    int                 front = 1;      /**< Slot the VR thread is reading */
+    std::atomic<int>    middle{ 2 };    /**< Slot waiting to be acquired, with the Fresh flag */
+    quint64             edits = 0;      /**< Edits made, used for the part versions */
+    quint64             published = 0;  /**< Publishes made, used for the snapshot versions */
+};
+
+#endif
@@ -0,0 +1,259 @@
+/**     @file VRUploadQueue.cpp
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Streams part geometry into the running VR scene a few pieces per
+  *     frame so adding a large part never stalls the headset.
+  */
+
+#include "VRUploadQueue.h"
+
+#include <QDebug>
+
+#include <vtkPolyDataMapper.h>
+#include <vtkCellArray.h>
+#include <vtkPointData.h>
+#include <vtkCellData.h>
+#include <vtkPoints.h>
+#include <vtkIdList.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+
+namespace {
+
+/* Polygons copied between two looks at the clock while a piece is made */
+const vtkIdType CellsPerDeadlineCheck = 4096;
+
+/* Copies where a prop is, used when the pieces of an actor are made */
+void copyPose(vtkProp3D* from, vtkProp3D* to) {
+    to->SetOrigin(from->GetOrigin());
+    to->SetPosition(from->GetPosition());
+    to->SetOrientation(from->GetOrientation());
+    to->SetScale(from->GetScale());
+    to->SetUserMatrix(from->GetUserMatrix());
+    to->SetVisibility(from->GetVisibility());
+}
+
+/* Only plain polygon meshes are split, anything with verts, lines or strips is shown directly */
+bool needsPieces(vtkPolyData* data) {
+    return data && data->GetNumberOfPolys() > VRUploadQueue::PieceCells
+        && data->GetNumberOfCells() == data->GetNumberOfPolys();
+}
+}
+
+void VRUploadQueue::add(vtkRenderer* renderer, vtkActor* actor) {
+    vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(actor->GetMapper());
+    if (!mapper)
+        return;
+
+    Entry& entry = entries[actor];
+    entry.actor = actor;
+    show(renderer, entry, mapper->GetInput());
+}
+
+void VRUploadQueue::setData(vtkRenderer* renderer, vtkActor* actor, vtkPolyData* data) {
+    auto it = entries.find(actor);
+    if (it == entries.end()) {
+        if (vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(actor->GetMapper()))
+            mapper->SetInputData(data);
+        return;
+    }
+    show(renderer, it.value(), data);
+}
+
+void VRUploadQueue::remove(vtkRenderer* renderer, vtkActor* actor) {
+    auto it = entries.find(actor);
+    if (it == entries.end()) {
+        renderer->RemoveViewProp(actor);
+        return;
+    }
+
+    renderer->RemoveViewProp(shown(it.value()));
+
+    queue.removeAll(actor);
+    entries.erase(it);
+}
+
+void VRUploadQueue::updatePose(vtkActor* actor) {
+    auto it = entries.find(actor);
+    if (it == entries.end())
+        return;
+
+    if (it->pieces) {
+        it->pieces->SetUserMatrix(actor->GetUserMatrix());
+        it->pieces->SetVisibility(actor->GetVisibility());
+    }
+    for (vtkActor* levelActor : it->levels) {
+        levelActor->SetUserMatrix(actor->GetUserMatrix());
+        levelActor->SetVisibility(actor->GetVisibility());
+    }
+}
+
+bool VRUploadQueue::setLevels(vtkRenderer* renderer, vtkActor* actor, const QList<vtkSmartPointer<vtkPolyData>>& levels) {
+    auto it = entries.find(actor);
+    if (it == entries.end())
+        return false;
+
+    setLevel(renderer, actor, 0);
+    it->levels.clear();
+    for (vtkPolyData* data : levels) {
+        vtkNew<vtkPolyDataMapper> mapper;
+        mapper->SetInputData(data);
+        auto levelActor = vtkSmartPointer<vtkActor>::New();
+        levelActor->SetMapper(mapper);
+        levelActor->SetProperty(actor->GetProperty());     // colour changes reach every level
+        copyPose(actor, levelActor);
+        it->levels.append(levelActor);
+    }
+    return true;
+}
+
+bool VRUploadQueue::setLevel(vtkRenderer* renderer, vtkActor* actor, int level) {
+    auto it = entries.find(actor);
+    if (it == entries.end() || level < 0 || level > it->levels.size())
+        return false;
+    if (it->level == level)
+        return true;
+
+    renderer->RemoveViewProp(shown(it.value()));
+    it->level = level;
+    renderer->AddViewProp(shown(it.value()));
+    return true;
+}
+
+int VRUploadQueue::level(vtkActor* actor) const {
+    auto it = entries.constFind(actor);
+    return it == entries.constEnd() ? 0 : it->level;
+}
+
+vtkIdType VRUploadQueue::process(std::chrono::steady_clock::time_point deadline) {
+    vtkIdType cells = 0;
+    while (!queue.isEmpty() && cells < CellsPerFrame && std::chrono::steady_clock::now() < deadline) {
+        Entry& entry = entries[queue.first()];
+        cells += makePiece(entry, deadline, CellsPerFrame - cells);
+
+        if (entry.nextCell >= entry.data->GetNumberOfPolys()) {
+            qDebug() << "VR part streamed in," << entry.pieces->GetParts()->GetNumberOfItems() << "pieces";
+            entry.data = nullptr;
+            entry.pointMap = std::vector<vtkIdType>();
+            entry.used = std::vector<vtkIdType>();
+            queue.removeFirst();
+        }
+    }
+    return cells;
+}
+
+void VRUploadQueue::show(vtkRenderer* renderer, Entry& entry, vtkPolyData* data) {
+    vtkActor* actor = entry.actor;
+    vtkPolyDataMapper* mapper = vtkPolyDataMapper::SafeDownCast(actor->GetMapper());
+
+    // take down what is shown now, the detail levels were made from the old data
+    renderer->RemoveViewProp(shown(entry));
+    entry.pieces = nullptr;
+    entry.levels.clear();
+    entry.level = 0;
+    queue.removeAll(actor);
+
+    // the actor's mapper always holds the full data so the part can be shown directly again later
+    if (mapper && mapper->GetInput() != data)
+        mapper->SetInputData(data);
+
+    entry.piece = nullptr;
+    entry.used.clear();
+
+    if (!needsPieces(data)) {
+        entry.data = nullptr;
+        entry.pointMap = std::vector<vtkIdType>();
+        renderer->AddViewProp(actor);
+        return;
+    }
+
+    entry.data = data;
+    entry.nextCell = 0;
+    entry.pointMap.assign(data->GetNumberOfPoints(), -1);
+    entry.pieces = vtkSmartPointer<vtkAssembly>::New();
+    copyPose(actor, entry.pieces);
+    renderer->AddViewProp(entry.pieces);
+    queue.append(actor);
+}
+
+vtkProp3D* VRUploadQueue::shown(const Entry& entry) {
+    if (entry.level > 0)
+        return entry.levels[entry.level - 1];
+    if (entry.pieces)
+        return entry.pieces;
+    return entry.actor;
+}
+
+vtkIdType VRUploadQueue::makePiece(Entry& entry, std::chrono::steady_clock::time_point deadline, vtkIdType budget) {
+    vtkPolyData* data = entry.data;
+    vtkCellArray* polys = data->GetPolys();
+    vtkPointData* inPointData = data->GetPointData();
+    vtkCellData* inCellData = data->GetCellData();
+
+    if (!entry.piece) {
+        const vtkIdType left = polys->GetNumberOfCells() - entry.nextCell;
+        const vtkIdType size = left < PieceCells ? left : PieceCells;
+        entry.pieceEnd = entry.nextCell + size;
+
+        vtkNew<vtkPoints> points;
+        points->SetDataType(data->GetPoints()->GetDataType());
+        vtkNew<vtkCellArray> cells;
+        cells->AllocateEstimate(size, 3);
+
+        entry.piece = vtkSmartPointer<vtkPolyData>::New();
+        entry.piece->SetPoints(points);
+        entry.piece->SetPolys(cells);
+        entry.piece->GetPointData()->CopyAllocate(inPointData, 3 * size);
+        entry.piece->GetCellData()->CopyAllocate(inCellData, size);
+    }
+
+    vtkPolyData* piece = entry.piece;
+    vtkPoints* points = piece->GetPoints();
+    vtkCellArray* cells = piece->GetPolys();
+    const vtkIdType first = entry.nextCell;
+    const vtkIdType last = std::min(entry.pieceEnd, first + std::max<vtkIdType>(budget, 1));
+
+    // only the points the piece uses are copied, pointMap is cleared again once the piece is done
+    vtkNew<vtkIdList> ids;
+    vtkIdType cell = first;
+    while (cell < last) {
+        const vtkIdType chunkEnd = std::min(last, cell + CellsPerDeadlineCheck);
+        for (; cell < chunkEnd; ++cell) {
+            polys->GetCellAtId(cell, ids);
+            for (vtkIdType k = 0; k < ids->GetNumberOfIds(); ++k) {
+                const vtkIdType id = ids->GetId(k);
+                vtkIdType& mapped = entry.pointMap[id];
+                if (mapped < 0) {
+                    mapped = points->InsertNextPoint(data->GetPoints()->GetPoint(id));
+                    piece->GetPointData()->CopyData(inPointData, id, mapped);
+                    entry.used.push_back(id);
+                }
+                ids->SetId(k, mapped);
+            }
+            const vtkIdType newCell = cells->InsertNextCell(ids);
+            piece->GetCellData()->CopyData(inCellData, cell, newCell);   // every cell is a polygon, see needsPieces()
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+            break;
+    }
+    entry.nextCell = cell;
+
+    if (cell < entry.pieceEnd)
+        return cell - first;
+
+    for (vtkIdType id : entry.used)
+        entry.pointMap[id] = -1;
+    entry.used.clear();
+
+    vtkNew<vtkPolyDataMapper> mapper;
+    mapper->SetInputData(piece);
+    vtkNew<vtkActor> pieceActor;
+    pieceActor->SetMapper(mapper);
+    pieceActor->SetProperty(entry.actor->GetProperty());   // colour changes reach every piece
+    entry.pieces->AddPart(pieceActor);
+    entry.piece = nullptr;
+
+    return cell - first;
+}
@@ -0,0 +1,147 @@
+/**     @file VRUploadQueue.h
+  *
+  *     EEEE2076 - Software Engineering & VR Project
+  *
+  *     Streams part geometry into the running VR scene a few pieces per
+  *     frame so adding a large part never stalls the headset.
+  */
+
+#ifndef VIEWER_VRUPLOADQUEUE_H
+#define VIEWER_VRUPLOADQUEUE_H
+
+#include <QHash>
+#include <QList>
+
+#include <vtkSmartPointer.h>
+#include <vtkActor.h>
+#include <vtkAssembly.h>
+#include <vtkRenderer.h>
+#include <vtkPolyData.h>
+
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief Adds, swaps and removes part actors in the VR renderer, splitting large geometry across frames
+ * @note VTK uploads a mapper's whole input to the GPU the first time it is drawn, so a 5M triangle
+ *       part would stall one frame for as long as the upload takes. Parts with more than PieceCells
+ *       polygons are instead shown through an assembly of pieces, each with its own mapper, and only
+ *       CellsPerFrame polygons worth of pieces are made (and so uploaded) per frame, a piece
+ *       still being copied at the frame's deadline is finished in later frames. The part's actor
+ *       still holds the property, user matrix and visibility, the pieces share its property and
+ *       updatePose() copies the rest. An actor can also be given coarser detail levels, see
+ *       VRLevelOfDetail, each shown by its own actor sharing the part's property. Only used by the VR thread
+ */
+class VRUploadQueue {
+public:
+    static const vtkIdType PieceCells = 100000;     /**< Largest piece, parts with fewer polygons are shown directly */
+    static const vtkIdType CellsPerFrame = 200000;  /**< Most polygons made into pieces (and uploaded) in one frame */
+
+    /**
+     * @brief Starts showing an actor, with the data its mapper already has
+     * @param renderer renderer drawing the VR scene
+     * @param actor actor of the part, its mapper must be a vtkPolyDataMapper
+     */
+    void add(vtkRenderer* renderer, vtkActor* actor);
+
+    /**
+     * @brief Changes the geometry shown for an actor (a new filter result)
+     * @note if the actor is not in the scene only its mapper is changed
+     * @param renderer renderer drawing the VR scene
+     * @param actor actor of the part
+     * @param data the new geometry
+     */
+    void setData(vtkRenderer* renderer, vtkActor* actor, vtkPolyData* data);
+
+    /**
+     * @brief Removes an actor and any pieces made for it
+     * @param renderer renderer drawing the VR scene
+     * @param actor actor of the part
+     */
+    void remove(vtkRenderer* renderer, vtkActor* actor);
+
+    /**
+     * @brief Copies the visibility and user matrix of an actor to its pieces, call after changing them
+     * @param actor actor of the part
+     */
+    void updatePose(vtkActor* actor);
+
+    /**
+     * @brief Gives an actor coarser versions of its geometry and shows the full geometry again
+     * @note the levels are dropped when the actor is given new geometry with setData()
+     * @param renderer renderer drawing the VR scene
+     * @param actor actor of the part
+     * @param levels decimated geometry, finest first. Each should be small enough to upload in one frame
+     * @return false if the actor is not in the scene
+     */
+    bool setLevels(vtkRenderer* renderer, vtkActor* actor, const QList<vtkSmartPointer<vtkPolyData>>& levels);
+
+    /**
+     * @brief Changes the detail level an actor is shown at. The level's mapper keeps its GPU buffers
+     *        while it is not shown, so switching back and forth does not upload anything again
+     * @param renderer renderer drawing the VR scene
+     * @param actor actor of the part
+     * @param level 0 for the full geometry, n for the n'th level given to setLevels()
+     * @return false if the actor is not in the scene or has no such level
+     */
+    bool setLevel(vtkRenderer* renderer, vtkActor* actor, int level);
+
+    /**
+     * @brief Gets the detail level an actor is shown at
+     * @param actor actor of the part
+     * @return 0 for the full geometry (or if the actor is not in the scene)
+     */
+    int level(vtkActor* actor) const;
+
+    /**
+     * @brief Carries on making the pieces of the parts being streamed in
+     * @note a piece left half made at the deadline is carried on from the same polygon next time
+     * @param deadline no more polygons are copied after this time
+     * @return number of polygons copied into pieces
+     */
+    vtkIdType process(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Checks if any part is still being streamed in
+     * @return true if process() has work to do
+     */
+    bool busy() const { return !queue.isEmpty(); }
+
+private:
+    /** How one actor is shown */
+    struct Entry {
+        vtkSmartPointer<vtkActor>       actor;          /**< Part's actor, holds the property and user matrix */
+        vtkSmartPointer<vtkAssembly>    pieces;         /**< Pieces made so far, null if the actor is shown directly */
+        vtkSmartPointer<vtkPolyData>    data;           /**< Geometry still being split, null when done */
+        vtkIdType                       nextCell = 0;   /**< Next polygon to copy into a piece */
+        std::vector<vtkIdType>          pointMap;       /**< Input point to piece point, -1 if not in the piece */
+        vtkSmartPointer<vtkPolyData>    piece;          /**< Piece being made, null between pieces */
+        vtkIdType                       pieceEnd = 0;   /**< One past the last polygon of the piece being made */
+        std::vector<vtkIdType>          used;           /**< Input points copied into the piece being made */
+        QList<vtkSmartPointer<vtkActor>> levels;        /**< Actors showing the coarser levels, finest first */
+        int                             level = 0;      /**< Level shown, 0 for the full geometry */
+    };
+
+    /**
+     * @brief Gets the prop that is in the scene for an entry, its level actor, pieces or the actor itself
+     */
+    static vtkProp3D* shown(const Entry& entry);
+
+    /**
+     * @brief Replaces what is shown for an entry with the given data
+     */
+    void show(vtkRenderer* renderer, Entry& entry, vtkPolyData* data);
+
+    /**
+     * @brief Copies polygons into the piece being made for an entry, a finished piece is added to the entry's assembly
+     * @param deadline no more polygons are copied after this time
+     * @param budget most polygons to copy
+     * @return number of polygons copied
+     */
+    vtkIdType makePiece(Entry& entry, std::chrono::steady_clock::time_point deadline, vtkIdType budget);
+
+    QHash<vtkActor*, Entry>     entries;    /**< Every actor in the scene */
+    QList<vtkActor*>            queue;      /**< Actors with pieces still to make, oldest first */
+};
+
+#endif
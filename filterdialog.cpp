@@ -1,11 +1,25 @@
 #include "filterdialog.h"
 #include "ui_filterdialog.h"
+#include "FilterPipeline.h"
 
 FilterDialog::FilterDialog(QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::FilterDialog)
 {
     ui->setupUi(this);
+
+    // any change to the filter controls is reported so the part can be previewed while dragging
+    connect(ui->clipFilter_checkBox, &QCheckBox::toggled, this, &FilterDialog::filterValuesChanged);
+    connect(ui->shrinkFilter_tickBox, &QCheckBox::toggled, this, &FilterDialog::filterValuesChanged);
+    connect(ui->clipFilter_horizontalSlider, &QSlider::valueChanged, this, &FilterDialog::filterValuesChanged);
+    connect(ui->shrinkFilter_horizontalSlider, &QSlider::valueChanged, this, &FilterDialog::filterValuesChanged);
+    connect(ui->decimateFilter_checkBox, &QCheckBox::toggled, this, &FilterDialog::filterValuesChanged);
+    connect(ui->decimateTarget_spinBox, &QSpinBox::valueChanged, this, &FilterDialog::filterValuesChanged);
+    connect(ui->smoothFilter_checkBox, &QCheckBox::toggled, this, &FilterDialog::filterValuesChanged);
+    connect(ui->smoothMethod_comboBox, &QComboBox::currentIndexChanged, this, &FilterDialog::filterValuesChanged);
+    connect(ui->smoothIterations_spinBox, &QSpinBox::valueChanged, this, &FilterDialog::filterValuesChanged);
+    connect(ui->normalsFilter_checkBox, &QCheckBox::toggled, this, &FilterDialog::filterValuesChanged);
+    connect(ui->creaseAngle_spinBox, &QDoubleSpinBox::valueChanged, this, &FilterDialog::filterValuesChanged);
 }
 
 FilterDialog::~FilterDialog()
@@ -44,5 +58,34 @@ int FilterDialog::getShrinkFactor() const{
     return ui->shrinkFilter_horizontalSlider->value();
 }
 
+void FilterDialog::loadMeshFilters(const FilterPipeline& filters) {
+    if (FilterStage* decimate = filters.stage("decimate")) {
+        ui->decimateFilter_checkBox->setChecked(decimate->isEnabled());
+        ui->decimateTarget_spinBox->setValue(decimate->parameter("targetTriangles").toInt());
+    }
+    if (FilterStage* smooth = filters.stage("smooth")) {
+        ui->smoothFilter_checkBox->setChecked(smooth->isEnabled());
+        ui->smoothMethod_comboBox->setCurrentIndex(smooth->parameter("method").toString() == "taubin" ? 0 : 1);
+        ui->smoothIterations_spinBox->setValue(smooth->parameter("iterations").toInt());
+    }
+    if (FilterStage* normals = filters.stage("normals")) {
+        ui->normalsFilter_checkBox->setChecked(normals->isEnabled());
+        ui->creaseAngle_spinBox->setValue(normals->parameter("creaseAngle").toDouble());
+    }
+}
 
-
+void FilterDialog::applyMeshFilters(FilterPipeline& filters) const {
+    if (FilterStage* decimate = filters.stage("decimate")) {
+        decimate->setEnabled(ui->decimateFilter_checkBox->isChecked());
+        decimate->setParameter("targetTriangles", ui->decimateTarget_spinBox->value());
+    }
+    if (FilterStage* smooth = filters.stage("smooth")) {
+        smooth->setEnabled(ui->smoothFilter_checkBox->isChecked());
+        smooth->setParameter("method", QString(ui->smoothMethod_comboBox->currentIndex() == 0 ? "taubin" : "laplacian"));
+        smooth->setParameter("iterations", ui->smoothIterations_spinBox->value());
+    }
+    if (FilterStage* normals = filters.stage("normals")) {
+        normals->setEnabled(ui->normalsFilter_checkBox->isChecked());
+        normals->setParameter("creaseAngle", ui->creaseAngle_spinBox->value());
+    }
+}
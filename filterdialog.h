@@ -3,6 +3,8 @@
 
 #include <QDialog>
 
+class FilterPipeline;
+
 /**
  * @file FilterDialog.h
  * @brief Defines the FilterDialog class for configuring model part filter values
@@ -16,7 +18,7 @@ class FilterDialog;
 }
 
 /**
- * @brief Dialog window for configuring clip and shrink filters on a model part
+ * @brief Dialog window for configuring the filters of a model part
  * @note this dialog window allows the user to enable or disable filters and adjust the filter values applied to the model
  */
 class FilterDialog : public QDialog
@@ -68,6 +70,25 @@ public:
      */
     int getClipOrigin() const;
 
+    /**
+     * @brief Loads the decimate, smooth and normals stage values from a part's pipeline
+     * @param filters the part's filter pipeline
+     */
+    void loadMeshFilters(const FilterPipeline& filters);
+
+    /**
+     * @brief Writes the decimate, smooth and normals values of the dialog into a pipeline
+     * @note stages whose values did not change keep their cache key, so nothing is recomputed
+     * @param filters the pipeline to update
+     */
+    void applyMeshFilters(FilterPipeline& filters) const;
+
+signals:
+    /**
+     * @brief Emitted whenever a checkbox or slider changes, including while a slider is being dragged
+     * @note used to show a live preview of the filters before the dialog is accepted
+     */
+    void filterValuesChanged();
 
 private:
     Ui::FilterDialog *ui;   /**< Pointer to the user interface elements. */
@@ -7,9 +7,10 @@
 
 #include <QMessageBox>
 #include <QFileDialog>
-#include <QDirIterator>
-
-#include <openvr.h>
+#include <QFileInfo>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSignalBlocker>
 
 #include <vtkRenderer.h>
 #include <vtkCylinderSource.h>
@@ -19,7 +20,9 @@
 #include <vtkCamera.h>
 #include <vtkProperty.h>
 #include <QLabel>
+#include <QCheckBox>
 #include <QWidgetAction>
+#include <QHeaderView>
 
 #include <vtkGenericOpenGLRenderWindow.h>
 #include "VRRenderThread.h"
@@ -30,6 +33,7 @@
 #include <vtkShrinkPolyData.h>
 
 #include <vtkLight.h> //Lighting
+#include <vtkMath.h>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -44,6 +48,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->treeView->addAction(ui->actionFilterOptions);   
     ui->treeView->addAction(ui->actionReplace_Part);
     ui->treeView->addAction(ui->actionRemove_Part);
+    ui->treeView->addAction(ui->actionRepair_Part);
     
     ui->actionStart_VR->setEnabled(true); // Enable the Start VR action button
     ui->actionStop_VR->setEnabled(false); // Disable the Stop VR action button
@@ -63,6 +68,12 @@ MainWindow::MainWindow(QWidget *parent)
     checkConnect = connect(ui->addPushButton, &QPushButton::released, this, &MainWindow::addNewPart);
     Q_ASSERT(checkConnect);
 
+    // every keystroke filters the tree and the view through the part name index, Return fits the camera to the matches
+    checkConnect = connect(ui->searchLineEdit, &QLineEdit::textChanged, this, &MainWindow::applyPartSearch);
+    Q_ASSERT(checkConnect);
+    checkConnect = connect(ui->searchLineEdit, &QLineEdit::returnPressed, this, &MainWindow::fitCameraToSearch);
+    Q_ASSERT(checkConnect);
+
     // -------------------------------- UI PANELS ----------------------------------
 
     mainLight = vtkSmartPointer<vtkLight>::New();
@@ -108,6 +119,7 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(intensitySlider, &QSlider::valueChanged, this, [=](int val) {
         mainLight->SetIntensity(val / 100.0 * 5.0);
+        sendLightingToVR();
         renderWindow->Render();
     });
 
@@ -115,6 +127,7 @@ MainWindow::MainWindow(QWidget *parent)
         double rad = qDegreesToRadians(static_cast<double>(val));
         mainLight->SetPosition(50 * cos(rad), 50 * sin(rad), 0);
         mainLight->SetFocalPoint(0, 0, 0);
+        sendLightingToVR();
         renderWindow->Render();
     });
 
@@ -124,10 +137,109 @@ MainWindow::MainWindow(QWidget *parent)
         double rEl = qDegreesToRadians(static_cast<double>(val));
         mainLight->SetPosition(50 * cos(rEl) * cos(rAz), 50 * cos(rEl) * sin(rAz), 50 * sin(rEl));
         mainLight->SetFocalPoint(0, 0, 0);
+        sendLightingToVR();
         renderWindow->Render();
     });
     //END SLIDERS FOR LIGHTING
 
+    // Section view panel, the plane is applied on the GPU so the sliders only cause a redraw
+    QWidget *sectionPanel = new QWidget(this);
+    QVBoxLayout *sectionLayout = new QVBoxLayout(sectionPanel);
+    sectionLayout->setContentsMargins(8, 8, 8, 8);
+
+    QCheckBox *sectionEnabled = new QCheckBox("Enabled");
+    QCheckBox *sectionSelectedOnly = new QCheckBox("Selected parts only");
+    QCheckBox *sectionCaps = new QCheckBox("Caps");
+    sectionLayout->addWidget(sectionEnabled);
+    sectionLayout->addWidget(sectionSelectedOnly);
+    sectionLayout->addWidget(sectionCaps);
+
+    // Offset of the plane from the centre of the scene, percent of half the scene size
+    QSlider *sectionOffsetSlider = new QSlider(Qt::Horizontal);
+    sectionOffsetSlider->setRange(-100, 100);
+    sectionOffsetSlider->setValue(0);
+    sectionLayout->addWidget(new QLabel("Offset"));
+    sectionLayout->addWidget(sectionOffsetSlider);
+
+    // Plane normal direction, starts facing -x like the clip filter
+    QSlider *sectionAzimuthSlider = new QSlider(Qt::Horizontal);
+    sectionAzimuthSlider->setRange(0, 360);
+    sectionAzimuthSlider->setValue(180);
+    sectionLayout->addWidget(new QLabel("Azimuth"));
+    sectionLayout->addWidget(sectionAzimuthSlider);
+
+    QSlider *sectionElevationSlider = new QSlider(Qt::Horizontal);
+    sectionElevationSlider->setRange(-90, 90);
+    sectionElevationSlider->setValue(0);
+    sectionLayout->addWidget(new QLabel("Elevation"));
+    sectionLayout->addWidget(sectionElevationSlider);
+
+    QWidgetAction *sectionAction = new QWidgetAction(this);
+    sectionAction->setDefaultWidget(sectionPanel);
+
+    QMenu *sectionMenu = new QMenu(this);
+    sectionMenu->addAction(sectionAction);
+
+    connect(ui->actionSection_View, &QAction::triggered, this, [=]() {
+        sectionMenu->exec(QCursor::pos());
+    });
+
+    auto updateSectionPlane = [=]() {
+        double bounds[6];
+        renderer->ComputeVisiblePropBounds(bounds);
+        if (!vtkMath::AreBoundsInitialized(bounds))
+            return;
+
+        double rAz = qDegreesToRadians(static_cast<double>(sectionAzimuthSlider->value()));
+        double rEl = qDegreesToRadians(static_cast<double>(sectionElevationSlider->value()));
+        double normal[3] = { cos(rEl) * cos(rAz), cos(rEl) * sin(rAz), sin(rEl) };
+
+        double dx = bounds[1] - bounds[0];
+        double dy = bounds[3] - bounds[2];
+        double dz = bounds[5] - bounds[4];
+        double halfSize = 0.5 * sqrt(dx * dx + dy * dy + dz * dz);
+        double offset = sectionOffsetSlider->value() / 100.0 * halfSize;
+
+        double origin[3];
+        for (int i = 0; i < 3; ++i)
+            origin[i] = 0.5 * (bounds[2 * i] + bounds[2 * i + 1]) + normal[i] * offset;
+
+        sectionView->setPlane(origin, normal);
+        renderWindow->Render();
+    };
+
+    auto updateSectionParts = [=]() {
+        QList<ModelPart*> parts;
+        if (sectionEnabled->isChecked()) {
+            if (sectionSelectedOnly->isChecked()) {
+                for (const QModelIndex& index : ui->treeView->selectionModel()->selectedRows()) {
+                    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+                    if (part && part->getActor())
+                        parts.append(part);
+                }
+            } else {
+                collectParts(QModelIndex(), parts);
+            }
+        }
+        sectionView->setParts(parts);
+        updateSectionPlane();
+    };
+
+    connect(sectionEnabled, &QCheckBox::toggled, this, updateSectionParts);
+    connect(sectionSelectedOnly, &QCheckBox::toggled, this, updateSectionParts);
+    connect(ui->treeView, &QTreeView::clicked, this, [=]() {
+        if (sectionEnabled->isChecked() && sectionSelectedOnly->isChecked())
+            updateSectionParts();
+    });
+    connect(sectionCaps, &QCheckBox::toggled, this, [=](bool checked) {
+        sectionView->setCapsEnabled(checked);
+        renderWindow->Render();
+    });
+    connect(sectionOffsetSlider, &QSlider::valueChanged, this, updateSectionPlane);
+    connect(sectionAzimuthSlider, &QSlider::valueChanged, this, updateSectionPlane);
+    connect(sectionElevationSlider, &QSlider::valueChanged, this, updateSectionPlane);
+    //END SECTION VIEW PANEL
+
 
 
     // -------------------------------- VTK RENDERING ----------------------------------
@@ -187,22 +299,63 @@ MainWindow::MainWindow(QWidget *parent)
     renderer->GetActiveCamera()->Roll(30);
     renderer->GetActiveCamera()->Elevation(-70);
     renderer->ResetCameraClippingRange();
+
+    sectionView = new SectionView(renderer);
     
 
     // create base instance for actor loading but no rendering yet
-    vrThread = new VRRenderThread(this); // Create a new VR thread // Store the thread pointer for later use
+    createVRThread();
+
+    // SteamVR is checked in the background so Start VR does not have to initialise OpenVR first
+    vrProbe = new VRRuntimeProbe(this);
+    checkConnect = connect(vrProbe, &VRRuntimeProbe::availabilityChanged, this, [this](bool available) {
+        emit statusUpdateMessage(available ? QString("SteamVR headset available") : QString("SteamVR headset not available"), 0);
+    });
+    Q_ASSERT(checkConnect);
 
     // -------------------------------- SETUP MODEL PART LIST ----------------------------------
 
     /* Create/allocate the ModelList */
     this->partList = new ModelPartList("Parts List");
+    connectPartList();
 
     /* Link it to the tree view in the GUI */
     ui->treeView->setModel(this->partList);
+
+    // parts stay in load order until a column header is clicked
+    ui->treeView->header()->setSortIndicator(-1, Qt::AscendingOrder);
+
+    // -------------------------------- UNDO HISTORY ----------------------------------
+
+    // removing and replacing parts can be undone, see PartHistory
+    undoStack = new QUndoStack(this);
+
+    QAction *undoAction = undoStack->createUndoAction(this, tr("Undo"));
+    undoAction->setShortcut(QKeySequence::Undo);
+    QAction *redoAction = undoStack->createRedoAction(this, tr("Redo"));
+    redoAction->setShortcut(QKeySequence::Redo);
+
+    QMenu *editMenu = ui->menubar->addMenu(tr("Edit"));
+    editMenu->addAction(undoAction);
+    editMenu->addAction(redoAction);
+
+    // -------------------------------- FILTER WORKER ----------------------------------
+
+    // filters run on their own thread so dragging a filter slider never stalls the window
+    filterWorker = new FilterWorker(this);
+    checkConnect = connect(filterWorker, &FilterWorker::resultReady, this, &MainWindow::handleFilterResult, Qt::QueuedConnection);
+    Q_ASSERT(checkConnect);
 }
 
 MainWindow::~MainWindow()
 {
+    // end the VR session (paused or not), the thread must finish before it is deleted
+    if (vrThread && vrThread->isRunning()) {
+        vrThread->issueCommand(VRRenderThread::END_RENDER, 0);
+        vrThread->wait();
+    }
+
+    delete sectionView;
     delete ui;
 }
 
@@ -226,6 +379,16 @@ void MainWindow::handleTreeClicked(){
 
 void MainWindow::on_actionStart_VR_triggered(){
 
+    // a paused session still has its window and uploaded geometry, so it comes back straight away
+    if (vrThread->isRunning()) {
+        vrThread->pushCommand(VRCommand::make(VRCommand::Resume));
+
+        ui->actionStart_VR->setEnabled(false);
+        ui->actionStop_VR->setEnabled(true);
+        emit statusUpdateMessage(QString("Resumed VR Renderer"), 0);
+        return;
+    }
+
     if (!steamVRAvailable())
     {
         QMessageBox::warning(
@@ -237,31 +400,56 @@ void MainWindow::on_actionStart_VR_triggered(){
 
         return;
     }
+    QList<ModelPart*> parts;
+    collectParts(QModelIndex(), parts);
+
+    // the session was closed from the headset side (e.g. quit from the SteamVR dashboard), a
+    // finished thread cannot be restarted so make a new one and give it the parts again
+    if (vrThread->isFinished()) {
+        delete vrThread;
+        createVRThread();
+        for (ModelPart* part : parts) {
+            if (part->getVrActor())
+                vrThread->pushCommand(VRCommand::make(VRCommand::AddActor, part->getVrActor()));
+        }
+        sendLightingToVR();
+    }
+
+    // bring every VR actor up to date in one snapshot, the thread applies it before its first frame
+    for (ModelPart* part : parts)
+        part->takeVrChanges(vrThread->scene());
+    vrThread->scene().publish();
+
+    vrProbe->setSessionActive(true);
     vrThread->start(); // Start the VR thread
 
     ui->actionStart_VR->setEnabled(false); // Disable the Start VR action once started
     ui->actionStop_VR->setEnabled(true); // Enable the Stop VR action
-    ui->actionOpen_Dir->setEnabled(false); // Disable the Open File action so loading can't happen when in VR
     emit statusUpdateMessage(QString("Started VR Renderer"), 0);
 }
 void MainWindow::on_actionStop_VR_triggered() {
 
-    if (vrThread) {
-        // Tell the thread to end its loop:
-        vrThread->issueCommand(VRRenderThread::END_RENDER, 0);
-
-        // Wait for run() to finish and do its own TerminateApp/Finalize:
-        vrThread->wait();
-
-        delete vrThread;
-        vrThread = new VRRenderThread(this); // Create a new VR thread without rendering for future use
+    if (vrThread && vrThread->isRunning()) {
+        // Pause rather than end the session, OpenVR, the window and the uploaded geometry are kept
+        // so starting again is near instant. The session ends when the window closes
+        vrThread->pushCommand(VRCommand::make(VRCommand::Pause));
+
+        VRRenderThread::CommandLatency latency = vrThread->commandLatency();
+        qDebug() << "VR session applied" << latency.count << "commands, mean latency" << latency.meanMs
+                 << "ms, max" << latency.maxMs << "ms";
+
+        VRRenderThread::FrameStats frames = vrThread->frameStats();
+        qDebug() << "VR session drew" << frames.frames << "frames," << frames.missedFrames << "missed,"
+                 << frames.reprojectedFrames << "reprojected, mean GPU time" << frames.meanGpuMs() << "ms";
+        for (const VRFrameGovernor::Decision& decision : vrThread->governorDecisions())
+            qDebug() << "  governor frame" << decision.frame << decision.reason << "GPU" << decision.gpuMs << "ms ->"
+                     << "scale" << decision.renderScale << "LOD bias" << decision.lodBias;
     }
 
     ui->actionStart_VR->setEnabled(true); // Enable the Start VR action once started
     ui->actionStop_VR->setEnabled(false); // Disable the Stop VR action
-    ui->actionOpen_Dir->setEnabled(true); // Enable the Open File action so loading can happen when not in VR
 
-    emit statusUpdateMessage(QString("Stopped VR Renderer"), 0);
+    emit statusUpdateMessage(QString("Paused VR Renderer"), 0);
 }
 
 void MainWindow::on_actionItemOptions_triggered() {
@@ -279,25 +467,126 @@ void MainWindow::on_actionRemove_Part_triggered(){
     emit statusUpdateMessage(QString("Part removed"), 0);
 }
 
+void MainWindow::on_actionRepair_Part_triggered(){
+    QModelIndexList indexes = selectedPartIndexes();
+    if (indexes.isEmpty()) return;
+
+    // every selected part follows the current one, so a mixed selection ends up all on or all off
+    QModelIndex index = ui->treeView->currentIndex().siblingAtColumn(ModelPartList::NameColumn);
+    if (!indexes.contains(index))
+        index = indexes.first();
+    ModelPart *part = static_cast<ModelPart*>(index.internalPointer());
+    FilterStage *repair = part->getFilters().stage("repair");
+    if (!repair || !part->getFile()) return;
+
+    const bool enable = !repair->isEnabled();
+    for (const QModelIndex& selected : indexes) {
+        FilterStage *stage = static_cast<ModelPart*>(selected.internalPointer())->getFilters().stage("repair");
+        if (stage)
+            stage->setEnabled(enable);
+    }
+
+    if (indexes.size() == 1) {
+        submitFilterJob(part);
+
+        QModelIndex defectsIndex = index.siblingAtColumn(ModelPartList::DefectsColumn);
+        emit partList->dataChanged(defectsIndex, defectsIndex);
+    } else {
+        submitFilterBatch(indexes);
+    }
+    emit statusUpdateMessage(enable ? QString("Repairing %1 part(s)").arg(indexes.size())
+                                    : QString("Part repair removed from %1 part(s)").arg(indexes.size()), 0);
+}
+
+void MainWindow::sendLightingToVR(){
+    if (!vrThread) return;
+
+    VRCommand command = VRCommand::make(VRCommand::SetLighting);
+    command.values[0] = mainLight->GetIntensity();
+    mainLight->GetPosition(command.values + 1);
+    mainLight->GetFocalPoint(command.values + 4);
+    vrThread->pushCommand(std::move(command));
+}
+
+void MainWindow::validateLoadedPart(ModelPart* part){
+    if (ui->actionValidate_On_Load->isChecked())
+        part->validateMesh();
+}
+
 // ----------------------------- Part Managment ----------------------------------
 
 void MainWindow::removeSelectedPart(){
     QModelIndex index = ui->treeView->currentIndex();
     if (!index.isValid()) return;
 
-    ModelPart *part = static_cast<ModelPart*>(index.internalPointer());
+    // pushing the command removes the part, it is kept (not deleted) so the removal can be undone
+    undoStack->push(new RemovePartCommand(partList, index.siblingAtColumn(ModelPartList::NameColumn), partSceneHooks()));
+}
 
-    //remove the actor from the renderer
-    if (part->getActor()) {//checks to see if actor for part exsists
-        renderer->RemoveActor(part->getActor());
-        qDebug() << "Removed actor for part:" << part->data(0).toString();
-    }
+PartSceneHooks MainWindow::partSceneHooks() {
+    PartSceneHooks hooks;
 
-    // Remove the part from the model
-    partList->removePart(index);
+    hooks.hide = [this](const QModelIndex& index) {
+        bool vrChanged = false;
+        for (ModelPart* part : partsUnder(index)) {
+            cancelFilterJob(part);
+            sectionView->forgetPart(part);
 
-    // Update the rendering window
-    updateRender();
+            // the VR command keeps the actor alive until the VR thread has taken it out
+            if (part->getVrActor()) {
+                vrThread->removeActor(part->getVrActor());
+                vrChanged = true;
+            }
+
+            //remove the actor from the renderer
+            renderer->RemoveActor(part->getActor());
+            if (part->getFiltedActor())
+                renderer->RemoveActor(part->getFiltedActor());
+            qDebug() << "Removed actor for part:" << part->data(0).toString();
+        }
+        if (vrChanged)
+            vrThread->scene().publish();
+        renderWindow->Render();
+    };
+
+    hooks.show = [this](const QModelIndex& index) {
+        // the actors were kept, so the parts are back straight away without reading their files
+        QList<ModelPart*> parts = partsUnder(index);
+        for (ModelPart* part : parts) {
+            placePartActor(part);
+            if (part->getVrActor()) {
+                vrThread->addActor(part->getVrActor());
+                part->resendToVr();     // the scene dropped the part when it was removed
+            }
+        }
+        syncPartsToVR(parts);
+
+        // the part may not match the search it was removed under, refreshSearch() places it once the tree has it
+        renderWindow->Render();
+    };
+
+    hooks.geometryChanged = [this](const QModelIndex& index, vtkActor* previousActor) {
+        ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+        renderer->RemoveActor(previousActor);
+        if (part->getActor())
+            part->setActorValues();
+
+        // the filters run again on the restored mesh, their cached outputs were made from the other one
+        showPartActor(part);
+        submitFilterJob(part);
+        renderWindow->Render();
+    };
+
+    return hooks;
+}
+
+QList<ModelPart*> MainWindow::partsUnder(const QModelIndex& index) {
+    QList<ModelPart*> parts;
+    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+    if (part && part->getActor())
+        parts.append(part);
+    collectParts(index, parts);
+    return parts;
 }
 
 void MainWindow::addNewPart() {
@@ -326,11 +615,15 @@ void MainWindow::addNewPart() {
     // Always add the new part to the root of the part list
     if (!partList) {
         partList = new ModelPartList("Parts List");
+        connectPartList();
         ui->treeView->setModel(partList);
     }
 
     partList->insertPartAtRoot(newPart);
     newPart->loadSTL(filePath);
+    validateLoadedPart(newPart);
+    if (newPart->getVrActor())
+        vrThread->addActor(newPart->getVrActor());  // streamed in if VR is running
     updateRender();
 
 }
@@ -366,21 +659,20 @@ void MainWindow::replaceSelectedPart() {
 
     ModelPart *partOld = partList->getPart(index); // Get the part from the model
 
-    QString name = QFileInfo(filePath).completeBaseName();
-    ModelPart *partNew = new ModelPart({name, "true"});
-    partNew->loadSTL(filePath);
-
-    renderer->RemoveActor(partOld->getActor());
-
-    partOld->set(0, name); //set name of part
-    partOld->setFile(partNew->getFile());
-    partOld->setActor(partNew->getActor());
-    partOld->setMapper(partNew->getMapper());
-
     qDebug() << "About to load STL for" << filePath;
 
-    ui->treeView->model()->dataChanged(index, index); // Tell the view that the model has changed
-    updateRender();
+    // loaded into a part of its own so the new mesh can be saved as a state, the old one is kept by the undo history
+    QString name = QFileInfo(filePath).completeBaseName();
+    ModelPart partNew({name, "true"});
+    partNew.loadSTL(filePath);
+    if (!partNew.getActor()) {
+        emit statusUpdateMessage(QString("Could not load ") + filePath, 0);
+        return;
+    }
+    validateLoadedPart(&partNew);
+
+    // pushing the command gives the part the new mesh and updates the tree, renderers and VR
+    undoStack->push(new ReplacePartCommand(partList, partOld, partNew.saveState(), partSceneHooks()));
 }
 
 
@@ -388,22 +680,34 @@ void MainWindow::replaceSelectedPart() {
 // ----------------------------- Open Folders ----------------------------------
 
 void MainWindow::openItemOptionsDialog(){
-    QModelIndex index = ui->treeView->currentIndex();
-    if (!index.isValid()) return;
+    QModelIndexList indexes = selectedPartIndexes();
+    if (indexes.isEmpty()) return;
 
+    // the dialog starts from the current part's values
+    QModelIndex index = ui->treeView->currentIndex().siblingAtColumn(ModelPartList::NameColumn);
+    if (!indexes.contains(index))
+        index = indexes.first();
     ModelPart *part = static_cast<ModelPart*>(index.internalPointer());
 
     OptionDialog dialog(this);
     dialog.loadFromModelPart(part->data(0).toString(),
                              part->getColourR(), part->getColourG(), part->getColourB(), part->visible());
+    dialog.setNameEditable(indexes.size() == 1);
 
     if (dialog.exec() == QDialog::Accepted) {
         emit statusUpdateMessage(QString("Dialog accepted"), 0);
 
-        part->set(0, dialog.getPartName());
-        part->setColour(dialog.getRed(), dialog.getGreen(), dialog.getBlue());
-        part->setVisible(dialog.getVisibility());
-        part->setActorValues();
+        if (indexes.size() == 1)
+            partList->renamePart(index, dialog.getPartName());
+
+        // every selected part is changed first, then the VR scene, tree and view are updated once
+        for (const QModelIndex& selected : indexes) {
+            ModelPart *selectedPart = static_cast<ModelPart*>(selected.internalPointer());
+            selectedPart->setColour(dialog.getRed(), dialog.getGreen(), dialog.getBlue());
+            selectedPart->setVisible(dialog.getVisibility());
+            if (selectedPart->getActor())
+                selectedPart->setActorValues();
+        }
 
         /*//  Update actor color immediately
         if (part->getActor()) {
@@ -414,13 +718,10 @@ void MainWindow::openItemOptionsDialog(){
                 );
         }*/
 
-        renderer->Render(); // Refresh the window
-        updateRender();
-
-        ui->treeView->model()->dataChanged(index, index);
+        refreshEditedParts(indexes);
 
         emit statusUpdateMessage(
-            QString("ModelPart updated, dialog visible: %1").arg(part->visible()),
+            QString("%1 ModelPart(s) updated, dialog visible: %2").arg(indexes.size()).arg(part->visible()),
             0
             );
 
@@ -450,51 +751,301 @@ void MainWindow::loadFolderAsTree() {
     } 
 
     // Loading new STL files over the old ones if exist
+    cancelFilterJobs();
+    sectionView->clear();
+    undoStack->clear();     // the history refers to parts of the old list
     if (this->partList){
+        // take the old parts out of VR as well, it may be running
+        QList<ModelPart*> oldParts;
+        collectParts(QModelIndex(), oldParts);
+        for (ModelPart* part : oldParts) {
+            if (part->getVrActor())
+                vrThread->removeActor(part->getVrActor());
+        }
+        vrThread->scene().publish();    // one snapshot without any of them
+
         delete this->partList; // Delete the old part list if it exists
         this->partList = nullptr; // Set to null to avoid dangling pointer
         renderer->RemoveAllViewProps();
         qDebug() << "Deleted old part list";
     }
-    // Create a new part list and set it to the tree view
+    // Create a new part list and set it to the tree view. Subfolders become folder items that are
+    // only read when expanded, and a folder's parts are added a batch at a time as they are scrolled
+    // to, each row showing its name straight away while the files are loaded in short slices
     this->partList = new ModelPartList("Parts List");
-    ui->treeView->setModel(this->partList);  
-    ModelPart *rootItem = this->partList->getRootItem();
+    this->partList->setRootFolder(dirPath);
+    this->partList->setPartLoader([this](ModelPart* newPart, const QString& filePath) {
+        newPart->loadSTL(filePath);
+        validateLoadedPart(newPart);
 
-    // Create iterator to recursively search through directories
-    QDirIterator item(dirPath, QStringList() << "*.stl", QDir::Files, QDirIterator::Subdirectories);
+        if (newPart->getVrActor())
+            vrThread->addActor(newPart->getVrActor());  // streamed in if VR is running
+    });
+    connectPartList();
 
-    int count = 0; // Counter for the number of STL files found
-    while (item.hasNext()) {
-        QString filePath = item.next();
+    // the top level is read straight away, the view fetches the rest
+    this->partList->fetchMore(QModelIndex());
+    ui->treeView->setModel(this->partList);
 
-        // Check if it's actually an STL file (case insensitive)
-        QFileInfo fileInfo(filePath);
-        if (fileInfo.suffix().toLower() != "stl") continue; // Skip if not an STL file
-        
-        qDebug() << "Found STL file:" << filePath;
-        QString name = QFileInfo(filePath).completeBaseName();
+    // the old search does not carry over to the new folder
+    {
+        QSignalBlocker blocker(ui->searchLineEdit);
+        ui->searchLineEdit->clear();
+    }
+    searchText.clear();
+    searchMatched.clear();
+    searchShown.clear();
+    searchHidden.clear();
+    searchInserted.clear();
+
+    if (this->partList->rowCount(QModelIndex()) == 0)
+        emit statusUpdateMessage(QString("No STL files or folders found in the selected directory"), 0);
+}
 
-        // Create a new part for each STL file found
-        ModelPart *newPart = new ModelPart({name, "true"});
-        newPart->loadSTL(filePath); 
-        rootItem->appendChild(newPart); // append to tree
+void MainWindow::connectPartList() {
+    // the search has to see every row added or removed, whichever way the list was made
+    connect(partList, &ModelPartList::partsFetched, this, &MainWindow::handlePartsFetched);
+    connect(partList, &ModelPartList::partsLoaded, this, &MainWindow::handlePartsLoaded);
+    connect(partList, &ModelPartList::rowsInserted, this, &MainWindow::searchRowsInserted);
+    connect(partList, &ModelPartList::rowsAboutToBeRemoved, this, &MainWindow::searchRowsAboutToBeRemoved);
+}
 
-        vrThread->addActorOffline(newPart->getVrActor().GetPointer());
+void MainWindow::handlePartsFetched(const QModelIndex& folder, const QList<ModelPart*>& parts) {
+    if (parts.isEmpty())
+        return;
+
+    // the rows only have names so far, the part list loads their files a slice at a time
+    QString name = folder.isValid() ? folder.data().toString() : QString("the top folder");
+    emit statusUpdateMessage(QString("Loading %1 STL files from %2").arg(parts.size()).arg(name), 0);
+
+    // keep the sort order the user picked once the view has finished fetching, the search places the
+    // new rows itself (see refreshSearch()) and keeps them hidden or shown through the sort
+    QTimer::singleShot(0, this, [this]() {
+        int sortColumn = ui->treeView->header()->sortIndicatorSection();
+        if (sortColumn >= 0)
+            ui->treeView->sortByColumn(sortColumn, ui->treeView->header()->sortIndicatorOrder());
+    });
+}
+
+void MainWindow::handlePartsLoaded(const QList<ModelPart*>& parts) {
+    // the camera is only fitted to the first parts, so loading more does not move the view
+    bool first = renderer->GetActors()->GetNumberOfItems() == 0;
+
+    // parts that do not match the search are hidden in the view, like the ones loaded before them
+    for (ModelPart* part : parts) {
+        if (!part->getActor())
+            continue;
+        renderer->AddActor(part->getDisplayActor());
+        if (!searchText.isEmpty() && !searchMatched.contains(part))
+            part->getDisplayActor()->SetVisibility(0);
+    }
+    if (first)
+        renderer->ResetCamera();
+    renderer->SetBackground(0.15, 0.15, 0.15); //Background Grey
+    ui->vtkWidget->update();
+    renderWindow->Render();
 
-        // Tell the view that the model has changed
-        QModelIndex parentIndex = this->partList->index(0, 0, QModelIndex());
-        emit this->partList->dataChanged(parentIndex, parentIndex);
-        count++;
+    emit statusUpdateMessage(QString("%1 STL files loaded").arg(parts.size()), 0);
+
+    // the metric columns of these rows were empty until now
+    int sortColumn = ui->treeView->header()->sortIndicatorSection();
+    if (sortColumn > ModelPartList::VisibleColumn)
+        ui->treeView->sortByColumn(sortColumn, ui->treeView->header()->sortIndicatorOrder());
+}
+
+void MainWindow::applyPartSearch(const QString& text) {
+    updateSearch(text, true);
+}
+
+void MainWindow::updateSearch(const QString& text, bool addWaiting) {
+    if (!partList)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool searching = !text.isEmpty();
+    const bool wasSearching = !searchText.isEmpty();
+    searchText = text;
+
+    // matches in listed folders that are not in the tree yet are added, at most a batch of them
+    const QList<ModelPart*> matches = partList->findParts(text);
+    if (searching && addWaiting)
+        partList->addFoundParts(matches, ModelPartList::FetchBatch);
+    const qint64 findMs = timer.elapsed();
+
+    // the matching items stay in the tree along with the folders above them, which are expanded
+    QSet<ModelPart*> matched, shown, opened;
+    ModelPart* root = partList->getRootItem();
+    for (ModelPart* part : matches) {
+        if (part->getListingFolder())
+            continue;       // still waiting in its folder, more than a batch matched
+        matched.insert(part);
+        shown.insert(part);
+        for (ModelPart* item = part->parentItem(); item && item != root && !opened.contains(item); item = item->parentItem()) {
+            opened.insert(item);
+            shown.insert(item);
+        }
     }
-    if (count == 0) {
-        emit statusUpdateMessage(QString("No STL files found in the selected directory"), 0);
+
+    // only the rows whose place in the result changed are touched, each one makes the view lay itself out again
+    const QSet<ModelPart*> oldShown = searchShown;
+    searchShown = shown;
+    if (!searching) {
+        QSet<ModelPart*> hidden;
+        hidden.swap(searchHidden);
+        for (ModelPart* item : hidden)
+            setSearchRowHidden(item, false);
     } else {
-        emit statusUpdateMessage(QString("%1 STL files loaded").arg(count), 0);
-        updateRender();
+        if (!wasSearching)
+            hideUnshownRows(root);
+        for (ModelPart* item : oldShown) {
+            if (!shown.contains(item))
+                setSearchRowHidden(item, true);
+        }
+        for (ModelPart* item : shown) {
+            if (oldShown.contains(item))
+                continue;
+            setSearchRowHidden(item, false);
+            hideUnshownRows(item);
+        }
+
+        // the folders above a match hold rows already, so expanding them never lists a folder
+        for (ModelPart* item : opened) {
+            QModelIndex index = partList->indexOf(item);
+            if (!ui->treeView->isExpanded(index))
+                ui->treeView->expand(index);
+        }
+    }
+
+    // the view only shows the matching parts, each part keeps its own visibility for when the search is cleared.
+    // Starting or clearing a search changes every part, otherwise only the parts that joined or left the result
+    int changed = 0;
+    auto place = [&](ModelPart* part) {
+        bool visible = part->visible() && (!searching || matched.contains(part));
+        if (part->getDisplayActor()->GetVisibility() != visible) {
+            part->getDisplayActor()->SetVisibility(visible);
+            ++changed;
+        }
+    };
+    if (searching != wasSearching) {
+        QList<ModelPart*> parts;
+        collectParts(QModelIndex(), parts);
+        for (ModelPart* part : parts)
+            place(part);
+    } else if (searching) {
+        for (ModelPart* part : searchMatched) {
+            if (!matched.contains(part) && part->getActor())
+                place(part);
+        }
+        for (ModelPart* part : matched) {
+            if (!searchMatched.contains(part) && part->getActor())
+                place(part);
+        }
+    }
+    searchMatched = matched;
+
+    if (changed > 0) {
+        ui->vtkWidget->update();
+        renderWindow->Render();
+    }
+
+    qDebug() << "Search for" << text << "found" << matches.size() << "parts in" << findMs << "ms, tree and"
+             << changed << "actors updated in" << timer.elapsed() << "ms";
+    if (searching) {
+        QString message = QString("%1 parts match \"%2\"").arg(matched.size()).arg(text);
+        if (matches.size() > matched.size())
+            message += QString(", %1 more are not in the tree yet").arg(matches.size() - matched.size());
+        emit statusUpdateMessage(message, 0);
     }
 }
 
+void MainWindow::fitCameraToSearch() {
+    // only the visible parts count, so the camera is fitted to the matches
+    renderer->ResetCamera();
+    ui->vtkWidget->update();
+    renderWindow->Render();
+}
+
+void MainWindow::setSearchRowHidden(ModelPart* item, bool hide) {
+    QModelIndex index = partList->indexOf(item);
+    if (!index.isValid())
+        return;
+
+    if (ui->treeView->isRowHidden(index.row(), index.parent()) != hide)
+        ui->treeView->setRowHidden(index.row(), index.parent(), hide);
+    if (hide)
+        searchHidden.insert(item);
+    else
+        searchHidden.remove(item);
+}
+
+void MainWindow::hideUnshownRows(ModelPart* parent) {
+    for (int row = 0; row < parent->childCount(); ++row) {
+        ModelPart* item = parent->child(row);
+        if (!searchShown.contains(item))
+            setSearchRowHidden(item, true);
+    }
+}
+
+void MainWindow::searchRowsInserted(const QModelIndex& parent, int first, int last) {
+    if (searchText.isEmpty())
+        return;
+
+    // placed once the view has seen the rows, and once for all the rows of a fetch or undo
+    ModelPart* parentItem = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : partList->getRootItem();
+    for (int row = first; row <= last; ++row)
+        searchInserted.insert(parentItem->child(row));
+    if (!searchRefreshQueued) {
+        searchRefreshQueued = true;
+        QTimer::singleShot(0, this, &MainWindow::refreshSearch);
+    }
+}
+
+void MainWindow::searchRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last) {
+    if (searchShown.isEmpty() && searchHidden.isEmpty() && searchInserted.isEmpty())
+        return;
+
+    ModelPart* parentItem = parent.isValid() ? static_cast<ModelPart*>(parent.internalPointer()) : partList->getRootItem();
+    QList<ModelPart*> items;
+    for (int row = first; row <= last; ++row)
+        items.append(parentItem->child(row));
+    while (!items.isEmpty()) {
+        ModelPart* item = items.takeLast();
+        searchMatched.remove(item);
+        searchShown.remove(item);
+        searchHidden.remove(item);
+        searchInserted.remove(item);
+        for (int row = 0; row < item->childCount(); ++row)
+            items.append(item->child(row));
+    }
+}
+
+void MainWindow::refreshSearch() {
+    searchRefreshQueued = false;
+    QSet<ModelPart*> inserted;
+    inserted.swap(searchInserted);
+    if (!partList || searchText.isEmpty() || inserted.isEmpty())
+        return;
+
+    // new rows start hidden under the rows the search shows, the ones that match are shown again below
+    ModelPart* root = partList->getRootItem();
+    QList<ModelPart*> parts;
+    for (ModelPart* item : inserted) {
+        ModelPart* parentItem = item->parentItem();
+        if (!searchShown.contains(item) && (parentItem == root || searchShown.contains(parentItem)))
+            setSearchRowHidden(item, true);
+        if (item->getActor())
+            parts.append(item);
+        collectParts(partList->indexOf(item), parts);
+    }
+    updateSearch(searchText, false);    // adding more waiting matches here would fetch them all, a batch per pass
+
+    for (ModelPart* part : parts)
+        part->getDisplayActor()->SetVisibility(part->visible() && searchMatched.contains(part));
+    if (!parts.isEmpty())
+        renderWindow->Render();
+}
+
 void MainWindow::on_actionOpen_Dir_triggered(){
     loadFolderAsTree(); // Load the folder as a tree structure
 }
@@ -528,12 +1079,8 @@ void MainWindow::updateRenderFromTree(const QModelIndex& parentIndex) {
         ModelPart* part = static_cast<ModelPart*>(parentIndex.internalPointer());
         if (part && part->getActor()) {
 
-            if(part->getFiltedActor()){ //if part is being filted dont add normal part actor
-                renderer->AddActor(part->getFiltedActor());
-            }
-            else{
-                renderer->AddActor(part->getActor());
-            }
+            //if part is being filted dont add normal part actor
+            renderer->AddActor(part->getDisplayActor());
             qDebug() << "Added actor for part:" << part->data(0).toString();
         }
     }
@@ -553,25 +1100,37 @@ void MainWindow::updateRenderFromTree(const QModelIndex& parentIndex) {
 
 // Returns true iff SteamVR is installed, running, and an HMD is connected
 bool MainWindow::steamVRAvailable() {
-    // Quick check: is the runtime installed on this machine?
-    if (!vr::VR_IsRuntimeInstalled())
-        return false;
-
-    // Is an HMD actually plugged in?
-    if (!vr::VR_IsHmdPresent())
-        return false;
-
-    // Try to initialize & immediately shut down the VR system just to test
-    vr::EVRInitError initError = vr::VRInitError_None;
-    vr::IVRSystem* pVRSys = vr::VR_Init(&initError, vr::VRApplication_Scene);
-    if (initError != vr::VRInitError_None)
-    {
-        // describe the failure in English
-        vr::VR_Shutdown();
-        return false;
-    }
-    vr::VR_Shutdown();
-    return true;
+    // the background probe has usually answered already, only check here if it has not
+    if (vrProbe && vrProbe->hasResult())
+        return vrProbe->available();
+    return VRRuntimeProbe::check();
+}
+
+void MainWindow::createVRThread() {
+    // create base instance for actor loading but no rendering yet
+    vrThread = new VRRenderThread(this);
+
+    // the session can end without Stop VR being pressed (quit from the headset)
+    connect(vrThread, &QThread::finished, this, [this]() {
+        vrProbe->setSessionActive(false);
+        ui->actionStart_VR->setEnabled(true);
+        ui->actionStop_VR->setEnabled(false);
+    });
+
+    // a part picked with a controller is selected in the tree
+    connect(vrThread, &VRRenderThread::partPicked, this, &MainWindow::handleVrPick, Qt::QueuedConnection);
+}
+
+void MainWindow::handleVrPick(vtkActor* actor) {
+    // the part may have been removed since it was picked, the actor is only compared, never used
+    QModelIndex index = findVrPart(QModelIndex(), actor);
+    if (!index.isValid())
+        return;
+
+    ui->treeView->setCurrentIndex(index);
+    ui->treeView->scrollTo(index);
+    ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+    emit statusUpdateMessage(QString("Picked in VR: ") + part->data(0).toString(), 0);
 }
 
 
@@ -594,103 +1153,56 @@ void MainWindow::openFilterDialog(){
 }
 
 void MainWindow::on_actionFilterOptions_triggered(){    //should only ever be opened through on action and not through normal openFilterDialog
-    QModelIndex index = ui->treeView->currentIndex();
-    if (!index.isValid()) return;
+    QModelIndexList indexes = selectedPartIndexes();
+    if (indexes.isEmpty()) return;
 
+    // the current part is previewed, the other selected parts are filtered once the dialog is accepted
+    QModelIndex index = ui->treeView->currentIndex().siblingAtColumn(ModelPartList::NameColumn);
+    if (!indexes.contains(index))
+        index = indexes.first();
     ModelPart *part = static_cast<ModelPart*>(index.internalPointer());
 
+    // kept so the preview can be undone if the dialog is cancelled
+    FilterPipeline originalFilters = part->getFilters();
+
     FilterDialog dialog(this);
     dialog.loadValuesFromPart(part->getClipFilterStatus(),part->getShrinkFilterStatus(),part->getClipOrigin(),part->getShrinkFactor());
+    dialog.loadMeshFilters(part->getFilters());
+
+    auto applyValues = [&dialog](ModelPart* target) {
+        target->setClipFilterStatus(dialog.getClipFilterEnabled());
+        target->setShrinkFilterStatus(dialog.getShrinkFilterEnabled());
+        target->setClipOrigin(dialog.getClipOrigin());
+        target->setShrinkFactor(dialog.getShrinkFactor());
+        dialog.applyMeshFilters(target->getFilters());
+    };
+
+    // live preview, every slider movement restarts the filters on the worker thread
+    connect(&dialog, &FilterDialog::filterValuesChanged, this, [this, part, applyValues]() {
+        applyValues(part);
+        submitFilterJob(part);
+    });
 
     if (dialog.exec() == QDialog::Accepted) {
 
         // -------------- update values from filters dialog -------------------------
-        part->setClipFilterStatus(dialog.getClipFilterEnabled());
-        part->setShrinkFilterStatus(dialog.getShrinkFilterEnabled());
-        part->setClipOrigin(dialog.getClipOrigin());
-        part->setShrinkFactor(dialog.getShrinkFactor());
-
-        vtkAlgorithmOutput* currentOutput = part->getFile()->GetOutputPort();
-        vtkSmartPointer<vtkAlgorithm> lastFilter;
-
-        // -------------------------- render setup ----------------------------------
-        // Remove old filtered actors
-        if (part->getFiltedActor()) {
-            renderer->RemoveActor(part->getFiltedActor());
-        }
-
-        renderer->RemoveActor(part->getActor());    //remove original part
-        //part->getActor()->SetVisibility(0);         //temp method should use remove actor
-
-        bool clipEnabled = dialog.getClipFilterEnabled();   //transfereed values jsut to make easier to read
-        bool shrinkEnabled = dialog.getShrinkFilterEnabled();
-
-        // -------------------------- clip filter ----------------------------------
-        if (clipEnabled) {
-            // creating the clipping plane
-            auto planeLeft = vtkSmartPointer<vtkPlane>::New();
-            planeLeft->SetOrigin(part->getClipOrigin(), 0, 0);
-            planeLeft->SetNormal(-1, 0, 0);
-
-            //applying the clipping filter to the part
-            auto clipFilter = vtkSmartPointer<vtkClipPolyData>::New();
-            clipFilter->SetInputConnection(currentOutput);
-            clipFilter->SetClipFunction(planeLeft);
-            currentOutput = clipFilter->GetOutputPort();
-            lastFilter = clipFilter;
-        }
+        if (indexes.size() == 1) {
+            applyValues(part);
 
-        // -------------------------- shrink filter ----------------------------------
-        if (shrinkEnabled) {
-            // setup the shrink filter
-            auto shrinkFilter = vtkSmartPointer<vtkShrinkPolyData>::New();
-            shrinkFilter->SetInputConnection(currentOutput);
-            shrinkFilter->SetShrinkFactor(part->getShrinkFactorAsFloat());
-            currentOutput = shrinkFilter->GetOutputPort();
-            lastFilter = shrinkFilter;
+            // the worker reuses every cached stage, so this only costs anything if a value changed
+            submitFilterJob(part);
+        } else {
+            for (const QModelIndex& selected : indexes)
+                applyValues(static_cast<ModelPart*>(selected.internalPointer()));
+            submitFilterBatch(indexes);
         }
 
-        // -------------------------- making actor ----------------------------------
-        if (clipEnabled || shrinkEnabled) {
-            auto mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
-            mapper->SetInputConnection(currentOutput);
-            auto actor = vtkSmartPointer<vtkActor>::New();
-
-            actor->SetMapper(mapper);
-
-            //copy position data  to new actor
-            actor->SetPosition(part->getActor()->GetPosition());
-            actor->SetOrientation(part->getActor()->GetOrientation());
-            actor->SetScale(part->getActor()->GetScale());
-            actor->SetUserTransform(part->getActor()->GetUserTransform());
-
-            if (clipEnabled && shrinkEnabled) { //both filters
-                part->setFiltedActor(actor);
-                renderer->AddActor(part->getFiltedActor());
-                emit statusUpdateMessage(QString("Both filtering"), 0);
-
-            } else if (clipEnabled) {           //just clip filter
-                part->setFiltedActor(actor);
-                renderer->AddActor(part->getFiltedActor());
-                emit statusUpdateMessage(QString("Clip filtering"), 0);
-
-            } else if (shrinkEnabled) {         // just shrink filter
-                part->setFiltedActor(actor);
-                renderer->AddActor(part->getFiltedActor());
-                emit statusUpdateMessage(QString("Shrink filtering"), 0);
-            }
-
-
+        if (part->hasActiveFilters()) {
+            emit statusUpdateMessage(QString("Filtering"), 0);
         } else {
-            // No filter: show original actor
-            renderer->AddActor(part->getActor());
-            //part->getActor()->SetVisibility(1);     //temp method should use add actor
-
             emit statusUpdateMessage(QString("No filtering"), 0);
         }
 
-        renderer->Render();
-        updateRender();
         /*
         emit statusUpdateMessage(
             QString("FilterDialog: clipFilterEnabled = %1, shrinkFilterEnabled = %2")
@@ -699,6 +1211,244 @@ void MainWindow::on_actionFilterOptions_triggered(){    //should only ever be op
             0
             );*/
     }
+    else {
+        // put back the filters the part had before the dialog opened, their outputs are still cached
+        cancelFilterJob(part);
+        part->getFilters() = originalFilters;
+        part->applyFilters();
+        showPartActor(part);
+        renderWindow->Render();
+
+        emit statusUpdateMessage(QString("Filter Dialog rejected"), 0);
+    }
+
+}
+
+void MainWindow::submitFilterJob(ModelPart* part) {
+    // a newer edit replaces whatever was still running for the part
+    cancelFilterJob(part);
+
+    if (!part->getFile())
+        return;
+
+    // nothing to run in the background, just show the unfiltered actor again
+    if (!part->hasActiveFilters()) {
+        part->applyFilters();
+        showPartActor(part);
+        renderWindow->Render();
+        return;
+    }
+
+    // only the last stage changed (e.g. dragging the shrink slider), rewrite its output directly
+    if (part->updateFiltersInPlace()) {
+        showPartActor(part);
+        renderWindow->Render();
+        return;
+    }
+
+    // the worker previews one part at a time, another part's unfinished preview is finished as a batch
+    if (previewPart && filterRequests.contains(previewPart))
+        submitFilterJobs({ previewPart });
+
+    previewPart = part;
+    filterWorker->submit(startFilterRequest(part), part->getFilters(), part->getFile()->GetOutput());
+}
+
+void MainWindow::submitFilterJobs(const QList<ModelPart*>& parts) {
+    QList<FilterWorker::Request> requests;
+    requests.reserve(parts.size());
+    for (ModelPart* part : parts) {
+        if (part == previewPart) {
+            filterWorker->cancel();
+            previewPart = nullptr;
+        }
+
+        FilterWorker::Request request;
+        request.generation = startFilterRequest(part);
+        request.pipeline = part->getFilters();
+        request.input = part->getFile()->GetOutput();
+        requests.append(request);
+    }
+    filterWorker->submitBatch(requests);
+}
+
+void MainWindow::cancelFilterJob(ModelPart* part) {
+    auto it = filterRequests.find(part);
+    if (it != filterRequests.end()) {
+        filterTargets.remove(it.value());
+        filterRequests.erase(it);
+    }
+
+    if (part == previewPart) {
+        filterWorker->cancel();
+        previewPart = nullptr;
+    }
+}
+
+void MainWindow::cancelFilterJobs() {
+    filterTargets.clear();
+    filterRequests.clear();
+    previewPart = nullptr;
+    filterWorker->cancel();     // a batch still running is left to finish, its results are dropped
+}
+
+int MainWindow::startFilterRequest(ModelPart* part) {
+    auto previous = filterRequests.constFind(part);
+    if (previous != filterRequests.constEnd())
+        filterTargets.remove(previous.value());
+
+    const int generation = ++filterGeneration;
+    filterTargets.insert(generation, part);
+    filterRequests.insert(part, generation);
+    return generation;
+}
+
+void MainWindow::handleFilterResult() {
+    QList<ModelPart*> shown;
+    QModelIndexList finished;
+    for (const FilterWorker::Result& result : filterWorker->takeResults()) {
+        // ignore anything from a request that has been replaced since
+        ModelPart* part = filterTargets.value(result.generation, nullptr);
+        if (!part || !result.output)
+            continue;
+
+        // the finished pipeline carries the newly cached stage outputs back to the part
+        if (result.finished) {
+            part->getFilters() = result.pipeline;
+            filterTargets.remove(result.generation);
+            filterRequests.remove(part);
+            if (part == previewPart)
+                previewPart = nullptr;
+            finished.append(partList->indexOf(part));
+        }
+
+        part->setFilteredOutput(result.output, result.outputShare);
+        placePartActor(part);
+        if (!shown.contains(part))
+            shown.append(part);
+    }
+    if (shown.isEmpty())
+        return;
+
+    // a whole batch arrives together, so the VR scene, tree and view are updated once for it
+    syncPartsToVR(shown);
+    if (!finished.isEmpty())
+        partList->partsChanged(finished);
+    renderWindow->Render();
+}
+
+void MainWindow::showPartActor(ModelPart* part) {
+    if (!part->getActor())
+        return;
+
+    placePartActor(part);
+    syncPartToVR(part);
+}
+
+void MainWindow::placePartActor(ModelPart* part) {
+    if (!part->getActor())
+        return;
 
+    renderer->RemoveActor(part->getActor());
+    if (part->getFiltedActor())
+        renderer->RemoveActor(part->getFiltedActor());
+
+    renderer->AddActor(part->getDisplayActor());
+    sectionView->refreshPart(part);
+}
+
+void MainWindow::submitFilterBatch(const QModelIndexList& indexes) {
+    QModelIndexList done;
+    QList<ModelPart*> queued;
+    for (const QModelIndex& index : indexes) {
+        ModelPart* part = static_cast<ModelPart*>(index.internalPointer());
+        if (!part->getFile())
+            continue;
+
+        // parts with nothing left to filter, or only the last stage changed, are finished here
+        if (!part->hasActiveFilters() || part->updateFiltersInPlace()) {
+            cancelFilterJob(part);     // a result still on its way from the worker would overwrite this one
+            if (!part->hasActiveFilters())
+                part->applyFilters();
+            placePartActor(part);
+            done.append(index);
+        } else {
+            queued.append(part);
+        }
+    }
+
+    if (!done.isEmpty())
+        refreshEditedParts(done);
+    if (!queued.isEmpty())
+        submitFilterJobs(queued);
+}
+
+void MainWindow::refreshEditedParts(const QModelIndexList& indexes) {
+    QList<ModelPart*> parts;
+    parts.reserve(indexes.size());
+    for (const QModelIndex& index : indexes)
+        parts.append(static_cast<ModelPart*>(index.internalPointer()));
+
+    syncPartsToVR(parts);
+    partList->partsChanged(indexes);
+    renderWindow->Render();
+}
+
+void MainWindow::syncPartToVR(ModelPart* part) {
+    syncPartsToVR({ part });
+}
+
+void MainWindow::syncPartsToVR(const QList<ModelPart*>& parts) {
+    // while VR is stopped the changes are left for on_actionStart_VR_triggered() to send in one go
+    if (!vrThread || !vrThread->isRunning())
+        return;
+
+    bool changed = false;
+    for (ModelPart* part : parts)
+        changed |= part->takeVrChanges(vrThread->scene());
+    if (changed)
+        vrThread->scene().publish();
+}
+
+QModelIndexList MainWindow::selectedPartIndexes() const {
+    QModelIndexList indexes;
+    if (ui->treeView->selectionModel())
+        indexes = ui->treeView->selectionModel()->selectedRows(ModelPartList::NameColumn);
+
+    // rows hidden by the search box can still be in the selection, they are left alone
+    for (int i = indexes.size() - 1; i >= 0; --i) {
+        if (ui->treeView->isRowHidden(indexes[i].row(), indexes[i].parent()))
+            indexes.removeAt(i);
+    }
+
+    QModelIndex current = ui->treeView->currentIndex();
+    if (indexes.isEmpty() && current.isValid())
+        indexes.append(current.siblingAtColumn(ModelPartList::NameColumn));
+    return indexes;
+}
+
+void MainWindow::collectParts(const QModelIndex& parentIndex, QList<ModelPart*>& parts) {
+    int rowCount = partList->rowCount(parentIndex);
+    for (int i = 0; i < rowCount; ++i) {
+        QModelIndex childIndex = partList->index(i, 0, parentIndex);
+        ModelPart* part = static_cast<ModelPart*>(childIndex.internalPointer());
+        if (part && part->getActor())
+            parts.append(part);
+        collectParts(childIndex, parts);
+    }
+}
+
+QModelIndex MainWindow::findVrPart(const QModelIndex& parentIndex, vtkActor* actor) {
+    int rowCount = partList->rowCount(parentIndex);
+    for (int i = 0; i < rowCount; ++i) {
+        QModelIndex childIndex = partList->index(i, 0, parentIndex);
+        ModelPart* part = static_cast<ModelPart*>(childIndex.internalPointer());
+        if (part && part->getVrActor() == actor)
+            return childIndex;
+        QModelIndex found = findVrPart(childIndex, actor);
+        if (found.isValid())
+            return found;
+    }
+    return QModelIndex();
 }
 
@@ -4,6 +4,8 @@
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QStatusBar>
+#include <QSet>
+#include <QHash>
 #include "ModelPart.h"
 #include "ModelPartList.h"
 
@@ -11,6 +13,12 @@
 #include <vtkGenericOpenGLRenderWindow.h>
 
 #include "VRRenderThread.h"
+#include "VRRuntimeProbe.h"
+#include "FilterWorker.h"
+#include "SectionView.h"
+#include "PartHistory.h"
+
+#include <QUndoStack>
 
 #include <vtkCylinderSource.h>
 #include <vtkPlane.h>
@@ -72,12 +80,12 @@ public slots:
     void on_actionItemOptions_triggered();
 
     /**
-     * @brief Starts the VR rendering thread
+     * @brief Starts the VR rendering thread, or resumes the session if it is paused
      */
     void on_actionStart_VR_triggered();
 
     /**
-     * @brief Stops the VR rendering thread
+     * @brief Pauses the VR session, the runtime, window and uploaded geometry are kept for the next start
      */
     void on_actionStop_VR_triggered();
 
@@ -96,6 +104,12 @@ public slots:
      * @brief Calls the remove model function
      */
     void on_actionRemove_Part_triggered();
+
+    /**
+     * @brief Turns the repair filter of the selected parts on or off
+     * @note the repaired mesh is made on the filter worker and cached by the part's filter pipeline
+     */
+    void on_actionRepair_Part_triggered();
     
     // // Generic open file dialog for loading STL file
     // /**
@@ -110,6 +124,64 @@ public slots:
      */
     void openFilterDialog();    //filter OPtions not itemOptions
 
+    /**
+     * @brief Takes the results from the filter worker and shows them in the render window
+     * @note results from requests that have since been replaced are ignored, a finished batch
+     *       is shown with one VR snapshot, one tree update and one render
+     */
+    void handleFilterResult();
+
+    /**
+     * @brief Selects the part picked with a VR controller in the tree view
+     * @param actor the part's VR actor
+     */
+    void handleVrPick(vtkActor* actor);
+
+    /**
+     * @brief Keeps the sort order and search for parts added when a folder in the tree was expanded or scrolled through
+     * @param folder the folder they belong to, invalid for the top folder
+     * @param parts the new parts, their geometry is loaded afterwards, see handlePartsLoaded()
+     */
+    void handlePartsFetched(const QModelIndex& folder, const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Shows a slice of fetched parts whose geometry has just been loaded
+     * @param parts the parts, some may have failed to load and have no actor
+     */
+    void handlePartsLoaded(const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Shows only the parts whose name contains some text, in the tree and in the view
+     * @note the parts are found with the part list's name index, see PartNameIndex, including files
+     *       of listed folders that are not in the tree yet (a batch of them is added). Folders holding
+     *       a match stay in the tree and are expanded. Only the rows and actors whose place in the
+     *       result changed since the last search are updated, and nothing is rendered if no actor
+     *       changed. Empty text shows everything again
+     * @param text the text to look for, ignoring case
+     */
+    void applyPartSearch(const QString& text);
+
+    /**
+     * @brief Fits the camera to the parts the search shows (every visible part if there is no search)
+     */
+    void fitCameraToSearch();
+
+    /**
+     * @brief Notes rows added to the tree while searching, they are placed by refreshSearch()
+     * @param parent the item they were added under
+     * @param first first row added
+     * @param last last row added
+     */
+    void searchRowsInserted(const QModelIndex& parent, int first, int last);
+
+    /**
+     * @brief Forgets the search state of rows (and everything under them) about to leave the tree
+     * @param parent the item they are under
+     * @param first first row removed
+     * @param last last row removed
+     */
+    void searchRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+
 
 signals:
     /**
@@ -126,37 +198,85 @@ private:
     ModelPartList* partList;                        /**< List of model parts */
 
     VRRenderThread* vrThread = nullptr;            /**< Pointer to the VR rendering thread */
+    VRRuntimeProbe* vrProbe = nullptr;             /**< Checks for SteamVR in the background */
 
     // Renderer and window
     vtkSmartPointer<vtkGenericOpenGLRenderWindow> renderWindow; /**< OpenGL render window */
     vtkSmartPointer<vtkRenderer> renderer;                     /**< Main renderer */
     vtkSmartPointer<vtkLight> mainLight;                      /**< Main scene light */
 
+    SectionView* sectionView = nullptr;            /**< GPU clipping plane section view */
+
+    FilterWorker* filterWorker = nullptr;          /**< Runs part filters in the background */
+    int filterGeneration = 0;                      /**< Increased for every filter request, used to drop old results */
+    QHash<int, ModelPart*> filterTargets;          /**< Part of each filter request not finished yet, by generation */
+    QHash<ModelPart*, int> filterRequests;         /**< Newest filter request of each part, older results are dropped */
+    ModelPart* previewPart = nullptr;              /**< Part of the newest preview request, see FilterWorker::submit() */
+
+    QUndoStack* undoStack = nullptr;               /**< Removed and replaced parts, cleared when a folder is opened */
+
+    QString searchText;                            /**< Text of the search shown in the tree and view, empty if none */
+    QSet<ModelPart*> searchMatched;                /**< Items in the tree matching the search */
+    QSet<ModelPart*> searchShown;                  /**< Items whose rows the search shows, the matches and the folders above them */
+    QSet<ModelPart*> searchHidden;                 /**< Rows hidden by the search, shown again when it is cleared */
+    QSet<ModelPart*> searchInserted;               /**< Rows added while searching that refreshSearch() has not placed yet */
+    bool searchRefreshQueued = false;              /**< True while a refreshSearch() is waiting to run */
+
 
     /**
-     * @brief Loads all STL files from a selected directory into the tree view and both renderers
+     * @brief Opens a directory as the parts tree, loading STL files as their folders are expanded
      *
-     * Opens a directory selection dialog and recursively searches for STL files.
-     * Creates a new ModelPartList and replaces existing ones and populates it with found models.
-     * Updates the tree view with the new model hierarchy.
+     * Opens a directory selection dialog and creates a new ModelPartList that replaces the existing one.
+     * Subdirectories become folder items in the tree, read when they are expanded, and each folder's
+     * STL files are added a batch at a time and loaded into both renderers in short slices, see
+     * ModelPartList::fetchMore().
      */
     void loadFolderAsTree();
 
+    /**
+     * @brief Connects the part list's signals to the window, call wherever a ModelPartList is made
+     * @note covers fetched and loaded parts and the rows the search has to place or forget
+     */
+    void connectPartList();
+
     /**
      * @brief Opens the item options dialog window
+     * @note the colour and visibility chosen are given to every selected part, the name can only
+     *       be changed when one part is selected
      */
     void openItemOptionsDialog();
 
+    /**
+     * @brief Gets the tree items selected for editing
+     * @return the selected rows (name column), the current item if no rows are selected, none if there is neither
+     */
+    QModelIndexList selectedPartIndexes() const;
+
     /**
      * @brief Replaces the selected model part in the tree with a new selected part
+     * @note the replacement can be undone, see ReplacePartCommand
      */
     void replaceSelectedPart();
 
     /**
      * @brief Removes the selected model part from the tree and render
+     * @note the removal can be undone, see RemovePartCommand
      */
     void removeSelectedPart();
 
+    /**
+     * @brief Gets the functions the undo commands use to update the renderers, see PartSceneHooks
+     * @return the hooks
+     */
+    PartSceneHooks partSceneHooks();
+
+    /**
+     * @brief Collects a part and every loaded part under it
+     * @param index the part's tree item
+     * @return the parts with actors
+     */
+    QList<ModelPart*> partsUnder(const QModelIndex& index);
+
     /**
      * @brief Adds a new model part to the tree
      */
@@ -178,10 +298,141 @@ private:
      */
     void updateAllThreadActors();
 
+    /**
+     * @brief Sends the part's current filter settings to the filter worker
+     * @note any request still running is cancelled, the result is shown by handleFilterResult()
+     * @param part the part to filter
+     */
+    void submitFilterJob(ModelPart* part);
+
+    /**
+     * @brief Sends several parts' filter settings to the filter worker as one batch
+     * @note the results come back together and are shown by handleFilterResult() with one tree
+     *       update and one render. A request of the same part still running is replaced
+     * @param parts the parts to filter, they must have geometry
+     */
+    void submitFilterJobs(const QList<ModelPart*>& parts);
+
+    /**
+     * @brief Cancels a part's filter request so its result is never shown
+     * @param part the part, other parts' requests carry on
+     */
+    void cancelFilterJob(ModelPart* part);
+
+    /**
+     * @brief Cancels every filter request so none of their results are shown
+     */
+    void cancelFilterJobs();
+
+    /**
+     * @brief Gives a new filter request of a part its generation, older requests of the part are dropped
+     * @param part the part the request is for
+     * @return the generation to submit with
+     */
+    int startFilterRequest(ModelPart* part);
+
+    /**
+     * @brief Makes sure the renderer holds the part's filtered actor or base actor, whichever should be shown
+     * @note also sends the part's changes to the running VR scene
+     * @param part the part to update
+     */
+    void showPartActor(ModelPart* part);
+
+    /**
+     * @brief Puts the part's filtered actor or base actor in the renderer and section view, without
+     *        sending anything to VR
+     * @param part the part to update
+     */
+    void placePartActor(ModelPart* part);
+
+    /**
+     * @brief Applies a filter change made to a selection, the filters run on the worker as one batch
+     * @note parts with no filters left, or whose last stage can be rewritten in place, are shown
+     *       straight away. Each part's cached stages are reused, see FilterPipeline::update()
+     * @param indexes the parts' tree items, items without geometry are skipped
+     */
+    void submitFilterBatch(const QModelIndexList& indexes);
+
+    /**
+     * @brief Finishes an edit of several parts with one VR snapshot, one tree update and one render
+     * @param indexes the tree items of the parts that were edited
+     */
+    void refreshEditedParts(const QModelIndexList& indexes);
+
+    /**
+     * @brief Collects every loaded part under a tree item
+     * @param parentIndex the item to start from, an invalid index starts from the root
+     * @param parts list the parts are appended to
+     */
+    void collectParts(const QModelIndex& parentIndex, QList<ModelPart*>& parts);
+
+    /**
+     * @brief Finds the tree item of the part with a given VR actor
+     * @param parentIndex the item to search under, an invalid index searches the whole tree
+     * @param actor the part's VR actor
+     * @return the item, invalid if no part has the actor
+     */
+    QModelIndex findVrPart(const QModelIndex& parentIndex, vtkActor* actor);
+
+    /**
+     * @brief Updates the tree rows and actors from the last search to a new one, see applyPartSearch()
+     * @param text the text to look for, ignoring case
+     * @param addWaiting true to add a batch of matches that are not in the tree yet
+     */
+    void updateSearch(const QString& text, bool addWaiting);
+
+    /**
+     * @brief Hides or shows the row of an item for the search, remembering the rows it hid
+     * @param item the item, nothing happens if it is not in the tree
+     * @param hide true to hide the row
+     */
+    void setSearchRowHidden(ModelPart* item, bool hide);
+
+    /**
+     * @brief Hides the rows under an item that the search does not show, see searchShown
+     * @param parent the item, only its own rows are updated
+     */
+    void hideUnshownRows(ModelPart* parent);
+
+    /**
+     * @brief Places the rows added while searching, hiding the ones that do not match
+     */
+    void refreshSearch();
+
+    /**
+     * @brief Validates a newly loaded part if "Validate Parts On Load" is checked
+     * @param part the part that was loaded
+     */
+    void validateLoadedPart(ModelPart* part);
+
+    /**
+     * @brief Sends the desktop light settings to the VR scene
+     */
+    void sendLightingToVR();
+
+    /**
+     * @brief Sends the colour, visibility and filter changes of a part to the running VR scene
+     * @note does nothing while VR is stopped, the changes are sent when it starts
+     * @param part the part that changed
+     */
+    void syncPartToVR(ModelPart* part);
+
+    /**
+     * @brief Sends the changes of several parts to the running VR scene in a single snapshot
+     * @note does nothing while VR is stopped, the changes are sent when it starts
+     * @param parts the parts that changed
+     */
+    void syncPartsToVR(const QList<ModelPart*>& parts);
+
     /**
      * @brief Checks if SteamVR is available on the system
      * @return True if SteamVR is available; false otherwise
      */
     bool steamVRAvailable();
+
+    /**
+     * @brief Creates the VR thread, which is not started until Start VR is pressed
+     */
+    void createVRThread();
 };
 #endif // MAINWINDOW_H
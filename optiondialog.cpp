@@ -21,6 +21,10 @@ void OptionDialog::loadFromModelPart(const QString &name, int r, int g, int b, b
     ui->checkBox->setChecked(visible);
 }
 
+void OptionDialog::setNameEditable(bool editable) {
+    ui->lineEdit->setEnabled(editable);
+}
+
 QString OptionDialog::getPartName() const {
     return ui->lineEdit->text();
 }
@@ -48,6 +48,13 @@ public:
      */
     void loadFromModelPart(const QString &name, int r, int g, int b, bool visible);
 
+    /**
+     * @brief Lets the part name be edited or not
+     * @note the name is locked when the dialog edits several parts at once, only the colour and visibility apply to them all
+     * @param editable true to allow editing the name
+     */
+    void setNameEditable(bool editable);
+
     /**
      * @brief Gets the name of the model part
      * @return The part name as a QString